@@ -0,0 +1,34 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <span>
+
+namespace Raytracer {
+    // 64-bit FNV-1a, used to key cached data by content. Not meant to resist collisions on purpose.
+    constexpr u64 g_HashSeed = 0xCBF29CE484222325ull;
+
+    [[nodiscard]] constexpr u64 HashBytes(const std::span<const std::byte> bytes, u64 seed = g_HashSeed) {
+        for (const std::byte byte : bytes) {
+            seed ^= static_cast<u64>(byte);
+            seed *= 0x100000001B3ull;
+        }
+
+        return seed;
+    }
+
+    // Chains the hash of several ranges: HashBytes(b, HashBytes(a)).
+    template <typename T>
+    [[nodiscard]] u64 HashRange(const std::span<const T> values, const u64 seed = g_HashSeed) {
+        return HashBytes(std::as_bytes(values), seed);
+    }
+
+    template <typename T>
+    [[nodiscard]] u64 HashValue(const T& value, const u64 seed = g_HashSeed) {
+        return HashBytes(std::as_bytes(std::span(&value, 1)), seed);
+    }
+}
@@ -0,0 +1,16 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <span>
+#include <vector>
+
+namespace Raytracer {
+    // Decodes a PNG, JPEG, TGA or BMP image held in memory into 8-bit RGBA pixels, rows tightly packed from the top.
+    [[nodiscard]] bool ReadImage(std::span<const std::byte> encoded, u32& outWidth, u32& outHeight,
+                                 std::vector<std::byte>& outRgba);
+}
@@ -0,0 +1,19 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <filesystem>
+#include <span>
+
+namespace Raytracer {
+    // Writes 8-bit RGB pixels, rows tightly packed from the top. The image data is stored without deflate
+    // compression, encoding is bound by the disk rather than the CPU.
+    [[nodiscard]] bool WritePng(const std::filesystem::path& path, u32 width, u32 height, std::span<const u8> rgb);
+
+    // Writes 32-bit float RGB pixels as an uncompressed scanline OpenEXR image, rows tightly packed from the top.
+    [[nodiscard]] bool WriteExr(const std::filesystem::path& path, u32 width, u32 height, std::span<const f32> rgb);
+}
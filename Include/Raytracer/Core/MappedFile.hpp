@@ -0,0 +1,45 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <filesystem>
+#include <span>
+
+namespace Raytracer {
+    // Read-only memory mapping of a whole file. Pages are only read from disk when touched, so large assets can be
+    // decoded in place without being copied into an intermediate buffer first.
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        // False when the file could not be opened or mapped, empty files are not mapped either.
+        [[nodiscard]] inline bool IsOpen() const;
+
+        [[nodiscard]] inline std::span<const std::byte> GetData() const;
+        [[nodiscard]] inline usize GetSize() const;
+
+    private:
+        const std::byte* m_Data = nullptr;
+        usize m_Size = 0;
+
+#if defined(_WIN32)
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+#else
+        int m_FileDescriptor = -1;
+#endif
+    };
+}
+
+#include <Raytracer/Core/MappedFile.inl>
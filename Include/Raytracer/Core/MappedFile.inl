@@ -0,0 +1,19 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+namespace Raytracer {
+    inline bool MappedFile::IsOpen() const {
+        return m_Data != nullptr;
+    }
+
+    inline std::span<const std::byte> MappedFile::GetData() const {
+        return {m_Data, m_Size};
+    }
+
+    inline usize MappedFile::GetSize() const {
+        return m_Size;
+    }
+}
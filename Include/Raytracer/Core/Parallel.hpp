@@ -0,0 +1,42 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Raytracer {
+    // Calls function(index) for every index in [0, count) on all the hardware threads, the calling thread included.
+    // Indices are handed out one at a time, so uneven work items (e.g. meshes of very different sizes) balance out.
+    template <typename Function>
+    void ParallelFor(const usize count, Function&& function) {
+        const usize workerCount = std::min<usize>(count, std::max(1u, std::thread::hardware_concurrency()));
+        if (workerCount <= 1) {
+            for (usize index = 0; index < count; index++) {
+                function(index);
+            }
+            return;
+        }
+
+        std::atomic<usize> nextIndex = 0;
+        const auto work = [&] {
+            for (usize index = nextIndex++; index < count; index = nextIndex++) {
+                function(index);
+            }
+        };
+
+        std::vector<std::jthread> workers;
+        workers.reserve(workerCount - 1);
+        for (usize worker = 1; worker < workerCount; worker++) {
+            workers.emplace_back(work);
+        }
+
+        work();
+    }
+}
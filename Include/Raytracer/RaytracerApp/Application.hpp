@@ -12,13 +12,45 @@
 #include <Raytracer/Renderer/VulkanRenderer.hpp>
 
 #include <Raytracer/RaytracerApp/RayQueryRenderer.hpp>
+#include <Raytracer/RaytracerApp/SceneStreamer.hpp>
 
+#include <array>
 #include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string_view>
 
 namespace Raytracer {
+    // Renders without window, swapchain nor UI, e.g. on render nodes without a display. The draw image takes the size
+    // of the window properties.
+    struct HeadlessSettings {
+        // Frames rendered once the scene is fully loaded and built, the application quits afterward.
+        u32 FrameCount = 1;
+        // Every counted frame is written in it when set, e.g. frame_00000.png.
+        std::filesystem::path CaptureDirectory;
+    };
+
+    // Renderer options chosen on the command line.
+    struct RenderOptions {
+        // Meshes are uploaded in the quantized vertex layout, the UI can still change it for the next loads.
+        bool VertexQuantization = false;
+        // BLAS are cached across launches in it when set. Nothing is written to disk otherwise.
+        std::filesystem::path BottomLevelCacheDirectory;
+        // BLAS are copied into right-sized buffers once built.
+        bool BottomLevelCompaction = true;
+    };
+
+    // F12 writes the current frame in it.
+    constexpr std::string_view g_CaptureDirectory = "Captures";
+
     class Application {
     public:
-        Application(const WindowProperties& properties, const DebugLevel& debugLevel);
+        // A generated scene takes precedence over the scene path.
+        Application(const WindowProperties& properties, const DebugLevel& debugLevel,
+                    const std::filesystem::path& scenePath = {},
+                    const std::optional<Scene::ProceduralSceneSettings>& proceduralScene = std::nullopt,
+                    const std::optional<HeadlessSettings>& headless = std::nullopt,
+                    const RenderOptions& renderOptions = {});
         ~Application();
         
         Application(const Application&) = delete;
@@ -30,6 +62,8 @@ namespace Raytracer {
         void Run();
 
         [[nodiscard]] inline bool IsRunning() const;
+        // A headless run stopped without rendering its frames, e.g. because the scene failed to load.
+        [[nodiscard]] inline bool HasFailed() const;
 
         [[nodiscard]] static inline Application& GetInstance();
 
@@ -45,16 +79,28 @@ namespace Raytracer {
         std::unique_ptr<Window> m_Window;
         std::unique_ptr<Renderer::VulkanRenderer> m_Renderer;
         std::unique_ptr<RayQueryRenderer> m_RayQueryRenderer;
+        std::unique_ptr<SceneStreamer> m_SceneStreamer;
 
         Camera m_Camera;
         f32 m_CameraSpeed = 1.f;
         f32 m_MouseSensitivity = 1.f;
         f32 m_Fov = 70.f;
 
+        std::array<char, 512> m_ScenePathInput{};
+        Scene::ProceduralSceneSettings m_ProceduralSettings;
+
+        std::optional<HeadlessSettings> m_Headless;
+        u32 m_HeadlessFramesRendered = 0;
+        bool m_Failed = false;
+        std::chrono::high_resolution_clock::time_point m_HeadlessStartTime;
+
+        u32 m_CaptureCount = 0;
+
         DeletionQueue m_ApplicationDeletionQueue;
         
         void OnUpdate();
         void OnRender();
+        void OnHeadlessRender();
         void OnEvent(Event& event);
 
         inline void Close();
@@ -13,6 +13,10 @@ namespace Raytracer {
         return m_IsRunning;
     }
 
+    inline bool Application::HasFailed() const {
+        return m_Failed;
+    }
+
     inline void Application::Close() {
         m_IsRunning = false;
     }
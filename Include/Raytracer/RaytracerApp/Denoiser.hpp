@@ -0,0 +1,75 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <Raytracer/Renderer/VulkanRenderer.hpp>
+
+#include <glm/glm.hpp>
+
+namespace Raytracer {
+    // Ranges exposed to the UI, the taps of the last pass stay within a few tens of pixels.
+    constexpr u32 g_MinDenoiserIterations = 0;
+    constexpr u32 g_MaxDenoiserIterations = 6;
+    constexpr u32 g_MinDenoiserKernelRadius = 1;
+    constexpr u32 g_MaxDenoiserKernelRadius = 3;
+
+    struct DenoiserSettings {
+        // À-trous passes, each one doubles the spacing of the taps. None shows the accumulation unfiltered.
+        u32 Iterations = 4;
+        // Taps on each side of the center in every pass.
+        u32 KernelRadius = 2;
+    };
+
+    // Matches denoise.comp.
+    struct DenoisePushConstants {
+        glm::uvec2 Extent;
+        u32 StepSize;
+        u32 KernelRadius;
+        u32 FirstPass;
+        u32 LastPass;
+    };
+
+    // Edge-aware à-trous wavelet filter of the accumulated AO and light visibility. The depth and normals keep the
+    // filter from crossing silhouettes and creases. The last pass shades the result into the renderer's draw image.
+    class Denoiser {
+    public:
+        explicit Denoiser(Renderer::VulkanRenderer* renderer);
+        ~Denoiser();
+
+        Denoiser(const Denoiser&) = delete;
+        Denoiser(Denoiser&&) = delete;
+
+        Denoiser& operator=(const Denoiser&) = delete;
+        Denoiser& operator=(Denoiser&&) = delete;
+
+        // Both images must be in VK_IMAGE_LAYOUT_GENERAL, the normals and depth already visible to compute shaders.
+        void Denoise(VkCommandBuffer commandBuffer, const Renderer::AllocatedImage& accumulation,
+                     const Renderer::AllocatedImage& normalDepth);
+
+        inline void SetSettings(const DenoiserSettings& settings);
+        [[nodiscard]] inline const DenoiserSettings& GetSettings() const;
+
+    private:
+        Renderer::VulkanRenderer* m_Renderer;
+
+        DeletionQueue m_DeletionQueue;
+
+        DenoiserSettings m_Settings;
+
+        // Every pass reads the output of the previous one.
+        Renderer::AllocatedImage m_FilterImages[2];
+
+        VkDescriptorSetLayout m_DescriptorLayout;
+        VkPipelineLayout m_PipelineLayout;
+        VkPipeline m_Pipeline;
+
+        void InitializeImages();
+        void InitializePipeline();
+    };
+}
+
+#include <Raytracer/RaytracerApp/Denoiser.inl>
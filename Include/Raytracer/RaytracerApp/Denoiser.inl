@@ -0,0 +1,15 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+namespace Raytracer {
+    inline void Denoiser::SetSettings(const DenoiserSettings& settings) {
+        m_Settings = settings;
+    }
+
+    inline const DenoiserSettings& Denoiser::GetSettings() const {
+        return m_Settings;
+    }
+}
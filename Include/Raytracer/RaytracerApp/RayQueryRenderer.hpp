@@ -6,12 +6,141 @@
 
 #include <Raytracer/rtpch.hpp>
 
+#include <Raytracer/Renderer/AccelerationStructureManager.hpp>
 #include <Raytracer/Renderer/VulkanDescriptors.hpp>
 #include <Raytracer/Renderer/VulkanRenderer.hpp>
 
 #include <Raytracer/RaytracerApp/Camera.hpp>
+#include <Raytracer/RaytracerApp/Denoiser.hpp>
+
+#include <Raytracer/Scene/CookedScene.hpp>
+#include <Raytracer/Scene/Ktx2Loader.hpp>
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
 
 namespace Raytracer {
+    // TLAS instance mask layers. Each ray type only traces against the instances in its layer, see the ray masks of
+    // GlobalUniform.
+    namespace InstanceLayer {
+        constexpr u8 CastsShadow = 1 << 0;
+        constexpr u8 OccludesAmbientOcclusion = 1 << 1;
+        constexpr u8 VisibleToCamera = 1 << 2;
+
+        constexpr u8 All = CastsShadow | OccludesAmbientOcclusion | VisibleToCamera;
+    }
+
+    // Matches input_structures.glsl.
+    constexpr u32 g_MaxOpacityTextures = 64;
+    constexpr u32 g_NoOpacityTexture = ~0u;
+
+    // Still views stop tracing once this many frames are accumulated, the accumulation is only resolved afterward.
+    constexpr u32 g_MaxAccumulatedFrames = 256;
+    // While the camera moves the reprojected history is capped, each reprojection blurs it a little.
+    constexpr u32 g_MaxMovingHistoryLength = 32;
+
+    // Ranges exposed to the UI.
+    constexpr u32 g_MaxAmbientOcclusionSampleCount = 16;
+    constexpr f32 g_MaxLightRadius = 5.f;
+
+    // Spherical light, its penumbrae are sampled by as many shadow rays as the AO. 0 makes it a point light.
+    constexpr f32 g_DefaultLightRadius = 0.5f;
+
+    // The shadow rays of an area light follow the same sample counts.
+    struct AmbientOcclusionSettings {
+        // Rays per pixel and frame, the accumulation makes up for low counts. Pixels without a variance estimate yet
+        // always trace this many.
+        u32 SampleCount = 2;
+        // Occluders farther than this don't darken the point.
+        f32 RayDistance = 2.f;
+
+        // Pixels whose accumulated mean is still noisier than the threshold trace the maximum count, the others the
+        // minimum one. Disabled, every pixel traces SampleCount rays.
+        bool AdaptiveSampling = true;
+        u32 MinSampleCount = 1;
+        u32 MaxSampleCount = 8;
+        f32 VarianceThreshold = 1e-4f;
+    };
+
+    // Instances with an opacity texture are alpha-tested by the rays, the others are traced as opaque geometry.
+    struct MeshMaterial {
+        u32 OpacityTexture = g_NoOpacityTexture;
+        f32 AlphaCutoff = 0.5f;
+    };
+
+    struct Mesh {
+        Renderer::GPUMeshBuffers Buffers;
+        u32 VertexCount;
+        u32 IndexCount;
+        u32 BottomLevelIndex;
+        // Identifies the mesh in m_MeshesByContentHash.
+        u64 Hash;
+
+        // Quantized meshes are drawn and built in normalized space, this brings them back to object space.
+        bool Quantized;
+        glm::vec4 DequantizationScale;
+        glm::vec4 DequantizationOffset;
+        glm::mat4 Dequantization;
+    };
+
+    // Matches ray_shadow_quantized.vert, the full vertex layout ignores it.
+    struct DrawPushConstants {
+        glm::vec4 DequantizationScale;
+        glm::vec4 DequantizationOffset;
+    };
+
+    struct MeshInstance {
+        u32 MeshIndex;
+        glm::mat4 Transform;
+        MeshMaterial Material;
+        u8 Layers;
+    };
+
+    // Matches input_structures.glsl, std140 pads the vec3 members to 16 bytes.
+    struct GlobalUniform {
+        glm::mat4 View;
+        glm::mat4 Projection;
+        // Of the previous frame, the raster pass derives the motion vectors from it.
+        glm::mat4 PreviousViewProjection;
+        glm::vec4 CameraPosition;
+        // w: radius of the spherical light, 0 for a point light.
+        glm::vec4 LightPosition;
+        // Cull masks of the shadow, ambient occlusion and camera rays.
+        glm::uvec4 RayMasks;
+        u32 AlphaTestedInstanceCount;
+        // Offsets the sample sequence, every frame traces a different set of directions.
+        u32 FrameIndex;
+        u32 AmbientOcclusionSampleCount;
+        f32 AmbientOcclusionRayDistance;
+        u32 AmbientOcclusionMinSampleCount;
+        u32 AmbientOcclusionMaxSampleCount;
+        f32 AmbientOcclusionVarianceThreshold;
+        // Whether the history image holds the previous frame, found through PreviousViewProjection.
+        u32 HistoryValid;
+        glm::uvec2 DrawExtent;
+        u32 Padding[2];
+    };
+
+    // Matches accumulate.comp.
+    struct AccumulationPushConstants {
+        glm::uvec2 Extent;
+        u32 HistoryValid;
+        u32 MaxHistoryLength;
+    };
+
+    // Matches input_structures.glsl, what the raster pass needs to place an instance and what the rays need to alpha
+    // test the instance they hit.
+    struct InstanceData {
+        glm::mat4 Transform;
+        VkDeviceAddress VertexBufferAddress;
+        VkDeviceAddress IndexBufferAddress;
+        u32 OpacityTexture;
+        f32 AlphaCutoff;
+        u32 Quantized;
+        u32 Padding;
+    };
     
     class RayQueryRenderer {
     public:        
@@ -23,15 +152,155 @@ namespace Raytracer {
         
         RayQueryRenderer& operator=(const RayQueryRenderer&) = delete;
         RayQueryRenderer& operator=(RayQueryRenderer&&) = delete;
-        
+
+        // Uploads an RGBA8 texture whose alpha channel is the opacity of the meshes using it. Returns
+        // g_NoOpacityTexture once every slot is taken.
+        u32 AddOpacityTexture(const void* texels, VkExtent2D extent);
+        // Uploads a block-compressed texture with its prebuilt mips, see Scene::LoadKtx2. Single channel BC4 textures
+        // hold the opacity in their red channel. Returns g_NoOpacityTexture when the device lacks BC support.
+        u32 AddOpacityTexture(const Scene::TextureData& texture);
+        // Uploads the mesh and queues its BLAS, it is built with the rest of the scene. Identical meshes are only
+        // uploaded once, the index of the existing mesh is returned.
+        u32 AddMesh(std::span<const Renderer::Vertex> vertices, std::span<const u32> indices);
+        // Instances of the same mesh share its buffers and BLAS whatever their material.
+        u32 AddInstance(u32 meshIndex, const glm::mat4& transform, const MeshMaterial& material = {},
+                        u8 layers = InstanceLayer::All);
+        // Same as AddMesh for one mesh of a cooked scene, without reading the geometry: the streams are copied from the
+        // mapping into staging memory. Cooked meshes always use the full vertex layout.
+        u32 AddCookedMesh(const Scene::CookedScene& scene, usize cookedMeshIndex);
+        // Removes every instance. The meshes and their BLAS stay resident until ReleaseUnusedMeshes, the next scene
+        // reuses the ones it shares with the previous one.
+        void ClearInstances();
+        // Releases the meshes, their BLAS and the opacity textures no instance references anymore, once the frames in
+        // flight are done with them. Their slots are reused by the meshes and textures added afterward.
+        void ReleaseUnusedMeshes();
+        // Moving instances only refits the TLAS on the next frame, see AccelerationStructureManager::UpdateTopLevel.
+        void SetInstanceTransform(u32 instanceIndex, const glm::mat4& transform);
+
+        // Records the TLAS update, the shading pass, the accumulation and the denoiser into the frame command buffer.
+        // The result is written to the renderer's draw image.
+        void Render(VkCommandBuffer commandBuffer);
+
+        // Moving or resizing the light restarts the accumulation.
+        inline void SetLightPosition(const glm::vec3& lightPosition);
+        inline void SetLightRadius(f32 lightRadius);
+        inline void SetAmbientOcclusionSettings(const AmbientOcclusionSettings& settings);
+        inline void SetDenoiserSettings(const DenoiserSettings& settings);
+        // Meshes added afterward use the compressed vertex layout, about half the memory of the full one.
+        inline void SetVertexQuantizationEnabled(bool enabled);
+        // Most meshes don't change between runs, their BLAS are then cached across launches in the directory.
+        inline void EnableBottomLevelCache(const std::filesystem::path& directory);
+        // Compacted BLAS take less memory, at the cost of a size readback and a copy once each batch is built.
+        inline void SetBottomLevelCompactionEnabled(bool enabled);
+
+        [[nodiscard]] inline VkDescriptorSetLayout GetSceneDescriptorLayout() const;
+        [[nodiscard]] inline const glm::vec3& GetLightPosition() const;
+        [[nodiscard]] inline f32 GetLightRadius() const;
+        [[nodiscard]] inline const AmbientOcclusionSettings& GetAmbientOcclusionSettings() const;
+        [[nodiscard]] inline const DenoiserSettings& GetDenoiserSettings() const;
+        [[nodiscard]] inline bool IsVertexQuantizationEnabled() const;
+        // Every BLAS is built and the TLAS of the last rendered frame holds every instance.
+        [[nodiscard]] inline bool IsSceneBuilt() const;
+        // Frames rendered since the camera, the light or the scene last changed.
+        [[nodiscard]] inline u32 GetAccumulatedFrameCount() const;
 
     private:
         Renderer::VulkanRenderer* m_Renderer;
+        Camera& m_Camera;
         
         DeletionQueue m_DeletionQueue;
 
-        Renderer::DescriptorAllocatorGrowable m_DescriptorAllocator;
-        
+        VkDescriptorSetLayout m_SceneDescriptorLayout;
+
+        VkPipelineLayout m_PipelineLayout;
+        VkPipeline m_Pipeline;
+        VkPipeline m_QuantizedPipeline;
+
+        Renderer::AllocatedImage m_DepthImage;
+
+        // AO and light visibility traced by the current frame. A compute pass blends them with the history of the
+        // previous frame, reprojected through the motion vectors, then the denoiser filters and shades the result.
+        // The normals, depths and accumulations alternate between two images, the previous ones being the history.
+        Renderer::AllocatedImage m_LightingImage;
+        Renderer::AllocatedImage m_MotionImage;
+        Renderer::AllocatedImage m_NormalDepthImages[2];
+        Renderer::AllocatedImage m_AccumulationImages[2];
+        VkDescriptorSetLayout m_AccumulationDescriptorLayout;
+        VkPipelineLayout m_AccumulationPipelineLayout;
+        VkPipeline m_AccumulationPipeline;
+        // Images written by the last rendered frame.
+        u32 m_HistoryIndex = 0;
+        // Reprojection can't tell when the lighting itself changed, the light and the scene discard the history.
+        bool m_HistoryValid = false;
+        u32 m_AccumulatedFrameCount = 0;
+        u32 m_FrameIndex = 0;
+        glm::mat4 m_PreviousViewProjection{0.f};
+        VkExtent2D m_PreviousExtent{};
+
+        Denoiser m_Denoiser;
+
+        // Unused opacity texture slots point to the fully opaque default texture.
+        VkSampler m_OpacitySampler;
+        Renderer::AllocatedImage m_DefaultOpacityTexture;
+        std::vector<Renderer::AllocatedImage> m_OpacityTextures;
+        std::vector<u32> m_FreeOpacityTextures;
+
+        Renderer::AccelerationStructureManager m_AccelerationStructures;
+
+        // Instances of the same mesh are drawn in a single instanced draw.
+        struct DrawBatch {
+            u32 MeshIndex;
+            u32 FirstInstance;
+            u32 InstanceCount;
+        };
+
+        std::vector<Mesh> m_Meshes;
+        std::unordered_map<u64, u32> m_MeshesByContentHash;
+        // Slots of released meshes, their buffers are null.
+        std::vector<u32> m_FreeMeshes;
+        // Buffers of released meshes wait for the BLAS builds submitted before the release, which may still read them.
+        struct ReleasedMeshBuffers {
+            u64 ComputeTicket;
+            Renderer::GPUMeshBuffers Buffers;
+        };
+        std::vector<ReleasedMeshBuffers> m_ReleasedMeshBuffers;
+        std::vector<MeshInstance> m_Instances;
+        std::vector<Renderer::AccelerationStructureInstance> m_AccelerationStructureInstances;
+        std::vector<DrawBatch> m_DrawBatches;
+        std::vector<u32> m_DrawInstanceIndices;
+        bool m_InstancesDirty = false;
+        // Instances were added or removed, or BLAS became ready, since the last TLAS build. Refitting can't follow.
+        bool m_InstanceTopologyDirty = false;
+        u32 m_AlphaTestedInstanceCount = 0;
+
+        glm::vec3 m_LightPosition{0.f, 10.f, 0.f};
+        f32 m_LightRadius = g_DefaultLightRadius;
+        AmbientOcclusionSettings m_AmbientOcclusionSettings;
+        bool m_VertexQuantizationEnabled = false;
+
+        void InitializeDescriptors();
+        void InitializePipeline();
+        void InitializeDepthImage();
+        void InitializeAccumulation();
+        void InitializeOpacityTextures();
+
+        // Takes ownership of an uploaded opacity texture and returns its slot.
+        u32 RegisterOpacityTexture(const Renderer::AllocatedImage& texture);
+
+        [[nodiscard]] static u64 GetMeshHash(u64 contentHash, bool quantized);
+        // Geometry of the mesh buffers, without content hash.
+        [[nodiscard]] static Renderer::BottomLevelGeometry MakeBottomLevelGeometry(const Mesh& mesh);
+        [[nodiscard]] std::optional<u32> FindMesh(u64 meshHash, usize vertexCount, usize indexCount) const;
+        // Queues the BLAS of an uploaded mesh and takes ownership of its buffers, released by ReleaseUnusedMeshes.
+        u32 RegisterMesh(const Mesh& mesh, u64 meshHash, u64 positionHash);
+
+        void GatherAccelerationStructureInstances();
+        void BuildDrawBatches();
+        [[nodiscard]] GlobalUniform MakeGlobalUniform();
+        [[nodiscard]] VkDescriptorSet WriteSceneDescriptorSet(const GlobalUniform& globalUniform);
+
+        void RenderLighting(VkCommandBuffer commandBuffer, VkDescriptorSet sceneDescriptorSet);
+        void AccumulateLighting(VkCommandBuffer commandBuffer);
     };
 }
 
@@ -5,4 +5,78 @@
 #pragma once
 
 namespace Raytracer {
+    inline void RayQueryRenderer::SetLightPosition(const glm::vec3& lightPosition) {
+        if (lightPosition != m_LightPosition) {
+            m_LightPosition = lightPosition;
+            m_HistoryValid = false;
+            m_AccumulatedFrameCount = 0;
+        }
+    }
+
+    inline void RayQueryRenderer::SetLightRadius(const f32 lightRadius) {
+        if (lightRadius != m_LightRadius) {
+            m_LightRadius = lightRadius;
+            m_HistoryValid = false;
+            m_AccumulatedFrameCount = 0;
+        }
+    }
+
+    inline void RayQueryRenderer::SetAmbientOcclusionSettings(const AmbientOcclusionSettings& settings) {
+        // The sample counts only change the noise, the ray distance changes what converges.
+        if (settings.RayDistance != m_AmbientOcclusionSettings.RayDistance) {
+            m_HistoryValid = false;
+            m_AccumulatedFrameCount = 0;
+        }
+
+        m_AmbientOcclusionSettings = settings;
+    }
+
+    inline void RayQueryRenderer::SetDenoiserSettings(const DenoiserSettings& settings) {
+        m_Denoiser.SetSettings(settings);
+    }
+
+    inline void RayQueryRenderer::SetVertexQuantizationEnabled(const bool enabled) {
+        m_VertexQuantizationEnabled = enabled;
+    }
+
+    inline void RayQueryRenderer::EnableBottomLevelCache(const std::filesystem::path& directory) {
+        m_AccelerationStructures.EnableBottomLevelCache(directory);
+    }
+
+    inline void RayQueryRenderer::SetBottomLevelCompactionEnabled(const bool enabled) {
+        m_AccelerationStructures.SetCompactionEnabled(enabled);
+    }
+
+    inline VkDescriptorSetLayout RayQueryRenderer::GetSceneDescriptorLayout() const {
+        return m_SceneDescriptorLayout;
+    }
+
+    inline const glm::vec3& RayQueryRenderer::GetLightPosition() const {
+        return m_LightPosition;
+    }
+
+    inline f32 RayQueryRenderer::GetLightRadius() const {
+        return m_LightRadius;
+    }
+
+    inline const AmbientOcclusionSettings& RayQueryRenderer::GetAmbientOcclusionSettings() const {
+        return m_AmbientOcclusionSettings;
+    }
+
+    inline const DenoiserSettings& RayQueryRenderer::GetDenoiserSettings() const {
+        return m_Denoiser.GetSettings();
+    }
+
+    inline bool RayQueryRenderer::IsVertexQuantizationEnabled() const {
+        return m_VertexQuantizationEnabled;
+    }
+
+    inline bool RayQueryRenderer::IsSceneBuilt() const {
+        return !m_AccelerationStructures.HasPendingBuilds() && !m_AccelerationStructures.HasInFlightBuilds() &&
+               !m_InstancesDirty;
+    }
+
+    inline u32 RayQueryRenderer::GetAccumulatedFrameCount() const {
+        return m_AccumulatedFrameCount;
+    }
 }
@@ -0,0 +1,109 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <Raytracer/RaytracerApp/RayQueryRenderer.hpp>
+
+#include <Raytracer/Scene/CookedScene.hpp>
+#include <Raytracer/Scene/ProceduralScene.hpp>
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace Raytracer {
+    // Mesh data handed to the upload service per frame while a scene streams in, half of the staging ring so that
+    // a frame never waits for the previous one's uploads.
+    constexpr usize g_StreamingUploadBudget = 32ull << 20;
+
+    // Loads scenes while frames keep going. The file reads and the decode run on a loader thread, Update then hands
+    // the decoded meshes to the upload path a budget at a time. Instances are placed as soon as their mesh is uploaded
+    // and join the TLAS once their BLAS is built, until then they are simply absent from the frame.
+    class SceneStreamer {
+    public:
+        explicit SceneStreamer(RayQueryRenderer& rayQueryRenderer);
+        ~SceneStreamer() = default;
+
+        SceneStreamer(const SceneStreamer&) = delete;
+        SceneStreamer(SceneStreamer&&) = delete;
+
+        SceneStreamer& operator=(const SceneStreamer&) = delete;
+        SceneStreamer& operator=(SceneStreamer&&) = delete;
+
+        // The scene replaces the current one once decoded, a load still in progress is abandoned.
+        void RequestScene(const std::filesystem::path& path);
+        // Same as RequestScene, the scene is generated on the loader thread instead of read from disk.
+        void RequestGeneratedScene(const Scene::ProceduralSceneSettings& settings);
+
+        // Called once per frame, before rendering. Uploads at most g_StreamingUploadBudget bytes of meshes.
+        void Update();
+
+        [[nodiscard]] inline bool IsLoading() const;
+        // The last requested scene was streamed in whole and has instances. False while it loads, once it failed to
+        // load, or when nothing was requested.
+        [[nodiscard]] inline bool HasScene() const;
+        // Fraction of the meshes of the scene being streamed that were uploaded.
+        [[nodiscard]] inline f32 GetProgress() const;
+
+    private:
+        // Meshes come from either an imported or generated scene, or a cooked one. The instances are grouped by mesh so
+        // that each mesh places its own right after its upload.
+        struct DecodedScene {
+            u64 Generation = 0;
+            // Generated scenes have no path.
+            std::filesystem::path Path;
+            std::optional<Scene::ProceduralSceneSettings> Procedural;
+            // For the logs.
+            std::string Name;
+            std::chrono::high_resolution_clock::time_point RequestTime;
+
+            std::unique_ptr<Scene::SceneDescription> Description;
+            std::unique_ptr<Scene::CookedScene> Cooked;
+
+            std::vector<u32> MeshInstanceOffsets;
+            std::vector<u32> MeshInstances;
+            // Renderer index of each texture of the description, uploaded along with the first mesh using it.
+            std::vector<std::optional<u32>> OpacityTextures;
+        };
+
+        RayQueryRenderer& m_RayQueryRenderer;
+
+        // Shared with the loader thread.
+        std::mutex m_Mutex;
+        std::condition_variable_any m_RequestCondition;
+        std::optional<DecodedScene> m_Request;
+        std::optional<DecodedScene> m_Decoded;
+
+        // Main thread only.
+        u64 m_Generation = 0;
+        bool m_Loading = false;
+        bool m_HasScene = false;
+        std::optional<DecodedScene> m_Streaming;
+        usize m_NextMesh = 0;
+
+        // Declared last, the thread is joined before the members it uses are destroyed.
+        std::jthread m_LoaderThread;
+
+        void Request(DecodedScene&& request);
+        void RunLoader(const std::stop_token& stopToken);
+        [[nodiscard]] static bool Decode(DecodedScene& scene);
+
+        [[nodiscard]] usize GetMeshCount() const;
+        // Uploads one mesh of the streamed scene, places its instances and returns the size of its data.
+        usize StreamMesh(usize meshIndex);
+        // Returns the renderer index of a texture of the streamed description, adding its size when it gets uploaded.
+        u32 StreamOpacityTexture(u32 textureIndex, usize& inOutStreamedSize);
+    };
+}
+
+#include <Raytracer/RaytracerApp/SceneStreamer.inl>
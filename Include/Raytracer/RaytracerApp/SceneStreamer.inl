@@ -0,0 +1,24 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+namespace Raytracer {
+    inline bool SceneStreamer::IsLoading() const {
+        return m_Loading;
+    }
+
+    inline bool SceneStreamer::HasScene() const {
+        return m_HasScene;
+    }
+
+    inline f32 SceneStreamer::GetProgress() const {
+        if (!m_Streaming) {
+            return 0.f;
+        }
+
+        const usize meshCount = GetMeshCount();
+        return meshCount == 0 ? 1.f : static_cast<f32>(m_NextMesh) / static_cast<f32>(meshCount);
+    }
+}
@@ -0,0 +1,215 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/BottomLevelCache.hpp>
+#include <Raytracer/Renderer/ScratchBufferArena.hpp>
+#include <Raytracer/Renderer/VulkanRenderer.hpp>
+
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <unordered_map>
+
+namespace Raytracer::Renderer {
+    // BLAS builds that don't fit in the scratch arena are split across several submissions.
+    constexpr VkDeviceSize g_ScratchBlockSize = 32ull * 1024 * 1024;
+    constexpr u32 g_MaxScratchBlocks = 4;
+
+    // A refitted TLAS is rebuilt after this many refits, or once an instance drifted further than the drift times the
+    // extent of the instances at the last rebuild.
+    constexpr u32 g_MaxTopLevelUpdates = 256;
+    constexpr f32 g_MaxInstanceDrift = 0.25f;
+
+    // Triangle geometry a bottom level acceleration structure is built from. Indices are always u32.
+    struct BottomLevelGeometry {
+        VkDeviceAddress VertexAddress;
+        VkDeviceSize VertexStride;
+        VkFormat VertexFormat;
+        u32 VertexCount;
+
+        VkDeviceAddress IndexAddress;
+        u32 IndexCount;
+
+        // Hash of the vertex and index data, used to share identical BLAS and as the BLAS cache key. 0 if the BLAS
+        // must neither be shared nor cached.
+        u64 ContentHash = 0;
+
+        // Upload service ticket of the vertex and index data, the build waits for it on the compute queue.
+        u64 UploadTicket = 0;
+    };
+
+    struct AccelerationStructureInstance {
+        u32 BottomLevelIndex;
+        glm::mat4 Transform;
+        u32 CustomIndex;
+        u8 Mask;
+        // BLAS geometry is built non-opaque so that it can be shared by alpha-tested and opaque instances, the latter
+        // never produce candidate intersections.
+        bool Opaque = true;
+    };
+
+    class AccelerationStructureManager {
+    public:
+        explicit AccelerationStructureManager(VulkanRenderer* renderer);
+        ~AccelerationStructureManager();
+
+        AccelerationStructureManager(const AccelerationStructureManager&) = delete;
+        AccelerationStructureManager(AccelerationStructureManager&&) = delete;
+
+        AccelerationStructureManager& operator=(const AccelerationStructureManager&) = delete;
+        AccelerationStructureManager& operator=(AccelerationStructureManager&&) = delete;
+
+        // Queues a BLAS build and returns the index of the BLAS. Nothing is recorded until BuildBottomLevels.
+        // Geometry with the content hash of an existing BLAS gets the index of that BLAS instead.
+        [[nodiscard]] u32 AddBottomLevel(const BottomLevelGeometry& geometry);
+        // Drops a reference returned by AddBottomLevel. The last one releases the BLAS once the frames in flight and
+        // the compute queue are done with it, AddBottomLevel may then reuse its index.
+        void RemoveBottomLevel(u32 index);
+        // Points the queued build of a shared BLAS at another copy of its geometry, before the buffers it was reading
+        // are released. Builds already submitted are left alone.
+        void RetargetPendingBuild(u32 index, const BottomLevelGeometry& geometry);
+
+        // Submits as many queued BLAS as the scratch arena holds to the compute queue, in a single
+        // vkCmdBuildAccelerationStructuresKHR call. Never waits: the rest stay queued for a later call, once the batch
+        // is done with the arena. See PollBottomLevels for the builds themselves.
+        void BuildBottomLevels();
+        // Compacts the finished batches when enabled, and returns how many BLAS became ready to be instanced since the
+        // last call.
+        [[nodiscard]] u32 PollBottomLevels();
+        // Records the TLAS build into the frame command buffer. The TLAS is refitted in place when only the transforms
+        // changed, and rebuilt when instances were added, removed or changed BLAS, mask or flags, when the caller
+        // reports a topology change, or when the refitted tree degraded too much.
+        // Returns true if the TLAS handle changed and descriptors referencing it must be rewritten.
+        bool UpdateTopLevel(VkCommandBuffer commandBuffer, std::span<const AccelerationStructureInstance> instances,
+                            bool topologyChanged);
+
+        // When enabled, every BLAS is copied into a right-sized buffer once its batch is built. Applies to the batches
+        // submitted afterward.
+        inline void SetCompactionEnabled(bool enabled);
+        // BLAS with a content hash are then loaded from the cache directory instead of being built, and serialized into
+        // it once built.
+        void EnableBottomLevelCache(const std::filesystem::path& directory);
+
+        [[nodiscard]] inline VkAccelerationStructureKHR GetTopLevel() const;
+        [[nodiscard]] inline bool IsBottomLevelReady(u32 index) const;
+        [[nodiscard]] inline bool HasPendingBuilds() const;
+        // Batches submitted to the compute queue whose BLAS aren't ready yet, compaction included.
+        [[nodiscard]] inline bool HasInFlightBuilds() const;
+        // The last batch submitted by BuildBottomLevels is still building from the scratch arena on the compute queue,
+        // until then BuildBottomLevels submits nothing.
+        [[nodiscard]] bool IsScratchArenaInUse() const;
+
+    private:
+        struct PendingBuild {
+            u32 BottomLevelIndex;
+            BottomLevelGeometry Geometry;
+        };
+
+        // Builds submitted together to the compute queue, followed by their compaction copy. Batches loaded from the
+        // cache have no content hashes, as they don't need to be serialized again.
+        struct BottomLevelBatch {
+            u64 Ticket;
+            std::vector<u32> BottomLevelIndices;
+            std::vector<u64> ContentHashes;
+            VkQueryPool CompactedSizeQueryPool;
+            std::vector<AllocatedAccelerationStructure> UncompactedBottomLevels;
+            std::vector<AllocatedBuffer> StagingBuffers;
+        };
+
+        // Serialization of the BLAS of a finished batch: a serialization size query, then the copy to host memory.
+        struct SerializationBatch {
+            u64 Ticket;
+            std::vector<u32> BottomLevelIndices;
+            std::vector<u64> ContentHashes;
+            VkQueryPool SerializationSizeQueryPool;
+            std::vector<AllocatedBuffer> ReadbackBuffers;
+            std::vector<VkDeviceSize> ReadbackOffsets;
+            std::vector<VkDeviceSize> SerializedSizes;
+        };
+
+        void DeserializeBottomLevels();
+        void SubmitBottomLevelBatch(std::span<const VkAccelerationStructureBuildGeometryInfoKHR> buildInfos,
+                                    std::span<const VkAccelerationStructureBuildRangeInfoKHR* const> buildRangePointers,
+                                    std::span<const u32> bottomLevelIndices, std::span<const u64> contentHashes,
+                                    std::span<const VkSemaphoreSubmitInfo> waitSemaphores);
+        void CompactBottomLevels(BottomLevelBatch& batch);
+        void SerializeBottomLevels(const BottomLevelBatch& batch);
+        void PollSerializations();
+        void ReadBackSerializedBottomLevels(SerializationBatch& batch);
+        void StoreSerializedBottomLevels(const SerializationBatch& batch);
+        [[nodiscard]] bool IsBottomLevelInFlight(u32 index) const;
+        void ReleaseBottomLevel(u32 index);
+
+        void WriteInstances(std::span<const AccelerationStructureInstance> instances, u32 frameIndex);
+        [[nodiscard]] bool HasTopLevelTopologyChanged(std::span<const AccelerationStructureInstance> instances) const;
+        [[nodiscard]] bool HasTopLevelDegraded(std::span<const AccelerationStructureInstance> instances) const;
+        void RecordTopLevelRebuild(std::span<const AccelerationStructureInstance> instances);
+        void ReserveTopLevelScratch(VkDeviceSize size);
+
+        [[nodiscard]] AllocatedAccelerationStructure CreateAccelerationStructure(
+            VkAccelerationStructureTypeKHR type, VkDeviceSize size) const;
+
+        // Scratch buffers are over-allocated so that the returned address honors the scratch offset alignment.
+        [[nodiscard]] AllocatedBuffer CreateScratchBuffer(VkDeviceSize size, VkDeviceAddress* outAlignedAddress) const;
+        // Host visible buffer holding serialized acceleration structure data, whose address must be 256 bytes aligned.
+        [[nodiscard]] AllocatedBuffer CreateSerializationBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                                                VmaMemoryUsage memoryUsage,
+                                                                VkDeviceAddress* outAlignedAddress,
+                                                                VkDeviceSize* outAlignedOffset) const;
+
+        VulkanRenderer* m_Renderer;
+
+        std::vector<AllocatedAccelerationStructure> m_BottomLevels;
+        std::vector<bool> m_BottomLevelsReady;
+        std::vector<u32> m_BottomLevelReferenceCounts;
+        std::vector<u64> m_BottomLevelContentHashes;
+        std::unordered_map<u64, u32> m_BottomLevelsByContentHash;
+        std::vector<u32> m_FreeBottomLevels;
+        // Removed BLAS still read by a batch or a serialization on the compute queue.
+        std::vector<u32> m_PendingRemovals;
+        std::vector<PendingBuild> m_PendingBuilds;
+        std::deque<BottomLevelBatch> m_InFlightBatches;
+
+        ScratchBufferArena m_ScratchArena;
+        u64 m_ScratchArenaTicket = 0;
+
+        std::unique_ptr<BottomLevelCache> m_BottomLevelCache;
+        std::deque<SerializationBatch> m_InFlightSerializations;
+
+        AllocatedAccelerationStructure m_TopLevel{};
+        u32 m_TopLevelInstanceCount = 0;
+
+        // Frames in flight may still be building from their instance buffer, so each frame has its own.
+        AllocatedBuffer m_InstanceBuffers[g_FrameOverlap]{};
+        usize m_InstanceBufferCapacities[g_FrameOverlap]{};
+
+        // TLAS builds are serialized by barriers, so a single scratch buffer is shared by every frame.
+        AllocatedBuffer m_TopLevelScratchBuffer{};
+        VkDeviceSize m_TopLevelScratchSize = 0;
+        VkDeviceAddress m_TopLevelScratchAddress = 0;
+
+        // What a refit can't change, per instance of the last rebuild.
+        struct InstanceTopology {
+            VkDeviceAddress BottomLevelAddress;
+            u32 CustomIndex;
+            u8 Mask;
+            bool Opaque;
+
+            bool operator==(const InstanceTopology&) const = default;
+        };
+        std::vector<InstanceTopology> m_RebuildInstanceTopologies;
+
+        // Refit quality heuristic state.
+        u32 m_TopLevelUpdateCount = 0;
+        f32 m_RebuildInstanceExtent = 0.f;
+        std::vector<glm::vec3> m_RebuildInstanceTranslations;
+
+        bool m_CompactionEnabled = true;
+    };
+
+#include <Raytracer/Renderer/AccelerationStructureManager.inl>
+}
@@ -0,0 +1,25 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+inline void AccelerationStructureManager::SetCompactionEnabled(const bool enabled) {
+    m_CompactionEnabled = enabled;
+}
+
+inline VkAccelerationStructureKHR AccelerationStructureManager::GetTopLevel() const {
+    return m_TopLevel.Handle;
+}
+
+inline bool AccelerationStructureManager::IsBottomLevelReady(const u32 index) const {
+    return m_BottomLevelsReady[index];
+}
+
+inline bool AccelerationStructureManager::HasPendingBuilds() const {
+    return !m_PendingBuilds.empty();
+}
+
+inline bool AccelerationStructureManager::HasInFlightBuilds() const {
+    return !m_InFlightBatches.empty();
+}
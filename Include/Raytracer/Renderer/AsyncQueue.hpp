@@ -0,0 +1,61 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/VulkanWrapper/Device.hpp>
+
+#include <deque>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace Raytracer::Renderer {
+    // Submits work to a secondary queue without blocking the frame loop. Every submission signals the next value of a
+    // timeline semaphore, which is returned as a ticket to poll or wait for its completion.
+    class AsyncQueue {
+    public:
+        AsyncQueue(const VulkanWrapper::Device& device, VkQueue queue, u32 queueFamilyIndex);
+        ~AsyncQueue();
+
+        AsyncQueue(const AsyncQueue&) = delete;
+        AsyncQueue(AsyncQueue&&) = delete;
+
+        AsyncQueue& operator=(const AsyncQueue&) = delete;
+        AsyncQueue& operator=(AsyncQueue&&) = delete;
+
+        [[nodiscard]] u64 Submit(const std::function<void(VkCommandBuffer commandBuffer)>& function,
+                                 std::span<const VkSemaphoreSubmitInfo> waitSemaphores = {});
+
+        [[nodiscard]] bool IsComplete(u64 ticket) const;
+        void Wait(u64 ticket) const;
+
+        // Recycles the command buffers of the submissions the GPU is done with.
+        void CollectCompleted();
+
+        [[nodiscard]] inline VkSemaphore GetTimelineSemaphore() const;
+        [[nodiscard]] inline u64 GetLastSubmittedTicket() const;
+        [[nodiscard]] inline u32 GetQueueFamilyIndex() const;
+
+    private:
+        struct Submission {
+            VkCommandBuffer CommandBuffer;
+            u64 Ticket;
+        };
+
+        const VulkanWrapper::Device& m_Device;
+
+        VkQueue m_Queue;
+        u32 m_QueueFamilyIndex;
+
+        VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+        VkSemaphore m_TimelineSemaphore = VK_NULL_HANDLE;
+        u64 m_LastSubmittedTicket = 0;
+
+        std::deque<Submission> m_InFlightSubmissions;
+        std::vector<VkCommandBuffer> m_FreeCommandBuffers;
+    };
+
+#include <Raytracer/Renderer/AsyncQueue.inl>
+}
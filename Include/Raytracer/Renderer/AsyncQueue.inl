@@ -0,0 +1,17 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+inline VkSemaphore AsyncQueue::GetTimelineSemaphore() const {
+    return m_TimelineSemaphore;
+}
+
+inline u64 AsyncQueue::GetLastSubmittedTicket() const {
+    return m_LastSubmittedTicket;
+}
+
+inline u32 AsyncQueue::GetQueueFamilyIndex() const {
+    return m_QueueFamilyIndex;
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/VulkanWrapper/Device.hpp>
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace Raytracer::Renderer {
+    // On-disk cache of serialized BLAS, as written by vkCmdCopyAccelerationStructureToMemoryKHR. Entries are keyed by
+    // the content hash of the mesh and the driver UUID, and checked with vkGetDeviceAccelerationStructureCompatibilityKHR
+    // before being handed out, so a driver update only costs a rebuild.
+    class BottomLevelCache {
+    public:
+        BottomLevelCache(const VulkanWrapper::Device& device, std::filesystem::path directory);
+        ~BottomLevelCache() = default;
+
+        BottomLevelCache(const BottomLevelCache&) = delete;
+        BottomLevelCache(BottomLevelCache&&) = delete;
+
+        BottomLevelCache& operator=(const BottomLevelCache&) = delete;
+        BottomLevelCache& operator=(BottomLevelCache&&) = delete;
+
+        // Returns false when there is no usable entry, incompatible or corrupted entries are removed.
+        [[nodiscard]] bool Load(u64 contentHash, std::vector<u8>& outSerializedData) const;
+        void Store(u64 contentHash, std::span<const u8> serializedData) const;
+
+        // Reads the acceleration structure size from the header the driver puts in front of the serialized data.
+        [[nodiscard]] static VkDeviceSize GetDeserializedSize(std::span<const u8> serializedData);
+
+        [[nodiscard]] inline const std::filesystem::path& GetDirectory() const;
+
+    private:
+        struct FileHeader {
+            u32 Magic;
+            u32 Version;
+            u64 ContentHash;
+            u64 DataSize;
+        };
+
+        [[nodiscard]] std::filesystem::path GetEntryPath(u64 contentHash) const;
+
+        const VulkanWrapper::Device& m_Device;
+
+        std::filesystem::path m_Directory;
+    };
+}
+
+#include <Raytracer/Renderer/BottomLevelCache.inl>
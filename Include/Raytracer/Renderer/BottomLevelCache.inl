@@ -0,0 +1,11 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+namespace Raytracer::Renderer {
+    inline const std::filesystem::path& BottomLevelCache::GetDirectory() const {
+        return m_Directory;
+    }
+}
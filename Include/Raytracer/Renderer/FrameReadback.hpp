@@ -0,0 +1,70 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/VulkanTypes.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Raytracer::Renderer {
+    // Writes images to disk without stalling the frame loop. The copy into a host-visible readback buffer is recorded
+    // into the frame command buffer, then worker threads convert and encode the pixels once the frame completed: PNG
+    // for 8-bit formats, EXR for float formats.
+    // The ring has one buffer per frame in flight plus one per worker, captures wait for a free buffer when the
+    // encoders can't keep up.
+    class FrameReadback {
+    public:
+        FrameReadback(VmaAllocator allocator, u32 framesInFlight, u32 workerCount);
+        // Waits for every capture handed to Encode to be written.
+        ~FrameReadback();
+
+        FrameReadback(const FrameReadback&) = delete;
+        FrameReadback(FrameReadback&&) = delete;
+
+        FrameReadback& operator=(const FrameReadback&) = delete;
+        FrameReadback& operator=(FrameReadback&&) = delete;
+
+        // Records the copy of the image, which must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL. The extension of the
+        // path is replaced by the one of the encoded format. Returns the readback buffer to hand to Encode once the
+        // command buffer completed.
+        [[nodiscard]] u32 RecordCapture(VkCommandBuffer commandBuffer, const AllocatedImage& image, VkExtent2D extent,
+                                        std::filesystem::path path);
+        void Encode(u32 slotIndex);
+
+        // Whether the format can be captured.
+        [[nodiscard]] static bool IsSupportedFormat(VkFormat format);
+
+    private:
+        struct Slot {
+            AllocatedBuffer Buffer{};
+            VkDeviceSize Capacity = 0;
+            VkFormat Format = VK_FORMAT_UNDEFINED;
+            VkExtent2D Extent{};
+            std::filesystem::path Path;
+        };
+
+        VmaAllocator m_Allocator;
+
+        std::vector<Slot> m_Slots;
+
+        // Shared with the workers.
+        std::mutex m_Mutex;
+        std::condition_variable_any m_EncodeCondition;
+        std::condition_variable m_SlotFreedCondition;
+        std::vector<u32> m_FreeSlots;
+        std::deque<u32> m_EncodeQueue;
+
+        // Declared last, the threads are joined before the members they use are destroyed.
+        std::vector<std::jthread> m_Workers;
+
+        void RunWorker(const std::stop_token& stopToken);
+        void WriteImage(const Slot& slot) const;
+    };
+}
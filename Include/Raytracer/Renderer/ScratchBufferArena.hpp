@@ -0,0 +1,51 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/VulkanTypes.hpp>
+
+namespace Raytracer::Renderer {
+    class VulkanRenderer;
+
+    // Linear allocator for acceleration structure build scratch memory. Allocations are carved out of a few large
+    // device buffers, aligned to minAccelerationStructureScratchOffsetAlignment, and are all released at once by Reset
+    // once the fence of the batch using them has signaled.
+    class ScratchBufferArena {
+    public:
+        ScratchBufferArena(VulkanRenderer* renderer, VkDeviceSize blockSize, u32 maxBlocks);
+        ~ScratchBufferArena();
+
+        ScratchBufferArena(const ScratchBufferArena&) = delete;
+        ScratchBufferArena(ScratchBufferArena&&) = delete;
+
+        ScratchBufferArena& operator=(const ScratchBufferArena&) = delete;
+        ScratchBufferArena& operator=(ScratchBufferArena&&) = delete;
+
+        // Returns false when the current batch is full. The batch must then be submitted and the arena reset, after
+        // which any allocation succeeds.
+        [[nodiscard]] bool Allocate(VkDeviceSize size, VkDeviceAddress* outAddress);
+        void Reset();
+
+    private:
+        struct Block {
+            AllocatedBuffer Buffer;
+            VkDeviceAddress Address;
+            VkDeviceSize Capacity;
+        };
+
+        [[nodiscard]] bool AllocateFromBlock(usize blockIndex, VkDeviceSize size, VkDeviceAddress* outAddress);
+        void CreateBlock(usize blockIndex, VkDeviceSize capacity);
+
+        VulkanRenderer* m_Renderer;
+
+        VkDeviceSize m_BlockSize;
+        u32 m_MaxBlocks;
+        VkDeviceSize m_Alignment;
+
+        std::vector<Block> m_Blocks;
+        usize m_CurrentBlock = 0;
+        VkDeviceSize m_CurrentOffset = 0;
+    };
+}
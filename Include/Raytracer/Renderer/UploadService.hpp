@@ -0,0 +1,101 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/AsyncQueue.hpp>
+
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace Raytracer::Renderer {
+    // Streams buffer and image data to the GPU through a persistently mapped staging ring. Copies are queued until
+    // Flush, which records all of them into a single submission on the transfer queue. Every upload returns the ticket
+    // of the submission it belongs to, signaled on the transfer queue timeline once the data is in place.
+    // The destinations must be shared with the transfer queue family, see Device::GetSharedQueueFamilyIndices.
+    class UploadService {
+    public:
+        UploadService(const VulkanWrapper::Device& device, VmaAllocator allocator, VkDeviceSize stagingRingSize);
+        ~UploadService();
+
+        UploadService(const UploadService&) = delete;
+        UploadService(UploadService&&) = delete;
+
+        UploadService& operator=(const UploadService&) = delete;
+        UploadService& operator=(UploadService&&) = delete;
+
+        [[nodiscard]] u64 UploadBuffer(std::span<const std::byte> data, VkBuffer destination,
+                                       VkDeviceSize destinationOffset = 0);
+        // The regions offsets are relative to the start of the data. The image goes from undefined to finalLayout.
+        [[nodiscard]] u64 UploadImage(std::span<const std::byte> data, VkImage destination,
+                                      std::span<const VkBufferImageCopy> regions, u32 mipLevels,
+                                      VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // Submits the queued copies, does nothing if there are none.
+        void Flush();
+
+        [[nodiscard]] bool IsComplete(u64 ticket) const;
+        // Flushes first if the ticket is still queued.
+        void Wait(u64 ticket);
+
+        [[nodiscard]] inline VkSemaphore GetTimelineSemaphore() const;
+        [[nodiscard]] inline u64 GetLastSubmittedTicket() const;
+
+    private:
+        struct StagingAllocation {
+            VkBuffer Buffer;
+            VkDeviceSize Offset;
+            std::byte* Data;
+        };
+
+        // Ring regions are released in order, once the GPU is done with the submission that read them.
+        struct RingRegion {
+            VkDeviceSize Offset;
+            VkDeviceSize Size;
+            u64 Ticket;
+        };
+
+        // Uploads larger than the ring get their own staging buffer.
+        struct DedicatedStaging {
+            AllocatedBuffer Buffer;
+            u64 Ticket;
+        };
+
+        struct PendingBufferCopy {
+            VkBuffer Source;
+            VkBuffer Destination;
+            VkBufferCopy Region;
+        };
+
+        struct PendingImageCopy {
+            VkBuffer Source;
+            VkImage Destination;
+            std::vector<VkBufferImageCopy> Regions;
+            u32 MipLevels;
+            VkImageLayout FinalLayout;
+        };
+
+        const VulkanWrapper::Device& m_Device;
+        VmaAllocator m_Allocator;
+
+        AsyncQueue m_Queue;
+
+        AllocatedBuffer m_StagingRing;
+        VkDeviceSize m_StagingRingSize;
+        VkDeviceSize m_RingHead = 0;
+        std::deque<RingRegion> m_RingRegions;
+        std::deque<DedicatedStaging> m_DedicatedStagings;
+
+        std::vector<PendingBufferCopy> m_PendingBufferCopies;
+        std::vector<PendingImageCopy> m_PendingImageCopies;
+
+        [[nodiscard]] u64 GetPendingTicket() const;
+        [[nodiscard]] StagingAllocation AllocateStaging(VkDeviceSize size);
+        [[nodiscard]] bool TryAllocateFromRing(VkDeviceSize size, VkDeviceSize& outOffset);
+        void ReleaseCompleted();
+    };
+
+#include <Raytracer/Renderer/UploadService.inl>
+}
@@ -0,0 +1,13 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+inline VkSemaphore UploadService::GetTimelineSemaphore() const {
+    return m_Queue.GetTimelineSemaphore();
+}
+
+inline u64 UploadService::GetLastSubmittedTicket() const {
+    return m_Queue.GetLastSubmittedTicket();
+}
@@ -0,0 +1,25 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Renderer/VulkanTypes.hpp>
+
+#include <span>
+#include <vector>
+
+namespace Raytracer::Renderer {
+    // Vertices in the quantized layout, position = DequantizationOffset + DequantizationScale * snorm position.
+    struct QuantizedMesh {
+        std::vector<QuantizedPosition> Positions;
+        std::vector<QuantizedAttributes> Attributes;
+        glm::vec3 DequantizationScale;
+        glm::vec3 DequantizationOffset;
+
+        [[nodiscard]] glm::mat4 GetDequantizationMatrix() const;
+    };
+
+    // Positions are normalized to the bounding box of the mesh, normals are octahedral encoded.
+    [[nodiscard]] QuantizedMesh QuantizeVertices(std::span<const Vertex> vertices);
+}
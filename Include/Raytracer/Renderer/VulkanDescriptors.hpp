@@ -13,7 +13,7 @@ namespace Raytracer::Renderer {
     struct DescriptorLayoutBuilder {
         std::vector<VkDescriptorSetLayoutBinding> Bindings;
 
-        void AddBinding(u32 binding, VkDescriptorType type);
+        void AddBinding(u32 binding, VkDescriptorType type, u32 count = 1);
         void Clear();
         [[nodiscard]] VkDescriptorSetLayout Build(VkDevice device, VkShaderStageFlags shaderStages,
                                                   const void* pNext = nullptr,
@@ -68,10 +68,12 @@ namespace Raytracer::Renderer {
     struct DescriptorWriter {
         std::deque<VkDescriptorImageInfo> ImageInfos;
         std::deque<VkDescriptorBufferInfo> BufferInfos;
+        std::deque<VkAccelerationStructureKHR> AccelerationStructures;
+        std::deque<VkWriteDescriptorSetAccelerationStructureKHR> AccelerationStructureInfos;
         std::vector<VkWriteDescriptorSet> Writes;
 
         void WriteImage(u32 binding, VkImageView imageView, VkSampler sampler, VkImageLayout layout,
-                        VkDescriptorType type);
+                        VkDescriptorType type, u32 arrayElement = 0);
         void WriteBuffer(u32 binding, VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset,
                          VkDescriptorType type);
         void WriteAccelerationStructure(u32 binding, VkAccelerationStructureKHR accelerationStructure);
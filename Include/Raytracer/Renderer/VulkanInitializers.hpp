@@ -6,6 +6,8 @@
 
 #include <Raytracer/Renderer/VulkanTypes.hpp>
 
+#include <span>
+
 namespace Raytracer::Renderer::VulkanInit {
     VkCommandPoolCreateInfo CommandPoolCreateInfo(u32 queueFamilyIndex, VkCommandPoolCreateFlags flags = 0);
     VkCommandBufferAllocateInfo CommandBufferAllocateInfo(VkCommandPool pool, u32 count = 1);
@@ -29,6 +31,9 @@ namespace Raytracer::Renderer::VulkanInit {
 
     VkRenderingInfo RenderingInfo(VkExtent2D renderExtent, const VkRenderingAttachmentInfo* colorAttachment,
                                   const VkRenderingAttachmentInfo* depthAttachment);
+    // The attachments must outlive the returned structure.
+    VkRenderingInfo RenderingInfo(VkExtent2D renderExtent, std::span<const VkRenderingAttachmentInfo> colorAttachments,
+                                  const VkRenderingAttachmentInfo* depthAttachment);
 
     VkImageSubresourceRange ImageSubresourceRange(VkImageAspectFlags aspectMask);
 
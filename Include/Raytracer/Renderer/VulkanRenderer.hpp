@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <Raytracer/Renderer/AsyncQueue.hpp>
+#include <Raytracer/Renderer/FrameReadback.hpp>
+#include <Raytracer/Renderer/UploadService.hpp>
+#include <Raytracer/Renderer/VertexQuantization.hpp>
 #include <Raytracer/Renderer/VulkanDescriptors.hpp>
 #include <Raytracer/Renderer/VulkanWrapper/Swapchain.hpp>
 
@@ -11,9 +15,14 @@
 
 #include <VkBootstrap.h>
 
+#include <filesystem>
+#include <optional>
+
 namespace Raytracer::Renderer {
 
     constexpr u32 g_FrameOverlap = 2;
+    constexpr VkDeviceSize g_UploadStagingRingSize = 64ull << 20;
+    constexpr u32 g_CaptureEncoderCount = 2;
 
     struct FrameData {
         VkCommandPool CommandPool;
@@ -38,11 +47,20 @@ namespace Raytracer::Renderer {
 
         VmaAllocator m_Allocator;
 
+        std::unique_ptr<AsyncQueue> m_ComputeQueue;
+        std::unique_ptr<UploadService> m_UploadService;
+        // Consumed by the next frame or immediate submission.
+        mutable std::vector<VkSemaphoreSubmitInfo> m_PendingWaitSemaphores;
+
+        std::unique_ptr<FrameReadback> m_FrameReadback;
+        std::optional<std::filesystem::path> m_PendingCapture;
+
         std::unique_ptr<VulkanWrapper::Swapchain> m_Swapchain;
         bool m_SwapchainResizeRequired{false};
 
         FrameData m_Frames[g_FrameOverlap];
         i32 m_FrameNumber = 0;
+        bool m_FrameRecording = false;
 
         VkFence m_ImmediateFence;
         VkCommandBuffer m_ImmediateCommandBuffer;
@@ -59,6 +77,8 @@ namespace Raytracer::Renderer {
         float RenderScale = 1.0f;
         
         VulkanRenderer(const Window& window, const DebugLevel& debugLevel);
+        // Headless renderer, without surface, swapchain nor ImGui. Frames only render into DrawImage.
+        VulkanRenderer(VkExtent2D extent, const DebugLevel& debugLevel);
         ~VulkanRenderer();
 
         VulkanRenderer(const VulkanRenderer&) = delete;
@@ -69,29 +89,73 @@ namespace Raytracer::Renderer {
 
         void PlanDescriptorPoolsDeletion(DescriptorAllocatorGrowable& allocator);
         void PlanDeletion(std::function<void()>&& deletor);
+        // Deletes the resource once the GPU is done with the frame currently being recorded.
+        void PlanFrameDeletion(std::function<void()>&& deletor);
 
         static void BeginUi();
         VkCommandBuffer BeginCommandBuffer(const Window& window);
         void EndCommandBuffer(Window& window);
+        // Headless frames, DrawImage is left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL once submitted.
+        VkCommandBuffer BeginCommandBuffer();
+        void EndCommandBuffer();
 
-        void ImmediateSubmit(const std::function<void(VkCommandBuffer commandBuffer)>& function) const;
+        // Writes DrawImage to disk once the frame being recorded completed, see FrameReadback. Nothing waits for the
+        // file to be written, a single capture is taken per frame.
+        void CaptureDrawImage(std::filesystem::path path);
 
+        void ImmediateSubmit(const std::function<void(VkCommandBuffer commandBuffer)>& function) const;
+        // Makes the next graphics queue submission wait for a timeline semaphore value, e.g. an async compute ticket.
+        void WaitOnNextSubmit(VkSemaphore timelineSemaphore, u64 value, VkPipelineStageFlags2 stageMask) const;
+        // Makes the next graphics queue submission wait for an upload service ticket. The uploads still queued are
+        // flushed right before that submission, so everything uploaded during a frame shares one transfer submission.
+        void WaitForUpload(u64 ticket) const;
+
+        // Mesh uploads are queued on the upload service, the buffers hold their data once GPUMeshBuffers::UploadTicket
+        // is reached.
+        [[nodiscard]] GPUMeshBuffers UploadMesh(std::span<const u32> indices, std::span<const Vertex> vertices) const;
+        // The attributes go in the vertex buffer and the positions in the position buffer.
+        [[nodiscard]] GPUMeshBuffers UploadQuantizedMesh(std::span<const u32> indices, const QuantizedMesh& mesh) const;
+        // Uploads meshes whose streams are already in the full vertex layout inside a packed blob, e.g. a mapped
+        // cooked scene. Each stream is copied as is into the staging ring.
+        [[nodiscard]] std::vector<GPUMeshBuffers> UploadPackedMeshes(std::span<const std::byte> packedData,
+                                                                     std::span<const MeshStreamRange> ranges) const;
+
+        [[nodiscard]] inline bool IsHeadless() const;
         [[nodiscard]] inline VulkanWrapper::Instance& GetInstance() const;
         [[nodiscard]] inline VulkanWrapper::Device& GetDevice() const;
         [[nodiscard]] inline VmaAllocator GetAllocator() const;
+        [[nodiscard]] inline AsyncQueue& GetComputeQueue() const;
+        [[nodiscard]] inline UploadService& GetUploadService() const;
         [[nodiscard]] inline VkFormat GetDrawImageFormat() const;
+        [[nodiscard]] inline u32 GetCurrentFrameIndex() const;
+        // Descriptor sets allocated from it are only valid for the frame currently being recorded.
+        [[nodiscard]] inline DescriptorAllocatorGrowable& GetFrameDescriptors();
 
     private:
-        void InitializeVulkan(const Window& window, const DebugLevel& debugLevel);
+        void InitializeVulkan();
         void InitializeSwapchain(const Window& window);
+        void InitializeDrawImage(VkExtent2D extent);
         void InitializeCommands();
         void InitializeFramesCommandBuffers();
         void InitializeImmediateCommandBuffer();
         void InitializeSynchronisationPrimitives();
+        void InitializeDescriptors();
         void InitializeImGui(const Window& window);
 
         void DrawImGui(VkCommandBuffer commandBuffer, VkImageView targetImageView) const;
 
+        // Shared by the windowed and headless frames, once the frame fence was waited for.
+        VkCommandBuffer BeginFrame(FrameData& frame);
+        // DrawImage must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+        void RecordPendingCapture(VkCommandBuffer commandBuffer);
+        void SubmitFrame(const FrameData& frame, const VkSemaphoreSubmitInfo* signalSemaphoreInfo);
+
+        [[nodiscard]] GPUMeshBuffers CreateMeshBuffers(VkDeviceSize vertexBufferSize, VkDeviceSize indexBufferSize,
+                                                       VkDeviceSize positionBufferSize) const;
+        [[nodiscard]] GPUMeshBuffers UploadMeshStreams(std::span<const u32> indices,
+                                                       std::span<const std::byte> vertexData,
+                                                       std::span<const std::byte> positionData) const;
+
         [[nodiscard]] FrameData& GetCurrentFrame() {
             return m_Frames[m_FrameNumber % g_FrameOverlap];
         }
@@ -4,6 +4,10 @@
 
 #pragma once
 
+inline bool VulkanRenderer::IsHeadless() const {
+    return m_Swapchain == nullptr;
+}
+
 inline VulkanWrapper::Instance& VulkanRenderer::GetInstance() const {
     return *m_Instance;
 }
@@ -16,6 +20,22 @@ inline VmaAllocator VulkanRenderer::GetAllocator() const {
     return m_Allocator;
 }
 
+inline AsyncQueue& VulkanRenderer::GetComputeQueue() const {
+    return *m_ComputeQueue;
+}
+
+inline UploadService& VulkanRenderer::GetUploadService() const {
+    return *m_UploadService;
+}
+
 inline VkFormat VulkanRenderer::GetDrawImageFormat() const {
     return DrawImage.ImageFormat;
+}
+
+inline u32 VulkanRenderer::GetCurrentFrameIndex() const {
+    return static_cast<u32>(m_FrameNumber) % g_FrameOverlap;
+}
+
+inline DescriptorAllocatorGrowable& VulkanRenderer::GetFrameDescriptors() {
+    return GetCurrentFrame().FrameDescriptors;
 }
\ No newline at end of file
@@ -19,6 +19,7 @@
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 
 namespace Raytracer {
@@ -46,6 +47,52 @@ namespace Raytracer {
             VmaAllocationInfo Info;
         };
 
+        struct AllocatedAccelerationStructure {
+            VkAccelerationStructureKHR Handle;
+            AllocatedBuffer Buffer;
+            VkDeviceAddress DeviceAddress;
+            VkDeviceSize Size;
+        };
+
+        struct Vertex {
+            glm::vec3 Position;
+            f32 UvX;
+            glm::vec3 Normal;
+            f32 UvY;
+        };
+
+        // Compressed vertex layout, the positions are in their own stream so that BLAS builds read them directly.
+        // Positions are R16G16B16A16_SNORM dequantized by a per-mesh transform, W is unused.
+        struct QuantizedPosition {
+            i16 X, Y, Z, W;
+        };
+
+        // Octahedral normal as R16G16_SNORM, and half precision UVs.
+        struct QuantizedAttributes {
+            i16 NormalX, NormalY;
+            u16 UvX, UvY;
+        };
+
+        // Holds the resources needed for a mesh. The position buffer is only used by quantized meshes.
+        struct GPUMeshBuffers {
+            AllocatedBuffer IndexBuffer;
+            AllocatedBuffer VertexBuffer;
+            AllocatedBuffer PositionBuffer;
+            VkDeviceAddress IndexBufferAddress;
+            VkDeviceAddress VertexBufferAddress;
+            VkDeviceAddress PositionBufferAddress;
+            // Upload service ticket signaled once the buffers hold their data.
+            u64 UploadTicket;
+        };
+
+        // Where the streams of a mesh sit inside a packed blob, in bytes.
+        struct MeshStreamRange {
+            VkDeviceSize VertexOffset;
+            VkDeviceSize VertexSize;
+            VkDeviceSize IndexOffset;
+            VkDeviceSize IndexSize;
+        };
+
         struct SceneData {
             glm::mat4 View;
             glm::mat4 Projection;
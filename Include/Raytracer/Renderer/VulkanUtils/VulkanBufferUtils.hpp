@@ -6,8 +6,16 @@
 
 #include <Raytracer/Renderer/VulkanTypes.hpp>
 
+#include <span>
+
 namespace Raytracer::Renderer::VulkanUtils {
+    [[nodiscard]] constexpr VkDeviceSize AlignUp(const VkDeviceSize size, const VkDeviceSize alignment) {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    // The buffer is shared concurrently when more than one queue family index is given.
     AllocatedBuffer CreateBuffer(VmaAllocator allocator, usize allocSize, VkBufferUsageFlags usage,
-                                 VmaMemoryUsage memoryUsage);
+                                 VmaMemoryUsage memoryUsage, std::span<const u32> queueFamilyIndices = {});
     void DestroyBuffer(VmaAllocator allocator, const AllocatedBuffer& buffer);
+    [[nodiscard]] VkDeviceAddress GetBufferDeviceAddress(VkDevice device, const AllocatedBuffer& buffer);
 }
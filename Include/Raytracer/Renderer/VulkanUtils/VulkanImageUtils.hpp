@@ -6,6 +6,8 @@
 
 #include <Raytracer/Renderer/VulkanTypes.hpp>
 
+#include <span>
+
 namespace Raytracer::Renderer {
     class VulkanRenderer;
 
@@ -17,10 +19,19 @@ namespace Raytracer::Renderer {
                               VkExtent2D srcSize,
                               VkExtent2D dstSize);
 
+        // The image is shared concurrently when more than one queue family index is given.
         AllocatedImage CreateImage(VmaAllocator allocator, VkDevice device, VkExtent3D size, VkFormat format,
-                                   VkImageUsageFlags usage, bool mipmapped = false);
+                                   VkImageUsageFlags usage, bool mipmapped = false,
+                                   std::span<const u32> queueFamilyIndices = {});
+        // Uploads through the renderer's upload service, the next graphics submission waits for the copy.
         AllocatedImage CreateImage(VmaAllocator allocator, VkDevice device, const VulkanRenderer* renderer, const void* data,
                                    VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+        // Uploads a prebuilt mip chain, e.g. block-compressed levels, in a single copy with one region per level.
+        // levelOffsets holds the offset of each level in data, from the base level down.
+        AllocatedImage CreateImage(VmaAllocator allocator, VkDevice device, const VulkanRenderer* renderer,
+                                   std::span<const std::byte> data, std::span<const VkDeviceSize> levelOffsets,
+                                   VkExtent3D size, VkFormat format, VkImageUsageFlags usage,
+                                   const VkComponentMapping& components = {});
         void DestroyImage(VmaAllocator allocator, VkDevice device, const AllocatedImage& image);
         void GenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D imageSize);
     }
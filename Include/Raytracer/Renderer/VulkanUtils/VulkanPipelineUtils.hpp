@@ -8,6 +8,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <span>
 
 namespace Raytracer::Renderer::VulkanUtils {
 
@@ -16,6 +17,8 @@ namespace Raytracer::Renderer::VulkanUtils {
 
     class PipelineBuilder {
         std::vector<VkPipelineShaderStageCreateInfo> m_ShaderStages;
+        std::vector<VkVertexInputBindingDescription> m_VertexBindings;
+        std::vector<VkVertexInputAttributeDescription> m_VertexAttributes;
 
         VkPipelineInputAssemblyStateCreateInfo m_InputAssembly;
         VkPipelineRasterizationStateCreateInfo m_Rasterizer;
@@ -24,7 +27,7 @@ namespace Raytracer::Renderer::VulkanUtils {
         VkPipelineLayout m_PipelineLayout;
         VkPipelineDepthStencilStateCreateInfo m_DepthStencil;
         VkPipelineRenderingCreateInfo m_RenderInfo;
-        VkFormat m_ColorAttachmentFormat;
+        std::vector<VkFormat> m_ColorAttachmentFormats;
         VkFormat m_DepthAttachmentFormat;
 
     public:
@@ -35,6 +38,8 @@ namespace Raytracer::Renderer::VulkanUtils {
         void Clear();
 
         void SetShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+        void SetVertexInput(std::span<const VkVertexInputBindingDescription> bindings,
+                            std::span<const VkVertexInputAttributeDescription> attributes);
         void SetInputTopology(VkPrimitiveTopology topology);
         void SetPolygonMode(VkPolygonMode mode);
         void SetCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace);
@@ -43,6 +48,8 @@ namespace Raytracer::Renderer::VulkanUtils {
         void EnableAdditiveBlending();
         void EnableBlendingAlphaBlend();
         void SetColorAttachmentFormat(VkFormat format);
+        // Every attachment shares the blending state.
+        void SetColorAttachmentFormats(std::span<const VkFormat> formats);
         void SetDepthFormat(VkFormat format);
         void DisableDepthTest();
         void EnableDepthTest(bool depthWriteEnable, VkCompareOp op);
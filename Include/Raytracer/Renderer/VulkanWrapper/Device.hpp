@@ -7,11 +7,17 @@
 #include <Raytracer/Renderer/VulkanTypes.hpp>
 #include <Raytracer/Renderer/VulkanWrapper/Instance.hpp>
 
+#include <span>
+
 namespace Raytracer::Renderer::VulkanWrapper {
     class Device {
         VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
         VkDevice m_Device = VK_NULL_HANDLE;
         vkb::Device m_VkbDevice;
+        vkb::DispatchTable m_DispatchTable;
+
+        VkPhysicalDeviceAccelerationStructurePropertiesKHR m_AccelerationStructureProperties{};
+        VkPhysicalDeviceIDProperties m_IdProperties{};
 
         VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
         u32 m_GraphicsQueueFamilyIndex = 0;
@@ -19,6 +25,18 @@ namespace Raytracer::Renderer::VulkanWrapper {
         VkQueue m_PresentQueue = VK_NULL_HANDLE;
         u32 m_PresentQueueFamilyIndex = 0;
 
+        VkQueue m_ComputeQueue = VK_NULL_HANDLE;
+        u32 m_ComputeQueueFamilyIndex = 0;
+
+        VkQueue m_TransferQueue = VK_NULL_HANDLE;
+        u32 m_TransferQueueFamilyIndex = 0;
+
+        std::vector<u32> m_SharedQueueFamilyIndices;
+
+        bool m_HostImageCopyEnabled = false;
+        bool m_TextureCompressionBCEnabled = false;
+        std::vector<VkImageLayout> m_HostImageCopyLayouts;
+
         DeletionQueue m_DeletionQueue;
 
         bool m_Initialized = false;
@@ -36,10 +54,29 @@ namespace Raytracer::Renderer::VulkanWrapper {
         [[nodiscard]] inline VkPhysicalDevice GetPhysicalDevice() const;
         [[nodiscard]] inline VkDevice GetDevice() const;
         [[nodiscard]] inline vkb::Device GetVkbDevice() const;
+        [[nodiscard]] inline const vkb::DispatchTable& GetDispatchTable() const;
+        [[nodiscard]] inline const VkPhysicalDeviceAccelerationStructurePropertiesKHR&
+        GetAccelerationStructureProperties() const;
+        // Identifies the driver build, data serialized by the driver is only valid for the same UUID.
+        [[nodiscard]] inline std::span<const u8, VK_UUID_SIZE> GetDriverUUID() const;
         [[nodiscard]] inline VkQueue GetGraphicsQueue() const;
         [[nodiscard]] inline u32 GetGraphicsQueueFamilyIndex() const;
+        // VK_NULL_HANDLE for headless instances.
         [[nodiscard]] inline VkQueue GetPresentQueue() const;
         [[nodiscard]] inline u32 GetPresentQueueFamilyIndex() const;
+        // Compute-only queue if the device has one, otherwise a second graphics queue, or the graphics queue itself.
+        [[nodiscard]] inline VkQueue GetComputeQueue() const;
+        [[nodiscard]] inline u32 GetComputeQueueFamilyIndex() const;
+        // Transfer-only queue if the device has one, otherwise the compute queue.
+        [[nodiscard]] inline VkQueue GetTransferQueue() const;
+        [[nodiscard]] inline u32 GetTransferQueueFamilyIndex() const;
+        // Unique graphics, compute and transfer queue family indices, for resources used by several queues.
+        [[nodiscard]] inline std::span<const u32> GetSharedQueueFamilyIndices() const;
+        // VK_EXT_host_image_copy, enabled at device creation when available.
+        [[nodiscard]] inline bool IsHostImageCopyEnabled() const;
+        [[nodiscard]] inline bool IsTextureCompressionBCEnabled() const;
+        // Whether images of the format can be written from the host while in the layout.
+        [[nodiscard]] bool SupportsHostImageCopy(VkFormat format, VkImageLayout layout) const;
     };
 
 #include <Raytracer/Renderer/VulkanWrapper/Device.inl>
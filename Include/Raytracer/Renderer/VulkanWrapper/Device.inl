@@ -16,6 +16,18 @@ inline vkb::Device Device::GetVkbDevice() const {
     return m_VkbDevice;
 }
 
+inline const vkb::DispatchTable& Device::GetDispatchTable() const {
+    return m_DispatchTable;
+}
+
+inline const VkPhysicalDeviceAccelerationStructurePropertiesKHR& Device::GetAccelerationStructureProperties() const {
+    return m_AccelerationStructureProperties;
+}
+
+inline std::span<const u8, VK_UUID_SIZE> Device::GetDriverUUID() const {
+    return std::span<const u8, VK_UUID_SIZE>(m_IdProperties.driverUUID);
+}
+
 inline VkQueue Device::GetGraphicsQueue() const {
     return m_GraphicsQueue;
 }
@@ -31,3 +43,31 @@ inline VkQueue Device::GetPresentQueue() const {
 inline u32 Device::GetPresentQueueFamilyIndex() const {
     return m_PresentQueueFamilyIndex;
 }
+
+inline VkQueue Device::GetComputeQueue() const {
+    return m_ComputeQueue;
+}
+
+inline u32 Device::GetComputeQueueFamilyIndex() const {
+    return m_ComputeQueueFamilyIndex;
+}
+
+inline VkQueue Device::GetTransferQueue() const {
+    return m_TransferQueue;
+}
+
+inline u32 Device::GetTransferQueueFamilyIndex() const {
+    return m_TransferQueueFamilyIndex;
+}
+
+inline std::span<const u32> Device::GetSharedQueueFamilyIndices() const {
+    return m_SharedQueueFamilyIndices;
+}
+
+inline bool Device::IsHostImageCopyEnabled() const {
+    return m_HostImageCopyEnabled;
+}
+
+inline bool Device::IsTextureCompressionBCEnabled() const {
+    return m_TextureCompressionBCEnabled;
+}
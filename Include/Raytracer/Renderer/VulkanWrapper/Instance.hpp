@@ -21,8 +21,12 @@ namespace Raytracer::Renderer::VulkanWrapper {
 
         DeletionQueue m_DeletionQueue;
 
+        void CreateInstance(const std::string& applicationName, const DebugLevel& debugLevel, bool headless);
+
     public:
         Instance(const Window &window, const DebugLevel& debugLevel);
+        // Headless instance, without surface nor window system extensions, for machines without a display.
+        explicit Instance(const DebugLevel& debugLevel);
         ~Instance();
 
         Instance(const Instance&) = delete;
@@ -33,6 +37,7 @@ namespace Raytracer::Renderer::VulkanWrapper {
 
         [[nodiscard]] inline VkInstance GetInstance() const;
         [[nodiscard]] inline VkDebugUtilsMessengerEXT GetDebugMessenger() const;
+        // VK_NULL_HANDLE for headless instances.
         [[nodiscard]] inline VkSurfaceKHR GetSurface() const;
         [[nodiscard]] inline vkb::Instance GetVkbInstance() const;
     };
@@ -0,0 +1,92 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Core/MappedFile.hpp>
+
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <filesystem>
+#include <span>
+
+namespace Raytracer::Scene {
+    // .rtscene layout: the header, the mesh, material and instance tables, then the geometry region holding the
+    // vertex and index streams of every mesh in the renderer's layout. Every table and stream starts on a
+    // g_CookedSceneAlignment boundary so that it can be copied as is into staging memory.
+    constexpr u32 g_CookedSceneMagic = 0x43535452; // "RTSC"
+    constexpr u32 g_CookedSceneVersion = 1;
+    constexpr u64 g_CookedSceneAlignment = 256;
+
+    struct CookedSceneHeader {
+        u32 Magic;
+        u32 Version;
+        u32 MeshCount;
+        u32 InstanceCount;
+        u64 MeshTableOffset;
+        u64 MaterialTableOffset;
+        u64 InstanceTableOffset;
+        u64 GeometryOffset;
+        u64 GeometrySize;
+    };
+
+    // Offsets are relative to the geometry region. The hashes are the ones of MeshHash.hpp, precomputed so that a
+    // load never reads the streams.
+    struct CookedMesh {
+        u64 VertexOffset;
+        u64 IndexOffset;
+        u32 VertexCount;
+        u32 IndexCount;
+        u64 ContentHash;
+        u64 PositionHash;
+    };
+
+    // Matches MeshMaterial. Opacity textures are not cooked yet, every cooked mesh is opaque.
+    struct CookedMaterial {
+        u32 OpacityTexture;
+        f32 AlphaCutoff;
+    };
+
+    struct CookedInstance {
+        glm::mat4 Transform;
+        u32 MeshIndex;
+        u32 Layers;
+        u32 Padding[2];
+    };
+
+    // Offline step, writes the scene as it will be uploaded.
+    [[nodiscard]] bool CookScene(const SceneDescription& scene, const std::filesystem::path& path);
+
+    // A memory-mapped .rtscene. Only the header and the table bounds are checked, nothing is parsed: the tables are
+    // read in place and the streams are copied straight from the mapping.
+    class CookedScene {
+    public:
+        explicit CookedScene(const std::filesystem::path& path);
+        ~CookedScene() = default;
+
+        CookedScene(const CookedScene&) = delete;
+        CookedScene(CookedScene&&) = delete;
+
+        CookedScene& operator=(const CookedScene&) = delete;
+        CookedScene& operator=(CookedScene&&) = delete;
+
+        [[nodiscard]] inline bool IsValid() const;
+
+        [[nodiscard]] inline std::span<const CookedMesh> GetMeshes() const;
+        [[nodiscard]] inline std::span<const CookedMaterial> GetMaterials() const;
+        [[nodiscard]] inline std::span<const CookedInstance> GetInstances() const;
+        [[nodiscard]] inline std::span<const std::byte> GetGeometry() const;
+
+    private:
+        MappedFile m_File;
+        bool m_Valid = false;
+
+        std::span<const CookedMesh> m_Meshes;
+        std::span<const CookedMaterial> m_Materials;
+        std::span<const CookedInstance> m_Instances;
+        std::span<const std::byte> m_Geometry;
+    };
+}
+
+#include <Raytracer/Scene/CookedScene.inl>
@@ -0,0 +1,27 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+namespace Raytracer::Scene {
+    inline bool CookedScene::IsValid() const {
+        return m_Valid;
+    }
+
+    inline std::span<const CookedMesh> CookedScene::GetMeshes() const {
+        return m_Meshes;
+    }
+
+    inline std::span<const CookedMaterial> CookedScene::GetMaterials() const {
+        return m_Materials;
+    }
+
+    inline std::span<const CookedInstance> CookedScene::GetInstances() const {
+        return m_Instances;
+    }
+
+    inline std::span<const std::byte> CookedScene::GetGeometry() const {
+        return m_Geometry;
+    }
+}
@@ -0,0 +1,18 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <filesystem>
+
+namespace Raytracer::Scene {
+    // Imports the triangle primitives of a glTF 2.0 file (.gltf or .glb) and places them with the node hierarchy of
+    // the default scene. The binary buffers are memory-mapped and the accessors decoded in place, one mesh primitive
+    // per job across all cores. Alpha-masked materials keep their base color texture as opacity texture, loaded from a
+    // prebuilt KTX2 file when the texture references one or one sits next to the image. The rest of the materials,
+    // cameras, skins and morph targets are ignored.
+    [[nodiscard]] bool LoadGltf(const std::filesystem::path& path, SceneDescription& outScene);
+}
@@ -0,0 +1,31 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <Raytracer/Renderer/VulkanTypes.hpp>
+
+#include <filesystem>
+#include <vector>
+
+namespace Raytracer::Scene {
+    // A 2D texture with its whole mip chain, in its GPU format. Levels are packed in Data from the base level down,
+    // LevelOffsets holds the offset of each one. Decoded RGBA8 images only have their base level.
+    struct TextureData {
+        VkFormat Format = VK_FORMAT_UNDEFINED;
+        u32 Width = 0;
+        u32 Height = 0;
+        std::vector<VkDeviceSize> LevelOffsets;
+        std::vector<std::byte> Data;
+    };
+
+    // Loads a KTX2 container holding a BC1, BC4, BC5 or BC7 payload with prebuilt mips. Supercompressed payloads,
+    // arrays, cubemaps and 3D textures are rejected.
+    [[nodiscard]] bool LoadKtx2(const std::filesystem::path& path, TextureData& outTexture);
+
+    // Size of a BCn block, 0 for the formats LoadKtx2 doesn't support.
+    [[nodiscard]] u32 GetBlockSize(VkFormat format);
+}
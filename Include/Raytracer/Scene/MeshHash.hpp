@@ -0,0 +1,30 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Core/Hash.hpp>
+
+#include <Raytracer/Renderer/VulkanTypes.hpp>
+
+#include <span>
+
+namespace Raytracer::Scene {
+    // Identifies the whole mesh, used to upload identical meshes only once.
+    [[nodiscard]] inline u64 HashMeshContent(const std::span<const Renderer::Vertex> vertices,
+                                             const std::span<const u32> indices) {
+        return HashRange(vertices, HashRange(indices));
+    }
+
+    // Identifies what the BLAS is built from: the positions and the indices.
+    [[nodiscard]] inline u64 HashMeshPositions(const std::span<const Renderer::Vertex> vertices,
+                                               const std::span<const u32> indices) {
+        u64 hash = HashRange(indices);
+        for (const Renderer::Vertex& vertex : vertices) {
+            hash = HashValue(vertex.Position, hash);
+        }
+
+        return hash;
+    }
+}
@@ -0,0 +1,16 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <filesystem>
+
+namespace Raytracer::Scene {
+    // Imports the faces of a Wavefront OBJ file, one mesh per object or group, placed at the origin. The mapped file
+    // is split at line boundaries and the chunks are parsed on all cores, then every mesh is welded into an indexed
+    // stream on its own job. Materials, lines and points are ignored.
+    [[nodiscard]] bool LoadObj(const std::filesystem::path& path, SceneDescription& outScene);
+}
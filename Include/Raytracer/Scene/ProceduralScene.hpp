@@ -0,0 +1,42 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <string>
+#include <string_view>
+
+namespace Raytracer::Scene {
+    enum class ProceduralLayout : u8 {
+        // Lumpy spheres laid out on a ground grid, the typical instanced scene.
+        Grid,
+        // Small random triangles filling each mesh's bounds, instances scattered in a volume.
+        TriangleSoup,
+        // Long triangles spanning each mesh's bounds, the worst case for BVH quality.
+        Overlapping
+    };
+
+    // Synthetic benchmark scene. The same settings always produce the same scene, on every platform.
+    struct ProceduralSceneSettings {
+        ProceduralLayout Layout = ProceduralLayout::Grid;
+        // Per mesh, the generated meshes get as close as their topology allows.
+        u32 TriangleCount = 100'000;
+        u32 InstanceCount = 1024;
+        // Number of distinct meshes the instances pick from.
+        u32 MeshCount = 4;
+        // 0 places the instances side by side, 1 stacks them all at the origin.
+        f32 Overlap = 0.f;
+        u64 Seed = 1;
+    };
+
+    // Meshes are generated in parallel.
+    void GenerateProceduralScene(const ProceduralSceneSettings& settings, SceneDescription& outScene);
+
+    [[nodiscard]] bool ParseProceduralLayout(std::string_view name, ProceduralLayout& outLayout);
+    [[nodiscard]] std::string_view GetProceduralLayoutName(ProceduralLayout layout);
+    // Short description for logs, e.g. "grid (100000 triangles x 4 meshes, 1024 instances, overlap 0.00, seed 1)".
+    [[nodiscard]] std::string DescribeProceduralScene(const ProceduralSceneSettings& settings);
+}
@@ -0,0 +1,49 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/rtpch.hpp>
+
+#include <Raytracer/Renderer/VulkanTypes.hpp>
+
+#include <Raytracer/Scene/Ktx2Loader.hpp>
+
+#include <string>
+#include <vector>
+
+namespace Raytracer::Scene {
+    constexpr u32 g_NoTexture = ~0u;
+
+    // Alpha-masked materials discard the texels whose opacity is below the cutoff, the others are opaque.
+    struct MaterialData {
+        // Index in SceneDescription::Textures.
+        u32 OpacityTexture = g_NoTexture;
+        f32 AlphaCutoff = 0.5f;
+    };
+
+    // Vertex and index streams in the layout the renderer uploads, one per drawable primitive.
+    struct MeshData {
+        std::string Name;
+        std::vector<Renderer::Vertex> Vertices;
+        std::vector<u32> Indices;
+        MaterialData Material;
+    };
+
+    struct MeshPlacement {
+        u32 MeshIndex;
+        glm::mat4 Transform;
+    };
+
+    // What the importers produce, independent of the source format.
+    struct SceneDescription {
+        std::vector<MeshData> Meshes;
+        std::vector<MeshPlacement> Placements;
+        // Opacity textures, RGBA8 with the opacity in alpha or block-compressed.
+        std::vector<TextureData> Textures;
+    };
+
+    // Area weighted smooth normals, for the meshes exported without any.
+    void GenerateNormals(MeshData& mesh);
+}
@@ -0,0 +1,14 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#pragma once
+
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <filesystem>
+
+namespace Raytracer::Scene {
+    // Imports an interchange format scene, the importer is picked from the file extension.
+    [[nodiscard]] bool ImportScene(const std::filesystem::path& path, SceneDescription& outScene);
+}
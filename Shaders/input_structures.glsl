@@ -3,6 +3,66 @@ layout (set = 0, binding = 0) uniform accelerationStructureEXT topLevelAS;
 layout (set = 0, binding = 1) uniform GlobalUniform {
     mat4 view;
     mat4 proj;
+    mat4 previousViewProjection; // Of the previous frame, for the motion vectors.
     vec3 cameraPosition;
-    vec3 lightPosition;
-} globalUniform;
\ No newline at end of file
+    vec4 lightPosition; // xyz: center of the spherical light, w: its radius, 0 for a point light.
+    uvec4 rayMasks; // x: shadow rays, y: ambient occlusion rays, z: camera rays.
+    uint alphaTestedInstanceCount; // Rays skip candidate processing entirely when there is none.
+    uint frameIndex; // Offsets the sample sequence, every frame traces a different set of directions.
+    uint aoSampleCount; // Ambient occlusion rays per pixel.
+    float aoRayDistance; // Occluders farther than this are ignored.
+    uint aoMinSampleCount; // Pixels whose accumulated mean is below the variance threshold, AO and area light rays.
+    uint aoMaxSampleCount; // Pixels above it.
+    float aoVarianceThreshold;
+    uint historyValid; // The history image holds the previous frame.
+    uvec2 drawExtent;
+} globalUniform;
+
+#define MAX_OPACITY_TEXTURES 64
+#define NO_OPACITY_TEXTURE 0xFFFFFFFFu
+
+struct Vertex {
+    vec3 position;
+    float uvX;
+    vec3 normal;
+    float uvY;
+};
+
+layout (buffer_reference, std430, buffer_reference_align = 16) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+// Octahedral normal as two snorm16, then the UVs as two half floats.
+layout (buffer_reference, std430, buffer_reference_align = 8) readonly buffer QuantizedAttributeBuffer {
+    uvec2 attributes[];
+};
+
+layout (buffer_reference, std430, buffer_reference_align = 4) readonly buffer IndexBuffer {
+    uint indices[];
+};
+
+// Indexed by the TLAS instance custom index.
+struct InstanceData {
+    mat4 transform;
+    uvec2 vertexBufferAddress;
+    uvec2 indexBufferAddress;
+    uint opacityTexture;
+    float alphaCutoff;
+    uint quantized; // The vertex buffer then holds QuantizedAttributes.
+    uint padding;
+};
+
+layout (set = 0, binding = 2) readonly buffer InstanceDataBuffer {
+    InstanceData instances[];
+} instanceData;
+
+layout (set = 0, binding = 3) uniform sampler2D opacityTextures[MAX_OPACITY_TEXTURES];
+
+// Instance indices of the visible instances grouped by mesh, indexed by gl_InstanceIndex.
+layout (set = 0, binding = 4) readonly buffer DrawInstanceBuffer {
+    uint indices[];
+} drawInstances;
+
+// Accumulation of the previous frame. x: ambient occlusion, y: light visibility, z: history length in frames,
+// w: mean of the squared lighting.
+layout (set = 0, binding = 5, rgba32f) uniform readonly image2D historyImage;
\ No newline at end of file
@@ -4,84 +4,261 @@
 
 #version 460
 #extension GL_EXT_ray_query : enable
+#extension GL_EXT_buffer_reference : enable
+#extension GL_EXT_buffer_reference_uvec2 : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 #extension GL_GOOGLE_include_directive : enable
 
 #include "input_structures.glsl"
 
+// Frames of history below which the variance estimate isn't trusted.
+#define MIN_VARIANCE_HISTORY_LENGTH 4.0
+
 layout (location = 0) in vec4 VertexPos;
 layout (location = 1) in vec3 VertexNormal;
 layout (location = 2) in vec4 ScenePosition; // Scene with respect to BVH coordinates.
 
-layout (location = 0) out vec4 FragColor;
+layout (location = 0) out vec4 FragColor; // x: ambient occlusion, y: light visibility.
+layout (location = 1) out vec4 FragMotion; // xy: motion since the previous frame in UV, z: depth in the previous frame.
+layout (location = 2) out vec4 FragNormalDepth; // xyz: normal, w: linear depth.
 
 /*
- * Calculate ambien occlusion.
+ * Alpha test of a candidate triangle intersection against the opacity texture of its instance.
  */
-float calculateAmbientOcclusion(vec3 objectPoint, vec3 objectNormal) {
-    const float ao_mut = 1;
-    uint max_ao_each = 3;
-    uint max_ao = max_ao_each * max_ao_each;
-    const float max_dist = 2;
-    const float tmin = 0.01, tmax = max_dist;
-    float accumulated_ao = 0.f;
-    vec3 u = abs(dot(objectNormal, vec3(0, 0, 1))) > 0.9 ? cross(objectNormal, vec3(1, 0, 0)) : cross(objectNormal, vec3(0, 0, 1));
-    vec3 v = cross(objectNormal, u);
-    float accumulated_factor = 0;
-    for (uint j = 0; j < max_ao_each; ++j) {
-        float phi = 0.5*(-3.14159 * (float(j + 1) / float(max_ao_each + 2)));
-        for (uint k = 0; k < max_ao_each; ++k) {
-            float theta = 0.5*(-3.14159 * (float(k + 1) / float(max_ao_each + 2)));
-            float x = cos(phi) * sin(theta);
-            float y = sin(phi) * sin(theta);
-            float z = cos(theta);
-            vec3 direction = x * u + y * v + z * objectNormal;
-
-            rayQueryEXT query;
-            rayQueryInitializeEXT(query, topLevelAS, gl_RayFlagsTerminateOnFirstHitEXT, 0xFF, objectPoint, tmin, direction.xyz, tmax);
-            rayQueryProceedEXT(query);
-            float dist = max_dist;
-            if (rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionNoneEXT) {
-                dist = rayQueryGetIntersectionTEXT(query, true);
+bool isCandidateOpaque(uint instanceIndex, uint primitiveIndex, vec2 barycentrics) {
+    const InstanceData instance = instanceData.instances[instanceIndex];
+    if (instance.opacityTexture == NO_OPACITY_TEXTURE) {
+        return true;
+    }
+
+    const IndexBuffer indexBuffer = IndexBuffer(instance.indexBufferAddress);
+    const uint i0 = indexBuffer.indices[3 * primitiveIndex + 0];
+    const uint i1 = indexBuffer.indices[3 * primitiveIndex + 1];
+    const uint i2 = indexBuffer.indices[3 * primitiveIndex + 2];
+
+    vec2 uv0, uv1, uv2;
+    if (instance.quantized != 0) {
+        const QuantizedAttributeBuffer attributeBuffer = QuantizedAttributeBuffer(instance.vertexBufferAddress);
+        uv0 = unpackHalf2x16(attributeBuffer.attributes[i0].y);
+        uv1 = unpackHalf2x16(attributeBuffer.attributes[i1].y);
+        uv2 = unpackHalf2x16(attributeBuffer.attributes[i2].y);
+    } else {
+        const VertexBuffer vertexBuffer = VertexBuffer(instance.vertexBufferAddress);
+        uv0 = vec2(vertexBuffer.vertices[i0].uvX, vertexBuffer.vertices[i0].uvY);
+        uv1 = vec2(vertexBuffer.vertices[i1].uvX, vertexBuffer.vertices[i1].uvY);
+        uv2 = vec2(vertexBuffer.vertices[i2].uvX, vertexBuffer.vertices[i2].uvY);
+    }
+
+    const vec2 uv = uv0 * (1.0 - barycentrics.x - barycentrics.y) + uv1 * barycentrics.x + uv2 * barycentrics.y;
+
+    // No derivatives in the middle of a traversal, the base level is sampled.
+    const float opacity = textureLod(opacityTextures[nonuniformEXT(instance.opacityTexture)], uv, 0).a;
+
+    return opacity >= instance.alphaCutoff;
+}
+
+/*
+ * Trace an occlusion ray and return the distance to the first hit, or tmax if nothing was hit.
+ */
+float traceOcclusionRay(vec3 origin, vec3 direction, float tmin, float tmax, uint cullMask) {
+    rayQueryEXT query;
+
+    if (globalUniform.alphaTestedInstanceCount == 0) {
+        // Everything is opaque: the traversal commits the first hit by itself and no candidate is ever returned,
+        // so a single rayQueryProceedEXT is enough.
+        rayQueryInitializeEXT(query, topLevelAS, gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT, cullMask, origin, tmin, direction, tmax);
+        rayQueryProceedEXT(query);
+    } else {
+        // Opaque geometry is still committed by the traversal, only the alpha-tested triangles come back as
+        // candidates to be confirmed or ignored.
+        rayQueryInitializeEXT(query, topLevelAS, gl_RayFlagsTerminateOnFirstHitEXT, cullMask, origin, tmin, direction, tmax);
+        while (rayQueryProceedEXT(query)) {
+            if (rayQueryGetIntersectionTypeEXT(query, false) == gl_RayQueryCandidateIntersectionTriangleEXT &&
+                isCandidateOpaque(rayQueryGetIntersectionInstanceCustomIndexEXT(query, false),
+                                  rayQueryGetIntersectionPrimitiveIndexEXT(query, false),
+                                  rayQueryGetIntersectionBarycentricsEXT(query, false))) {
+                rayQueryConfirmIntersectionEXT(query);
             }
-            float ao = min(dist, max_dist);
-            float factor = 0.2 + 0.8 * z * z;
-            accumulated_factor += factor;
-            accumulated_ao += ao * factor;
         }
     }
-    accumulated_ao /= (max_dist * accumulated_factor);
-    accumulated_ao *= accumulated_ao;
-    accumulated_ao = max(min((accumulated_ao) * ao_mut, 1), 0);
-    return accumulated_ao;
+
+    if (rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionNoneEXT) {
+        return rayQueryGetIntersectionTEXT(query, true);
+    }
+
+    return tmax;
+}
+
+/*
+ * PCG hash, decorrelates the seeds of neighbouring pixels.
+ */
+uint hash(uint value) {
+    const uint state = value * 747796405u + 2891336453u;
+    const uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+/*
+ * Uniform random number in [0, 1) that advances the seed.
+ */
+float random(inout uint seed) {
+    seed = hash(seed);
+    return float(seed >> 8) * (1.0 / 16777216.0);
+}
+
+/*
+ * Interleaved gradient noise, a per-pixel value whose neighbourhoods cover [0, 1) evenly like blue noise.
+ */
+float interleavedGradientNoise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+/*
+ * Point of the two dimensional Sobol sequence: the base 2 radical inverse, then the second Sobol dimension. Every run
+ * of a power of two points starting at a multiple of it is stratified, so consecutive frames fill in each other's gaps.
+ */
+vec2 sobol(uint index) {
+    const uint x = bitfieldReverse(index);
+
+    uint y = 0u;
+    // Direction numbers of the second dimension, v(k + 1) = v(k) ^ (v(k) >> 1).
+    for (uint direction = 1u << 31; index != 0u; index >>= 1, direction ^= direction >> 1) {
+        if ((index & 1u) != 0u) {
+            y ^= direction;
+        }
+    }
+
+    // 24 bits keep the values below one once converted.
+    return vec2(x >> 8, y >> 8) * (1.0 / 16777216.0);
+}
+
+/*
+ * Number of AO and area light rays for the point, from the variance of its accumulated mean in the previous frame.
+ * Converged pixels drop to the minimum count, penumbrae, creases and contacts keep the maximum one until they converge
+ * too.
+ */
+uint chooseSampleCount(vec4 previousClipPosition) {
+    if (globalUniform.historyValid == 0 || previousClipPosition.w <= 0) {
+        return globalUniform.aoSampleCount;
+    }
+
+    const vec2 previousUv = previousClipPosition.xy / previousClipPosition.w * 0.5 + 0.5;
+    const ivec2 extent = ivec2(globalUniform.drawExtent);
+    const ivec2 previousPixel = ivec2(floor(previousUv * vec2(extent)));
+    if (any(lessThan(previousPixel, ivec2(0))) || any(greaterThanEqual(previousPixel, extent))) {
+        return globalUniform.aoSampleCount;
+    }
+
+    const vec4 history = imageLoad(historyImage, previousPixel);
+    if (history.z < MIN_VARIANCE_HISTORY_LENGTH) {
+        return globalUniform.aoSampleCount;
+    }
+
+    const float variance = max(history.w - dot(history.xy, history.xy), 0.0) / history.z;
+    return variance > globalUniform.aoVarianceThreshold ? globalUniform.aoMaxSampleCount
+                                                        : globalUniform.aoMinSampleCount;
+}
+
+/*
+ * Calculate ambient occlusion.
+ */
+float calculateAmbientOcclusion(vec3 objectPoint, vec3 objectNormal, uint sampleCount, inout uint seed) {
+    const float maxDistance = globalUniform.aoRayDistance;
+    const float tmin = 0.01;
+    const float TWO_PI = 6.28318531;
+
+    vec3 u = abs(dot(objectNormal, vec3(0, 0, 1))) > 0.9 ? cross(objectNormal, vec3(1, 0, 0)) : cross(objectNormal, vec3(0, 0, 1));
+    vec3 v = cross(objectNormal, u);
+
+    // Every pixel walks the same sequence, rotated around the normal by a blue noise angle and shifted along the
+    // radius so that neighbours trace different directions without the banding of a shared pattern.
+    const float rotation = interleavedGradientNoise(gl_FragCoord.xy);
+    const float radiusShift = random(seed);
+
+    float unoccluded = 0.f;
+    for (uint i = 0; i < sampleCount; ++i) {
+        // Strided by the largest count, the frames never reuse the points of another one.
+        const uint index = globalUniform.frameIndex * globalUniform.aoMaxSampleCount + i;
+        const vec2 xi = fract(sobol(index) + vec2(radiusShift, rotation));
+
+        // Cosine-weighted hemisphere, the cosine term of the occlusion integral is in the distribution.
+        const float r = sqrt(xi.x);
+        const float phi = TWO_PI * xi.y;
+        const vec3 direction = r * cos(phi) * u + r * sin(phi) * v + sqrt(1 - xi.x) * objectNormal;
+
+        // Only instances in the AO layer occlude, small props and foliage are skipped entirely by the traversal.
+        const float dist = traceOcclusionRay(objectPoint, direction, tmin, maxDistance, globalUniform.rayMasks.y);
+        unoccluded += min(dist, maxDistance);
+    }
+    // Unoccluded fraction, the contrast curve is applied once averaged by accumulate.comp.
+    return unoccluded / (maxDistance * float(sampleCount));
 }
 
 /*
  * Apply ray tracing to determine whether the point intersects light.
  */
 bool intersectsLight(vec3 lightOrigin, vec3 pos) {
-    const float tmin = 0.01, tmax = 1000;
+    const float tmin = 0.01;
     const vec3 direction = lightOrigin - pos;
 
-    rayQueryEXT query;
+    // Only instances in the shadow caster layer are tested. The direction spans the whole segment to the light.
+    return traceOcclusionRay(pos, direction, tmin, 1.0, globalUniform.rayMasks.x) < 1.0;
+}
 
-    // The following runs the actual ray query.
-    // For performance, use gl_RayFlagsTerminateOnFirstHitEXT, since we only need to know
-    // wheter an intersection exists, and not necessarily any particular intersection.
-    rayQueryInitializeEXT(query, topLevelAS, gl_RayFlagsTerminateOnFirstHitEXT, 0xFF, pos, tmin, direction.xyz, 1.0);
-    // The following is the canonical way of using ray queries from the fragment shader when
-    // there's more than one bounce or hit to traverse:
-    // while(rayQueryProceedEXT(query)) { }
-    // Since the flag gl_RayFlagsTerminateOnFirstHitEXT is set, there will never be a bounce and no need for an expensive while loop.
-    rayQueryProceedEXT(query);
-    if (rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionNoneEXT) {
-        return true;
+/*
+ * Fraction of the spherical light visible from the point, from rays to points spread over the disk it covers as seen
+ * from the point. A point light leaves no variance, a single ray is exact.
+ */
+float calculateLightVisibility(vec3 pos, uint sampleCount, inout uint seed) {
+    const vec3 lightCenter = globalUniform.lightPosition.xyz;
+    const float lightRadius = globalUniform.lightPosition.w;
+    const float TWO_PI = 6.28318531;
+
+    if (lightRadius <= 0.0) {
+        return intersectsLight(lightCenter, pos) ? 0.0 : 1.0;
     }
 
-    return false;
+    const vec3 axis = normalize(lightCenter - pos);
+    const vec3 u = normalize(abs(axis.z) > 0.9 ? cross(axis, vec3(1, 0, 0)) : cross(axis, vec3(0, 0, 1)));
+    const vec3 v = cross(axis, u);
+
+    // Same sequence as the AO rays, shifted by another offset so that both don't sample in lockstep.
+    const vec2 shift = vec2(random(seed), random(seed));
+
+    float visible = 0.0;
+    for (uint i = 0; i < sampleCount; ++i) {
+        const uint index = globalUniform.frameIndex * globalUniform.aoMaxSampleCount + i;
+        const vec2 xi = fract(sobol(index) + shift);
+
+        // Uniform over the disk.
+        const float r = lightRadius * sqrt(xi.x);
+        const float phi = TWO_PI * xi.y;
+        const vec3 lightPoint = lightCenter + r * cos(phi) * u + r * sin(phi) * v;
+
+        visible += intersectsLight(lightPoint, pos) ? 0.0 : 1.0;
+    }
+    return visible / float(sampleCount);
 }
 
 void main() {
-    const float ao = calculateAmbientOcclusion(ScenePosition.xyz, VertexNormal);
-    const vec4 lighting = intersectsLight(globalUniform.lightPosition, ScenePosition.xyz) ? vec4(0.2, 0.2, 0.2, 1) : vec4(1, 1, 1, 1);
-    FragColor = lighting * vec4(ao * vec3(1, 1, 1), 1);
+    // The frames advance along the sample sequence, the seed only differs between pixels.
+    uint seed = hash(uint(gl_FragCoord.x) ^ hash(uint(gl_FragCoord.y)));
+
+    const vec4 previousClipPosition = globalUniform.previousViewProjection * ScenePosition;
+
+    // The variance covers both terms, penumbrae get as many shadow rays as creases get AO rays.
+    const uint sampleCount = chooseSampleCount(previousClipPosition);
+    const float ao = calculateAmbientOcclusion(ScenePosition.xyz, VertexNormal, sampleCount, seed);
+    const float visibility = calculateLightVisibility(ScenePosition.xyz, sampleCount, seed);
+
+    // Shaded by the accumulation pass, once averaged with the previous frames.
+    FragColor = vec4(ao, visibility, 0, 1);
+
+    // Only the camera moves, the scene points stay where they were.
+    const vec4 clipPosition = globalUniform.proj * VertexPos;
+    const vec2 motion = (clipPosition.xy / clipPosition.w - previousClipPosition.xy / previousClipPosition.w) * 0.5;
+
+    // The clip w of a perspective projection is the linear depth.
+    FragMotion = vec4(motion, previousClipPosition.w, 0);
+    FragNormalDepth = vec4(normalize(VertexNormal), clipPosition.w);
 }
\ No newline at end of file
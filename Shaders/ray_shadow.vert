@@ -4,6 +4,9 @@
 
 #version 460
 #extension GL_EXT_ray_query : enable
+#extension GL_EXT_buffer_reference : enable
+#extension GL_EXT_buffer_reference_uvec2 : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 #extension GL_GOOGLE_include_directive : enable
 
 #include "input_structures.glsl"
@@ -16,12 +19,15 @@ layout (location = 1) out vec3 VertexNormal;
 layout (location = 2) out vec4 ScenePosition; // Scene with respect to BVH coordinates.
 
 void main() {
-    // We want to be able to perform ray tracing, so don't apply any matrix to ScenePosition.
-    ScenePosition = vec4(position, 1);
+    const mat4 model = instanceData.instances[drawInstances.indices[gl_InstanceIndex]].transform;
 
-    VertexPos = globalUniform.view * vec4(position, 1);
+    // The TLAS instances carry the same transform, so world space is the BVH space.
+    ScenePosition = model * vec4(position, 1);
 
-    VertexNormal = normal;
+    VertexPos = globalUniform.view * ScenePosition;
 
-    gl_Position = globalUniform.proj * globalUniform.view * vec4(position, 1.0);
+    // The inverse transpose keeps the normals perpendicular to the surface under non-uniform scales.
+    VertexNormal = normalize(transpose(inverse(mat3(model))) * normal);
+
+    gl_Position = globalUniform.proj * globalUniform.view * ScenePosition;
 }
\ No newline at end of file
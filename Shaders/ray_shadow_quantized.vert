@@ -0,0 +1,49 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#version 460
+#extension GL_EXT_ray_query : enable
+#extension GL_EXT_buffer_reference : enable
+#extension GL_EXT_buffer_reference_uvec2 : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "input_structures.glsl"
+
+layout (location = 0) in vec4 position; // R16G16B16A16_SNORM, normalized to the mesh bounds.
+layout (location = 1) in vec2 octahedralNormal; // R16G16_SNORM.
+
+layout (location = 0) out vec4 VertexPos;
+layout (location = 1) out vec3 VertexNormal;
+layout (location = 2) out vec4 ScenePosition; // Scene with respect to BVH coordinates.
+
+layout (push_constant) uniform PushConstants {
+    vec4 dequantizationScale;
+    vec4 dequantizationOffset;
+} pushConstants;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    const float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+
+void main() {
+    const mat4 model = instanceData.instances[drawInstances.indices[gl_InstanceIndex]].transform;
+
+    const vec3 objectPosition = pushConstants.dequantizationOffset.xyz + pushConstants.dequantizationScale.xyz * position.xyz;
+
+    // The TLAS instances carry the same transform, dequantization included, so world space is the BVH space.
+    ScenePosition = model * vec4(objectPosition, 1);
+
+    VertexPos = globalUniform.view * ScenePosition;
+
+    // The inverse transpose keeps the normals perpendicular to the surface under non-uniform scales. The normals are
+    // encoded in object space, the dequantization scale doesn't apply to them.
+    VertexNormal = normalize(transpose(inverse(mat3(model))) * decodeOctahedral(octahedralNormal));
+
+    gl_Position = globalUniform.proj * globalUniform.view * ScenePosition;
+}
@@ -0,0 +1,48 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Core/ImageReader.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+
+#include <cstring>
+#include <limits>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_TGA
+#define STBI_ONLY_BMP
+#include <stb_image.h>
+
+namespace Raytracer {
+    bool ReadImage(const std::span<const std::byte> encoded, u32& outWidth, u32& outHeight,
+                   std::vector<std::byte>& outRgba) {
+        if (encoded.size() > static_cast<usize>(std::numeric_limits<int>::max())) {
+            Log::RtError("Image of {0} bytes is too large to decode.", encoded.size());
+            return false;
+        }
+
+        int width = 0;
+        int height = 0;
+        int channelCount = 0;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.data()),
+                                                static_cast<int>(encoded.size()), &width, &height, &channelCount,
+                                                STBI_rgb_alpha);
+        if (pixels == nullptr) {
+            Log::RtError("Failed to decode image: {0}.", stbi_failure_reason());
+            return false;
+        }
+
+        outWidth = static_cast<u32>(width);
+        outHeight = static_cast<u32>(height);
+        outRgba.resize(static_cast<usize>(width) * height * 4);
+        std::memcpy(outRgba.data(), pixels, outRgba.size());
+
+        stbi_image_free(pixels);
+
+        return true;
+    }
+}
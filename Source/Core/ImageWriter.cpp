@@ -0,0 +1,249 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Core/ImageWriter.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace Raytracer {
+    namespace {
+        // Largest payload of a stored deflate block.
+        constexpr usize g_MaxStoredBlockSize = 65535;
+
+        constexpr std::array<u32, 256> MakeCrcTable() {
+            std::array<u32, 256> table{};
+            for (u32 i = 0; i < 256; i++) {
+                u32 crc = i;
+                for (u32 bit = 0; bit < 8; bit++) {
+                    crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+                }
+                table[i] = crc;
+            }
+
+            return table;
+        }
+
+        constexpr std::array<u32, 256> g_CrcTable = MakeCrcTable();
+
+        class ByteWriter {
+        public:
+            void WriteBytes(const void* data, const usize size) {
+                const auto* bytes = static_cast<const u8*>(data);
+                m_Data.insert(m_Data.end(), bytes, bytes + size);
+            }
+
+            void WriteString(const std::string_view string) {
+                WriteBytes(string.data(), string.size());
+            }
+
+            void WriteU8(const u8 value) {
+                m_Data.push_back(value);
+            }
+
+            void WriteU32BigEndian(const u32 value) {
+                for (i32 shift = 24; shift >= 0; shift -= 8) {
+                    m_Data.push_back(static_cast<u8>(value >> shift));
+                }
+            }
+
+            // OpenEXR is little-endian, as every platform the renderer runs on.
+            template <typename T>
+            void WriteLittleEndian(const T value) {
+                WriteBytes(&value, sizeof(T));
+            }
+
+            [[nodiscard]] usize GetSize() const {
+                return m_Data.size();
+            }
+
+            [[nodiscard]] std::vector<u8>& GetData() {
+                return m_Data;
+            }
+
+        private:
+            std::vector<u8> m_Data;
+        };
+
+        void WritePngChunk(ByteWriter& writer, const std::string_view type, const std::span<const u8> data) {
+            writer.WriteU32BigEndian(static_cast<u32>(data.size()));
+
+            const usize typeOffset = writer.GetSize();
+            writer.WriteString(type);
+            writer.WriteBytes(data.data(), data.size());
+
+            // The CRC covers the type and the data.
+            u32 crc = 0xFFFFFFFFu;
+            for (usize i = typeOffset; i < writer.GetSize(); i++) {
+                crc = g_CrcTable[(crc ^ writer.GetData()[i]) & 0xFF] ^ (crc >> 8);
+            }
+            writer.WriteU32BigEndian(crc ^ 0xFFFFFFFFu);
+        }
+
+        // A zlib stream of stored blocks, the rows are prefixed with the "none" filter.
+        std::vector<u8> MakeStoredZlibStream(const u32 width, const u32 height, const std::span<const u8> rgb) {
+            const usize rowSize = static_cast<usize>(width) * 3;
+
+            std::vector<u8> filtered;
+            filtered.reserve((rowSize + 1) * height);
+            for (u32 y = 0; y < height; y++) {
+                filtered.push_back(0);
+                filtered.insert(filtered.end(), rgb.begin() + y * rowSize, rgb.begin() + (y + 1) * rowSize);
+            }
+
+            ByteWriter stream;
+            // 32K window, no preset dictionary, fastest compression level, the header checksum is a multiple of 31.
+            stream.WriteU8(0x78);
+            stream.WriteU8(0x01);
+
+            usize offset = 0;
+            do {
+                const usize blockSize = std::min(filtered.size() - offset, g_MaxStoredBlockSize);
+                const bool lastBlock = offset + blockSize == filtered.size();
+
+                stream.WriteU8(lastBlock ? 1 : 0);
+                stream.WriteLittleEndian(static_cast<u16>(blockSize));
+                stream.WriteLittleEndian(static_cast<u16>(~blockSize));
+                stream.WriteBytes(filtered.data() + offset, blockSize);
+
+                offset += blockSize;
+            } while (offset < filtered.size());
+
+            // Adler-32 of the uncompressed data, the sums are reduced before they can overflow.
+            u32 a = 1;
+            u32 b = 0;
+            for (usize i = 0; i < filtered.size(); i += 5552) {
+                const usize end = std::min(filtered.size(), i + 5552);
+                for (usize j = i; j < end; j++) {
+                    a += filtered[j];
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+            stream.WriteU32BigEndian((b << 16) | a);
+
+            return std::move(stream.GetData());
+        }
+
+        void WriteExrAttribute(ByteWriter& writer, const std::string_view name, const std::string_view type,
+                               const std::span<const u8> value) {
+            writer.WriteString(name);
+            writer.WriteU8(0);
+            writer.WriteString(type);
+            writer.WriteU8(0);
+            writer.WriteLittleEndian(static_cast<i32>(value.size()));
+            writer.WriteBytes(value.data(), value.size());
+        }
+
+        template <typename... T>
+        std::vector<u8> PackLittleEndian(const T... values) {
+            ByteWriter writer;
+            (writer.WriteLittleEndian(values), ...);
+
+            return std::move(writer.GetData());
+        }
+
+        bool WriteFile(const std::filesystem::path& path, const std::span<const u8> data) {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                Log::RtError("Failed to open {0} for writing.", path.string());
+                return false;
+            }
+
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                Log::RtError("Failed to write {0}.", path.string());
+                return false;
+            }
+
+            return true;
+        }
+    }
+
+    bool WritePng(const std::filesystem::path& path, const u32 width, const u32 height,
+                  const std::span<const u8> rgb) {
+        ByteWriter writer;
+        writer.WriteBytes("\x89PNG\r\n\x1A\n", 8);
+
+        ByteWriter header;
+        header.WriteU32BigEndian(width);
+        header.WriteU32BigEndian(height);
+        // 8 bits per channel, RGB, deflate, adaptive filtering, no interlacing.
+        for (const u8 value : {8, 2, 0, 0, 0}) {
+            header.WriteU8(value);
+        }
+
+        WritePngChunk(writer, "IHDR", header.GetData());
+        WritePngChunk(writer, "IDAT", MakeStoredZlibStream(width, height, rgb));
+        WritePngChunk(writer, "IEND", {});
+
+        return WriteFile(path, writer.GetData());
+    }
+
+    bool WriteExr(const std::filesystem::path& path, const u32 width, const u32 height,
+                  const std::span<const f32> rgb) {
+        constexpr i32 floatPixelType = 2;
+        // Channels are stored in alphabetical order.
+        constexpr std::array<std::string_view, 3> channelNames = {"B", "G", "R"};
+        constexpr std::array<usize, 3> channelOffsets = {2, 1, 0};
+
+        ByteWriter writer;
+        writer.WriteLittleEndian(20000630);
+        // Version 2, single-part scanline image.
+        writer.WriteLittleEndian(2);
+
+        ByteWriter channels;
+        for (const std::string_view name : channelNames) {
+            channels.WriteString(name);
+            channels.WriteU8(0);
+            channels.WriteLittleEndian(floatPixelType);
+            // Linear flag and reserved bytes, then the x and y sampling.
+            channels.WriteLittleEndian(0);
+            channels.WriteLittleEndian(1);
+            channels.WriteLittleEndian(1);
+        }
+        channels.WriteU8(0);
+
+        const std::vector<u8> window = PackLittleEndian(0, 0, static_cast<i32>(width) - 1,
+                                                        static_cast<i32>(height) - 1);
+
+        WriteExrAttribute(writer, "channels", "chlist", channels.GetData());
+        WriteExrAttribute(writer, "compression", "compression", std::array<u8, 1>{0});
+        WriteExrAttribute(writer, "dataWindow", "box2i", window);
+        WriteExrAttribute(writer, "displayWindow", "box2i", window);
+        WriteExrAttribute(writer, "lineOrder", "lineOrder", std::array<u8, 1>{0});
+        WriteExrAttribute(writer, "pixelAspectRatio", "float", PackLittleEndian(1.f));
+        WriteExrAttribute(writer, "screenWindowCenter", "v2f", PackLittleEndian(0.f, 0.f));
+        WriteExrAttribute(writer, "screenWindowWidth", "float", PackLittleEndian(1.f));
+        writer.WriteU8(0);
+
+        // Uncompressed images have one scanline per chunk, the offset table points to each of them.
+        const u64 scanlineDataSize = static_cast<u64>(width) * channelNames.size() * sizeof(f32);
+        const u64 firstScanlineOffset = writer.GetSize() + static_cast<u64>(height) * sizeof(u64);
+        for (u32 y = 0; y < height; y++) {
+            writer.WriteLittleEndian(firstScanlineOffset + y * (2 * sizeof(i32) + scanlineDataSize));
+        }
+
+        for (u32 y = 0; y < height; y++) {
+            writer.WriteLittleEndian(static_cast<i32>(y));
+            writer.WriteLittleEndian(static_cast<i32>(scanlineDataSize));
+
+            const usize rowOffset = static_cast<usize>(y) * width * 3;
+            for (const usize channelOffset : channelOffsets) {
+                for (u32 x = 0; x < width; x++) {
+                    writer.WriteLittleEndian(rgb[rowOffset + x * 3 + channelOffset]);
+                }
+            }
+        }
+
+        return WriteFile(path, writer.GetData());
+    }
+}
@@ -0,0 +1,96 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Core/MappedFile.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Raytracer {
+#if defined(_WIN32)
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            Log::RtError("Failed to open {0} for mapping.", path.string());
+            return;
+        }
+        m_FileHandle = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            return;
+        }
+
+        const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            Log::RtError("Failed to map {0}.", path.string());
+            return;
+        }
+        m_MappingHandle = mapping;
+
+        m_Data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_Data == nullptr) {
+            Log::RtError("Failed to map {0}.", path.string());
+            return;
+        }
+        m_Size = static_cast<usize>(size.QuadPart);
+    }
+
+    MappedFile::~MappedFile() {
+        if (m_Data != nullptr) {
+            UnmapViewOfFile(m_Data);
+        }
+        if (m_MappingHandle != nullptr) {
+            CloseHandle(m_MappingHandle);
+        }
+        if (m_FileHandle != nullptr) {
+            CloseHandle(m_FileHandle);
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        m_FileDescriptor = open(path.c_str(), O_RDONLY);
+        if (m_FileDescriptor < 0) {
+            Log::RtError("Failed to open {0} for mapping.", path.string());
+            return;
+        }
+
+        struct stat status{};
+        if (fstat(m_FileDescriptor, &status) != 0 || status.st_size == 0) {
+            return;
+        }
+
+        void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+        if (data == MAP_FAILED) {
+            Log::RtError("Failed to map {0}.", path.string());
+            return;
+        }
+        // Accessors are mostly read front to back.
+        madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+
+        m_Data = static_cast<const std::byte*>(data);
+        m_Size = static_cast<usize>(status.st_size);
+    }
+
+    MappedFile::~MappedFile() {
+        if (m_Data != nullptr) {
+            munmap(const_cast<std::byte*>(m_Data), m_Size);
+        }
+        if (m_FileDescriptor >= 0) {
+            close(m_FileDescriptor);
+        }
+    }
+#endif
+}
@@ -9,11 +9,18 @@
 #include <imgui.h>
 
 #include <cassert>
+#include <cstring>
+#include <format>
+#include <system_error>
 
 namespace Raytracer {
     Application* Application::m_SInstance = nullptr;
 
-    Application::Application(const WindowProperties& properties, const DebugLevel& debugLevel) {
+    Application::Application(const WindowProperties& properties, const DebugLevel& debugLevel,
+                             const std::filesystem::path& scenePath,
+                             const std::optional<Scene::ProceduralSceneSettings>& proceduralScene,
+                             const std::optional<HeadlessSettings>& headless,
+                             const RenderOptions& renderOptions) : m_Headless(headless) {
         assert(!m_SInstance && "Only one instance of this application can run at a time.");
 
         m_SInstance = this;
@@ -26,16 +33,49 @@ namespace Raytracer {
         m_Camera.Pitch = 0;
         m_Camera.Yaw = 0;
 
-        m_Window = std::make_unique<Window>(properties);
-        m_Window->SetEventCallback([this](Event& event) {
-            EventDispatcher dispatcher(event);
-            dispatcher.Dispatch<WindowCloseEvent>(BIND_EVENT_TO_EVENT_HANDLER(Application::OnWindowClose));
-            OnEvent(event);
-        });
-
-        m_Renderer = std::make_unique<Renderer::VulkanRenderer>(*m_Window, debugLevel);
+        if (m_Headless) {
+            if (!m_Headless->CaptureDirectory.empty()) {
+                std::error_code error;
+                std::filesystem::create_directories(m_Headless->CaptureDirectory, error);
+                if (error) {
+                    Log::RtWarn("Failed to create the capture directory {0}: {1}.",
+                                m_Headless->CaptureDirectory.string(), error.message());
+                }
+            }
+
+            // GLFW is never initialized, nothing requires a display server.
+            const VkExtent2D extent = {static_cast<u32>(properties.Width), static_cast<u32>(properties.Height)};
+            m_Renderer = std::make_unique<Renderer::VulkanRenderer>(extent, debugLevel);
+        } else {
+            m_Window = std::make_unique<Window>(properties);
+            m_Window->SetEventCallback([this](Event& event) {
+                EventDispatcher dispatcher(event);
+                dispatcher.Dispatch<WindowCloseEvent>(BIND_EVENT_TO_EVENT_HANDLER(Application::OnWindowClose));
+                OnEvent(event);
+            });
+
+            m_Renderer = std::make_unique<Renderer::VulkanRenderer>(*m_Window, debugLevel);
+        }
 
         m_RayQueryRenderer = std::make_unique<RayQueryRenderer>(m_Renderer.get(), m_Camera);
+        m_RayQueryRenderer->SetVertexQuantizationEnabled(renderOptions.VertexQuantization);
+        m_RayQueryRenderer->SetBottomLevelCompactionEnabled(renderOptions.BottomLevelCompaction);
+        if (!renderOptions.BottomLevelCacheDirectory.empty()) {
+            m_RayQueryRenderer->EnableBottomLevelCache(renderOptions.BottomLevelCacheDirectory);
+        }
+
+        // The first frames show up while the scene is still being read.
+        m_SceneStreamer = std::make_unique<SceneStreamer>(*m_RayQueryRenderer);
+        if (proceduralScene) {
+            m_ProceduralSettings = *proceduralScene;
+
+            m_SceneStreamer->RequestGeneratedScene(m_ProceduralSettings);
+        } else if (!scenePath.empty()) {
+            const std::string scenePathString = scenePath.string();
+            std::strncpy(m_ScenePathInput.data(), scenePathString.c_str(), m_ScenePathInput.size() - 1);
+
+            m_SceneStreamer->RequestScene(scenePath);
+        }
 
         m_IsRunning = true;
 
@@ -50,7 +90,9 @@ namespace Raytracer {
 
     void Application::Run() {
         while (m_IsRunning) {
-            m_Window->Update();
+            if (m_Window) {
+                m_Window->Update();
+            }
 
             // Compute delta time.
             const auto oldTime = m_CurrentTime;
@@ -60,11 +102,17 @@ namespace Raytracer {
             m_DeltaTime = timeSpan.count() / 1000.f;
 
             OnUpdate();
-            OnRender();
+            if (m_Headless) {
+                OnHeadlessRender();
+            } else {
+                OnRender();
+            }
         }
     }
 
     void Application::OnUpdate() {
+        m_SceneStreamer->Update();
+
         m_Camera.Update();
 
         if (m_Fov != m_Camera.Fov) {
@@ -80,9 +128,57 @@ namespace Raytracer {
         
         const auto commandBuffer = m_Renderer->BeginCommandBuffer(*m_Window);
 
+        m_RayQueryRenderer->Render(commandBuffer);
+
         m_Renderer->EndCommandBuffer(*m_Window);
     }
 
+    void Application::OnHeadlessRender() {
+        // A failed or empty scene would only produce blank frames, the caller is told instead.
+        if (!m_SceneStreamer->IsLoading() && !m_SceneStreamer->HasScene()) {
+            Log::RtError("No scene to render, headless rendering stopped.");
+
+            m_Failed = true;
+            Close();
+            return;
+        }
+
+        // Frames rendered while the scene streams in or while its BLAS build aren't counted, every counted frame shows
+        // the whole scene.
+        const bool sceneReady = !m_SceneStreamer->IsLoading() && m_RayQueryRenderer->IsSceneBuilt();
+        if (sceneReady && m_HeadlessFramesRendered == 0) {
+            m_HeadlessStartTime = std::chrono::high_resolution_clock::now();
+        }
+
+        const auto commandBuffer = m_Renderer->BeginCommandBuffer();
+
+        m_RayQueryRenderer->Render(commandBuffer);
+
+        // Recorded at the end of the frame, the encoding overlaps with the next frames.
+        if (sceneReady && !m_Headless->CaptureDirectory.empty()) {
+            m_Renderer->CaptureDrawImage(m_Headless->CaptureDirectory /
+                                         std::format("frame_{0:05}", m_HeadlessFramesRendered));
+        }
+
+        m_Renderer->EndCommandBuffer();
+
+        if (!sceneReady) {
+            return;
+        }
+
+        m_HeadlessFramesRendered++;
+        if (m_HeadlessFramesRendered >= m_Headless->FrameCount) {
+            vkDeviceWaitIdle(m_Renderer->GetDevice().GetDevice());
+
+            const std::chrono::duration<f64, std::milli> renderTime =
+                std::chrono::high_resolution_clock::now() - m_HeadlessStartTime;
+            Log::RtInfo("Rendered {0} headless frames in {1:.1f} ms, {2:.3f} ms per frame.", m_HeadlessFramesRendered,
+                        renderTime.count(), renderTime.count() / m_HeadlessFramesRendered);
+
+            Close();
+        }
+    }
+
     void Application::OnEvent(Event& event) {
         EventDispatcher dispatcher(event);
         dispatcher.Dispatch<MouseMovedEvent>(BIND_EVENT_TO_EVENT_HANDLER(Application::OnMouseMovement));
@@ -95,6 +191,93 @@ namespace Raytracer {
             ImGui::SliderFloat("Camera speed", &m_CameraSpeed, 0.1f, 10.f);
             ImGui::SliderFloat("Mouse sensitivity", &m_MouseSensitivity, 0.1f, 10.f);
             ImGui::SliderFloat("Camera FOV", &m_Fov, 45.f, 90.f);
+            ImGui::Text("Accumulated frames: %u / %u", m_RayQueryRenderer->GetAccumulatedFrameCount(),
+                        g_MaxAccumulatedFrames);
+        }
+        ImGui::End();
+
+        if (ImGui::Begin("Light")) {
+            glm::vec3 lightPosition = m_RayQueryRenderer->GetLightPosition();
+            if (ImGui::DragFloat3("Position", &lightPosition.x, 0.1f)) {
+                m_RayQueryRenderer->SetLightPosition(lightPosition);
+            }
+
+            f32 lightRadius = m_RayQueryRenderer->GetLightRadius();
+            if (ImGui::SliderFloat("Radius", &lightRadius, 0.f, g_MaxLightRadius)) {
+                m_RayQueryRenderer->SetLightRadius(lightRadius);
+            }
+            ImGui::SetItemTooltip("0 makes it a point light, with hard shadows traced by a single ray.");
+        }
+        ImGui::End();
+
+        if (ImGui::Begin("Ambient occlusion")) {
+            constexpr u32 minSampleCount = 1;
+            AmbientOcclusionSettings settings = m_RayQueryRenderer->GetAmbientOcclusionSettings();
+            bool changed = ImGui::SliderScalar("Samples per pixel", ImGuiDataType_U32, &settings.SampleCount,
+                                               &minSampleCount, &g_MaxAmbientOcclusionSampleCount);
+            changed |= ImGui::SliderFloat("Ray distance", &settings.RayDistance, 0.1f, 20.f);
+            changed |= ImGui::Checkbox("Adaptive sampling", &settings.AdaptiveSampling);
+            if (settings.AdaptiveSampling) {
+                changed |= ImGui::SliderScalar("Min samples", ImGuiDataType_U32, &settings.MinSampleCount,
+                                               &minSampleCount, &g_MaxAmbientOcclusionSampleCount);
+                changed |= ImGui::SliderScalar("Max samples", ImGuiDataType_U32, &settings.MaxSampleCount,
+                                               &minSampleCount, &g_MaxAmbientOcclusionSampleCount);
+                changed |= ImGui::SliderFloat("Variance threshold", &settings.VarianceThreshold, 1e-6f, 1e-2f, "%.1e",
+                                              ImGuiSliderFlags_Logarithmic);
+            }
+            if (changed) {
+                m_RayQueryRenderer->SetAmbientOcclusionSettings(settings);
+            }
+        }
+        ImGui::End();
+
+        if (ImGui::Begin("Denoiser")) {
+            DenoiserSettings settings = m_RayQueryRenderer->GetDenoiserSettings();
+            bool changed = ImGui::SliderScalar("Iterations", ImGuiDataType_U32, &settings.Iterations,
+                                               &g_MinDenoiserIterations, &g_MaxDenoiserIterations);
+            changed |= ImGui::SliderScalar("Kernel radius", ImGuiDataType_U32, &settings.KernelRadius,
+                                           &g_MinDenoiserKernelRadius, &g_MaxDenoiserKernelRadius);
+            if (changed) {
+                m_RayQueryRenderer->SetDenoiserSettings(settings);
+            }
+        }
+        ImGui::End();
+
+        if (ImGui::Begin("Scene")) {
+            bool vertexQuantization = m_RayQueryRenderer->IsVertexQuantizationEnabled();
+            if (ImGui::Checkbox("Quantized vertices", &vertexQuantization)) {
+                m_RayQueryRenderer->SetVertexQuantizationEnabled(vertexQuantization);
+            }
+            ImGui::SetItemTooltip("Applies to the meshes of the scenes loaded afterward.");
+
+            ImGui::InputText("Path", m_ScenePathInput.data(), m_ScenePathInput.size());
+            if (ImGui::Button("Load") && m_ScenePathInput[0] != '\0') {
+                m_SceneStreamer->RequestScene(m_ScenePathInput.data());
+            }
+
+            if (ImGui::TreeNode("Generate")) {
+                constexpr std::array<const char*, 3> layoutNames = {"Grid", "Triangle soup", "Overlapping"};
+                i32 layout = static_cast<i32>(m_ProceduralSettings.Layout);
+                if (ImGui::Combo("Layout", &layout, layoutNames.data(), static_cast<i32>(layoutNames.size()))) {
+                    m_ProceduralSettings.Layout = static_cast<Scene::ProceduralLayout>(layout);
+                }
+
+                ImGui::InputScalar("Triangles per mesh", ImGuiDataType_U32, &m_ProceduralSettings.TriangleCount);
+                ImGui::InputScalar("Instances", ImGuiDataType_U32, &m_ProceduralSettings.InstanceCount);
+                ImGui::InputScalar("Meshes", ImGuiDataType_U32, &m_ProceduralSettings.MeshCount);
+                ImGui::SliderFloat("Overlap", &m_ProceduralSettings.Overlap, 0.f, 1.f);
+                ImGui::InputScalar("Seed", ImGuiDataType_U64, &m_ProceduralSettings.Seed);
+
+                if (ImGui::Button("Generate")) {
+                    m_SceneStreamer->RequestGeneratedScene(m_ProceduralSettings);
+                }
+
+                ImGui::TreePop();
+            }
+
+            if (m_SceneStreamer->IsLoading()) {
+                ImGui::ProgressBar(m_SceneStreamer->GetProgress());
+            }
         }
         ImGui::End();
     }
@@ -111,6 +294,14 @@ namespace Raytracer {
 
     void Application::OnKeyDown(const KeyDownEvent& event) {
         m_Camera.OnKeyDown(event.GetScancode(), m_DeltaTime, 3);
+
+        if (event.GetScancode() == static_cast<i32>(Keys::F12)) {
+            std::error_code error;
+            std::filesystem::create_directories(g_CaptureDirectory, error);
+
+            m_Renderer->CaptureDrawImage(std::filesystem::path(g_CaptureDirectory) /
+                                         std::format("capture_{0:04}", m_CaptureCount++));
+        }
     }
 
     void Application::OnKeyUp(const KeyUpEvent& event) {
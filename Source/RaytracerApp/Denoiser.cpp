@@ -0,0 +1,150 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/RaytracerApp/Denoiser.hpp>
+
+#include <Raytracer/Renderer/VulkanInitializers.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanImageUtils.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanPipelineUtils.hpp>
+
+#include <algorithm>
+#include <array>
+
+namespace Raytracer {
+    namespace {
+        // Matches denoise.comp.
+        constexpr VkFormat g_FilterImageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    }
+
+    Denoiser::Denoiser(Renderer::VulkanRenderer* renderer) : m_Renderer(renderer) {
+        InitializeImages();
+        InitializePipeline();
+    }
+
+    Denoiser::~Denoiser() {
+        vkDeviceWaitIdle(m_Renderer->GetDevice().GetDevice());
+
+        m_DeletionQueue.Flush();
+    }
+
+    void Denoiser::Denoise(const VkCommandBuffer commandBuffer, const Renderer::AllocatedImage& accumulation,
+                           const Renderer::AllocatedImage& normalDepth) {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+        const VkExtent2D drawExtent = m_Renderer->DrawExtent;
+
+        // Waits for the accumulation pass. The filter images only live for the frame.
+        Renderer::VulkanUtils::TransitionImage(commandBuffer, accumulation.Image, VK_IMAGE_LAYOUT_GENERAL,
+                                               VK_IMAGE_LAYOUT_GENERAL);
+        for (const Renderer::AllocatedImage& image : m_FilterImages) {
+            Renderer::VulkanUtils::TransitionImage(commandBuffer, image.Image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                   VK_IMAGE_LAYOUT_GENERAL);
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+
+        // A single unfiltered pass still shades the accumulation into the draw image.
+        const u32 passCount = std::max(m_Settings.Iterations, 1u);
+        const u32 kernelRadius = m_Settings.Iterations > 0 ? m_Settings.KernelRadius : 0;
+        for (u32 pass = 0; pass < passCount; pass++) {
+            const Renderer::AllocatedImage& input = m_FilterImages[(pass + 1) % 2];
+            const Renderer::AllocatedImage& output = m_FilterImages[pass % 2];
+
+            if (pass > 0) {
+                Renderer::VulkanUtils::TransitionImage(commandBuffer, input.Image, VK_IMAGE_LAYOUT_GENERAL,
+                                                       VK_IMAGE_LAYOUT_GENERAL);
+            }
+
+            const VkDescriptorSet descriptorSet = m_Renderer->GetFrameDescriptors().Allocate(device,
+                                                                                             m_DescriptorLayout);
+
+            // Matches denoise.comp.
+            const std::array<VkImageView, 5> imageViews = {
+                accumulation.ImageView, input.ImageView, output.ImageView, normalDepth.ImageView,
+                m_Renderer->DrawImage.ImageView
+            };
+
+            Renderer::DescriptorWriter writer;
+            for (u32 binding = 0; binding < imageViews.size(); binding++) {
+                writer.WriteImage(binding, imageViews[binding], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL,
+                                  VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            }
+            writer.UpdateSet(device, descriptorSet);
+
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1,
+                                    &descriptorSet, 0, nullptr);
+
+            const DenoisePushConstants pushConstants{
+                .Extent = glm::uvec2(drawExtent.width, drawExtent.height),
+                .StepSize = 1u << pass,
+                .KernelRadius = kernelRadius,
+                .FirstPass = pass == 0 ? 1u : 0u,
+                .LastPass = pass == passCount - 1 ? 1u : 0u
+            };
+            vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               sizeof(DenoisePushConstants), &pushConstants);
+
+            // 8x8 work groups.
+            vkCmdDispatch(commandBuffer, (drawExtent.width + 7) / 8, (drawExtent.height + 7) / 8, 1);
+        }
+    }
+
+    void Denoiser::InitializeImages() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        for (Renderer::AllocatedImage& image : m_FilterImages) {
+            image = Renderer::VulkanUtils::CreateImage(allocator, device, m_Renderer->DrawImage.ImageExtent,
+                                                       g_FilterImageFormat, VK_IMAGE_USAGE_STORAGE_BIT);
+        }
+
+        m_DeletionQueue.PushFunction([this, device, allocator]() {
+            for (const Renderer::AllocatedImage& image : m_FilterImages) {
+                Renderer::VulkanUtils::DestroyImage(allocator, device, image);
+            }
+        });
+    }
+
+    void Denoiser::InitializePipeline() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        Renderer::DescriptorLayoutBuilder builder;
+        for (u32 binding = 0; binding < 5; binding++) {
+            builder.AddBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        }
+        m_DescriptorLayout = builder.Build(device, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VkShaderModule computeShader;
+        if (!Renderer::VulkanUtils::CreateShaderModule(device, "Shaders/denoise.comp.spv", &computeShader)) {
+            Log::RtFatal({0x02, 0x05}, "Failed to load the denoiser compute shader.");
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DenoisePushConstants);
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = Renderer::VulkanInit::PipelineLayoutCreateInfo();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_DescriptorLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout))
+
+        VkComputePipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipelineInfo.stage = Renderer::VulkanInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                                 computeShader);
+        pipelineInfo.layout = m_PipelineLayout;
+
+        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline))
+
+        vkDestroyShaderModule(device, computeShader, nullptr);
+
+        m_DeletionQueue.PushFunction([this, device]() {
+            vkDestroyPipeline(device, m_Pipeline, nullptr);
+            vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(device, m_DescriptorLayout, nullptr);
+        });
+    }
+}
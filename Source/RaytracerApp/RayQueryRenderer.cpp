@@ -5,15 +5,962 @@
 
 #include <Raytracer/RaytracerApp/RayQueryRenderer.hpp>
 
+#include <Raytracer/Core/Hash.hpp>
+
+#include <Raytracer/Renderer/VulkanInitializers.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanImageUtils.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanPipelineUtils.hpp>
+
+#include <Raytracer/Scene/MeshHash.hpp>
+
+#include <algorithm>
+#include <array>
+
 namespace Raytracer {
+    namespace {
+        // Matches accumulate.comp. The lighting only needs the precision of a single frame, the running mean is kept
+        // in full float so that late frames still move it.
+        constexpr VkFormat g_LightingImageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        constexpr VkFormat g_MotionImageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        constexpr VkFormat g_NormalDepthImageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        constexpr VkFormat g_AccumulationImageFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+        void DestroyMeshBuffers(const VmaAllocator allocator, const Renderer::GPUMeshBuffers& buffers) {
+            Renderer::VulkanUtils::DestroyBuffer(allocator, buffers.IndexBuffer);
+            Renderer::VulkanUtils::DestroyBuffer(allocator, buffers.VertexBuffer);
+            if (buffers.PositionBuffer.Buffer != VK_NULL_HANDLE) {
+                Renderer::VulkanUtils::DestroyBuffer(allocator, buffers.PositionBuffer);
+            }
+        }
+    }
 
     RayQueryRenderer::RayQueryRenderer(Renderer::VulkanRenderer* renderer, Camera& camera) : m_Renderer(
-        renderer) {
+        renderer), m_Camera(camera), m_Denoiser(renderer), m_AccelerationStructures(renderer) {
+        InitializeDescriptors();
+        InitializePipeline();
+        InitializeDepthImage();
+        InitializeAccumulation();
+        InitializeOpacityTextures();
     }
 
     RayQueryRenderer::~RayQueryRenderer() {
         vkDeviceWaitIdle(m_Renderer->GetDevice().GetDevice());
 
+        for (const Mesh& mesh : m_Meshes) {
+            if (mesh.Buffers.IndexBuffer.Buffer != VK_NULL_HANDLE) {
+                DestroyMeshBuffers(m_Renderer->GetAllocator(), mesh.Buffers);
+            }
+        }
+
+        for (const ReleasedMeshBuffers& released : m_ReleasedMeshBuffers) {
+            DestroyMeshBuffers(m_Renderer->GetAllocator(), released.Buffers);
+        }
+
+        for (const Renderer::AllocatedImage& texture : m_OpacityTextures) {
+            if (texture.Image != VK_NULL_HANDLE) {
+                Renderer::VulkanUtils::DestroyImage(m_Renderer->GetAllocator(), m_Renderer->GetDevice().GetDevice(),
+                                                    texture);
+            }
+        }
+
         m_DeletionQueue.Flush();
     }
+
+    u32 RayQueryRenderer::AddOpacityTexture(const void* texels, const VkExtent2D extent) {
+        if (m_OpacityTextures.size() >= g_MaxOpacityTextures && m_FreeOpacityTextures.empty()) {
+            Log::RtWarn("Too many opacity textures, at most {0} are supported. The texture is traced as opaque.",
+                        g_MaxOpacityTextures);
+            return g_NoOpacityTexture;
+        }
+
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        const Renderer::AllocatedImage texture = Renderer::VulkanUtils::CreateImage(
+            m_Renderer->GetAllocator(), device, m_Renderer, texels, VkExtent3D{extent.width, extent.height, 1},
+            VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+
+        return RegisterOpacityTexture(texture);
+    }
+
+    u32 RayQueryRenderer::AddOpacityTexture(const Scene::TextureData& texture) {
+        // KTX2 textures are always block-compressed, the device may not sample them.
+        if (!m_Renderer->GetDevice().IsTextureCompressionBCEnabled()) {
+            Log::RtError("The device doesn't support BC textures, a {0}x{1} KTX2 opacity texture is traced as "
+                         "opaque.", texture.Width, texture.Height);
+            return g_NoOpacityTexture;
+        }
+
+        if (m_OpacityTextures.size() >= g_MaxOpacityTextures && m_FreeOpacityTextures.empty()) {
+            Log::RtWarn("Too many opacity textures, at most {0} are supported. The texture is traced as opaque.",
+                        g_MaxOpacityTextures);
+            return g_NoOpacityTexture;
+        }
+
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        // The shaders read the opacity from the alpha channel.
+        VkComponentMapping components{};
+        if (texture.Format == VK_FORMAT_BC4_UNORM_BLOCK || texture.Format == VK_FORMAT_BC4_SNORM_BLOCK) {
+            components.a = VK_COMPONENT_SWIZZLE_R;
+        }
+
+        const Renderer::AllocatedImage image = Renderer::VulkanUtils::CreateImage(
+            m_Renderer->GetAllocator(), device, m_Renderer, texture.Data, texture.LevelOffsets,
+            VkExtent3D{texture.Width, texture.Height, 1}, texture.Format, VK_IMAGE_USAGE_SAMPLED_BIT, components);
+
+        return RegisterOpacityTexture(image);
+    }
+
+    u32 RayQueryRenderer::AddMesh(const std::span<const Renderer::Vertex> vertices,
+                                  const std::span<const u32> indices) {
+        // Identical meshes, e.g. the same asset imported from several files, are only uploaded once.
+        const u64 meshHash = GetMeshHash(Scene::HashMeshContent(vertices, indices), m_VertexQuantizationEnabled);
+        if (const auto existingMesh = FindMesh(meshHash, vertices.size(), indices.size())) {
+            return *existingMesh;
+        }
+
+        Mesh mesh{};
+        mesh.VertexCount = static_cast<u32>(vertices.size());
+        mesh.IndexCount = static_cast<u32>(indices.size());
+        mesh.Quantized = m_VertexQuantizationEnabled;
+
+        if (mesh.Quantized) {
+            const Renderer::QuantizedMesh quantizedMesh = Renderer::QuantizeVertices(vertices);
+
+            mesh.Buffers = m_Renderer->UploadQuantizedMesh(indices, quantizedMesh);
+            mesh.DequantizationScale = glm::vec4(quantizedMesh.DequantizationScale, 0.f);
+            mesh.DequantizationOffset = glm::vec4(quantizedMesh.DequantizationOffset, 0.f);
+            mesh.Dequantization = quantizedMesh.GetDequantizationMatrix();
+        } else {
+            mesh.Buffers = m_Renderer->UploadMesh(indices, vertices);
+            mesh.DequantizationScale = glm::vec4(1.f, 1.f, 1.f, 0.f);
+            mesh.DequantizationOffset = glm::vec4(0.f);
+            mesh.Dequantization = glm::mat4(1.f);
+        }
+
+        return RegisterMesh(mesh, meshHash, Scene::HashMeshPositions(vertices, indices));
+    }
+
+    u32 RayQueryRenderer::AddCookedMesh(const Scene::CookedScene& scene, const usize cookedMeshIndex) {
+        const Scene::CookedMesh& cookedMesh = scene.GetMeshes()[cookedMeshIndex];
+
+        // Cooked streams are in the full vertex layout, the hashes come precomputed from the tables.
+        const u64 meshHash = GetMeshHash(cookedMesh.ContentHash, false);
+        if (const auto existingMesh = FindMesh(meshHash, cookedMesh.VertexCount, cookedMesh.IndexCount)) {
+            return *existingMesh;
+        }
+
+        const Renderer::MeshStreamRange range{
+            cookedMesh.VertexOffset, cookedMesh.VertexCount * sizeof(Renderer::Vertex),
+            cookedMesh.IndexOffset, cookedMesh.IndexCount * sizeof(u32)
+        };
+
+        Mesh mesh{};
+        mesh.Buffers = m_Renderer->UploadPackedMeshes(scene.GetGeometry(), std::span(&range, 1))[0];
+        mesh.VertexCount = cookedMesh.VertexCount;
+        mesh.IndexCount = cookedMesh.IndexCount;
+        mesh.Quantized = false;
+        mesh.DequantizationScale = glm::vec4(1.f, 1.f, 1.f, 0.f);
+        mesh.DequantizationOffset = glm::vec4(0.f);
+        mesh.Dequantization = glm::mat4(1.f);
+
+        return RegisterMesh(mesh, meshHash, cookedMesh.PositionHash);
+    }
+
+    u32 RayQueryRenderer::AddInstance(const u32 meshIndex, const glm::mat4& transform, const MeshMaterial& material,
+                                      const u8 layers) {
+        m_Instances.push_back({meshIndex, transform, material, layers});
+        m_InstancesDirty = true;
+        m_InstanceTopologyDirty = true;
+
+        return static_cast<u32>(m_Instances.size() - 1);
+    }
+
+    void RayQueryRenderer::ClearInstances() {
+        m_Instances.clear();
+        m_InstancesDirty = true;
+        m_InstanceTopologyDirty = true;
+    }
+
+    void RayQueryRenderer::SetInstanceTransform(const u32 instanceIndex, const glm::mat4& transform) {
+        m_Instances[instanceIndex].Transform = transform;
+        m_InstancesDirty = true;
+    }
+
+    void RayQueryRenderer::ReleaseUnusedMeshes() {
+        std::vector<bool> meshesUsed(m_Meshes.size(), false);
+        std::vector<bool> opacityTexturesUsed(m_OpacityTextures.size(), false);
+        for (const MeshInstance& instance : m_Instances) {
+            meshesUsed[instance.MeshIndex] = true;
+            if (instance.Material.OpacityTexture != g_NoOpacityTexture) {
+                opacityTexturesUsed[instance.Material.OpacityTexture] = true;
+            }
+        }
+
+        // Meshes with the same positions share a BLAS, whose queued build reads the buffers of whichever mesh added it.
+        std::unordered_map<u32, u32> usedMeshesByBottomLevel;
+        for (u32 meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++) {
+            if (meshesUsed[meshIndex]) {
+                usedMeshesByBottomLevel.emplace(m_Meshes[meshIndex].BottomLevelIndex, meshIndex);
+            }
+        }
+
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        // Frames in flight may still draw the released meshes and sample the released textures, builds already
+        // submitted may still read their buffers.
+        const u64 computeTicket = m_Renderer->GetComputeQueue().GetLastSubmittedTicket();
+        u32 releasedMeshCount = 0;
+        for (u32 meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++) {
+            Mesh& mesh = m_Meshes[meshIndex];
+            if (meshesUsed[meshIndex] || mesh.Buffers.IndexBuffer.Buffer == VK_NULL_HANDLE) {
+                continue;
+            }
+
+            if (const auto it = usedMeshesByBottomLevel.find(mesh.BottomLevelIndex);
+                it != usedMeshesByBottomLevel.end()) {
+                m_AccelerationStructures.RetargetPendingBuild(mesh.BottomLevelIndex,
+                                                              MakeBottomLevelGeometry(m_Meshes[it->second]));
+            }
+
+            m_MeshesByContentHash.erase(mesh.Hash);
+            m_AccelerationStructures.RemoveBottomLevel(mesh.BottomLevelIndex);
+            m_ReleasedMeshBuffers.push_back({computeTicket, mesh.Buffers});
+
+            mesh = {};
+            m_FreeMeshes.push_back(meshIndex);
+            releasedMeshCount++;
+        }
+
+        u32 releasedOpacityTextureCount = 0;
+        for (u32 textureIndex = 0; textureIndex < m_OpacityTextures.size(); textureIndex++) {
+            Renderer::AllocatedImage& texture = m_OpacityTextures[textureIndex];
+            if (opacityTexturesUsed[textureIndex] || texture.Image == VK_NULL_HANDLE) {
+                continue;
+            }
+
+            m_Renderer->PlanFrameDeletion([allocator, device, texture]() {
+                Renderer::VulkanUtils::DestroyImage(allocator, device, texture);
+            });
+
+            texture = {};
+            m_FreeOpacityTextures.push_back(textureIndex);
+            releasedOpacityTextureCount++;
+        }
+
+        if (releasedMeshCount > 0 || releasedOpacityTextureCount > 0) {
+            Log::RtInfo("Released {0} meshes and {1} opacity textures no longer instanced.", releasedMeshCount,
+                        releasedOpacityTextureCount);
+        }
+    }
+
+    void RayQueryRenderer::Render(const VkCommandBuffer commandBuffer) {
+        // Meshes added at runtime are built on the compute queue while frames keep going, their instances join the
+        // TLAS once their BLAS is ready. Meshes streamed in while a batch is building join the next batch instead of
+        // blocking the frame on the scratch arena.
+        if (m_AccelerationStructures.HasPendingBuilds() && !m_AccelerationStructures.IsScratchArenaInUse()) {
+            m_AccelerationStructures.BuildBottomLevels();
+        }
+
+        if (m_AccelerationStructures.PollBottomLevels() > 0) {
+            m_InstancesDirty = true;
+            m_InstanceTopologyDirty = true;
+        }
+
+        std::erase_if(m_ReleasedMeshBuffers, [this](const ReleasedMeshBuffers& released) {
+            if (!m_Renderer->GetComputeQueue().IsComplete(released.ComputeTicket)) {
+                return false;
+            }
+
+            m_Renderer->PlanFrameDeletion([allocator = m_Renderer->GetAllocator(), buffers = released.Buffers]() {
+                DestroyMeshBuffers(allocator, buffers);
+            });
+            return true;
+        });
+
+        // The TLAS update goes in the same command buffer as the shading work that traces against it.
+        if (m_InstancesDirty) {
+            GatherAccelerationStructureInstances();
+            m_AccelerationStructures.UpdateTopLevel(commandBuffer, m_AccelerationStructureInstances,
+                                                    m_InstanceTopologyDirty);
+
+            m_InstancesDirty = false;
+            m_InstanceTopologyDirty = false;
+            m_HistoryValid = false;
+            m_AccumulatedFrameCount = 0;
+        }
+
+        // Nothing to trace yet while the first meshes stream in, the frame shows the empty background instead of
+        // whatever the draw image held.
+        if (m_AccelerationStructures.GetTopLevel() == VK_NULL_HANDLE) {
+            constexpr VkClearColorValue clearColor{{0.f, 0.f, 0.f, 1.f}};
+            const VkImageSubresourceRange range = Renderer::VulkanInit::ImageSubresourceRange(
+                VK_IMAGE_ASPECT_COLOR_BIT);
+            vkCmdClearColorImage(commandBuffer, m_Renderer->DrawImage.Image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1,
+                                 &range);
+            return;
+        }
+
+        // Read before the view matrix is computed, which clears the flag.
+        const bool cameraUpdated = m_Camera.Updated;
+        GlobalUniform globalUniform = MakeGlobalUniform();
+
+        // The history follows the camera through the motion vectors, only the still frames count restarts. The camera
+        // keeps moving between two input events while a key is held, so the matrices are compared too.
+        const glm::mat4 viewProjection = globalUniform.Projection * globalUniform.View;
+        if (cameraUpdated || viewProjection != m_PreviousViewProjection) {
+            m_AccumulatedFrameCount = 0;
+        }
+
+        // Pixels no longer match their history once the extent changes.
+        const VkExtent2D drawExtent = m_Renderer->DrawExtent;
+        if (drawExtent.width != m_PreviousExtent.width || drawExtent.height != m_PreviousExtent.height) {
+            m_PreviousExtent = drawExtent;
+            m_HistoryValid = false;
+            m_AccumulatedFrameCount = 0;
+        }
+
+        // Converged views skip the raster pass and its rays entirely.
+        const bool addFrame = m_AccumulatedFrameCount < g_MaxAccumulatedFrames;
+        if (addFrame) {
+            globalUniform.PreviousViewProjection = m_PreviousViewProjection;
+            globalUniform.FrameIndex = m_FrameIndex++;
+            globalUniform.HistoryValid = m_HistoryValid ? 1u : 0u;
+
+            m_PreviousViewProjection = viewProjection;
+            m_HistoryIndex ^= 1;
+
+            BuildDrawBatches();
+
+            RenderLighting(commandBuffer, WriteSceneDescriptorSet(globalUniform));
+            AccumulateLighting(commandBuffer);
+
+            m_HistoryValid = true;
+            m_AccumulatedFrameCount++;
+        }
+
+        m_Denoiser.Denoise(commandBuffer, m_AccumulationImages[m_HistoryIndex], m_NormalDepthImages[m_HistoryIndex]);
+    }
+
+    void RayQueryRenderer::RenderLighting(const VkCommandBuffer commandBuffer,
+                                          const VkDescriptorSet sceneDescriptorSet) {
+        const VkExtent2D drawExtent = m_Renderer->DrawExtent;
+
+        Renderer::VulkanUtils::TransitionImage(commandBuffer, m_DepthImage.Image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                               VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        // Matches the outputs of ray_shadow.frag.
+        const std::array<VkImage, 3> colorImages = {
+            m_LightingImage.Image, m_MotionImage.Image, m_NormalDepthImages[m_HistoryIndex].Image
+        };
+        for (const VkImage image : colorImages) {
+            Renderer::VulkanUtils::TransitionImage(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                   VK_IMAGE_LAYOUT_GENERAL);
+        }
+
+        // Nothing in the background: no occlusion, no light and a null depth that never matches any history.
+        constexpr VkClearValue clearValue{.color = {{0.f, 0.f, 0.f, 0.f}}};
+        const std::array<VkRenderingAttachmentInfo, 3> colorAttachments = {
+            Renderer::VulkanInit::AttachmentInfo(m_LightingImage.ImageView, &clearValue, VK_IMAGE_LAYOUT_GENERAL),
+            Renderer::VulkanInit::AttachmentInfo(m_MotionImage.ImageView, &clearValue, VK_IMAGE_LAYOUT_GENERAL),
+            Renderer::VulkanInit::AttachmentInfo(m_NormalDepthImages[m_HistoryIndex].ImageView, &clearValue,
+                                                 VK_IMAGE_LAYOUT_GENERAL)
+        };
+        const VkRenderingAttachmentInfo depthAttachment = Renderer::VulkanInit::DepthAttachmentInfo(
+            m_DepthImage.ImageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+        const VkRenderingInfo renderInfo = Renderer::VulkanInit::RenderingInfo(drawExtent, colorAttachments,
+                                                                               &depthAttachment);
+
+        vkCmdBeginRendering(commandBuffer, &renderInfo);
+
+        VkPipeline boundPipeline = m_Pipeline;
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1,
+                                &sceneDescriptorSet, 0, nullptr);
+
+        VkViewport viewport{};
+        viewport.x = 0;
+        viewport.y = 0;
+        viewport.width = static_cast<f32>(drawExtent.width);
+        viewport.height = static_cast<f32>(drawExtent.height);
+        viewport.minDepth = 0.f;
+        viewport.maxDepth = 1.f;
+
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset.x = 0;
+        scissor.offset.y = 0;
+        scissor.extent = drawExtent;
+
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        // One instanced draw per mesh, the vertex shaders fetch the transform of each instance.
+        for (const DrawBatch& batch : m_DrawBatches) {
+            const Mesh& mesh = m_Meshes[batch.MeshIndex];
+
+            // Both pipelines share the layout, the scene descriptor set stays bound.
+            const VkPipeline pipeline = mesh.Quantized ? m_QuantizedPipeline : m_Pipeline;
+            if (pipeline != boundPipeline) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = pipeline;
+            }
+
+            if (mesh.Quantized) {
+                // Positions and attributes come from separate streams.
+                const VkBuffer vertexBuffers[] = {
+                    mesh.Buffers.PositionBuffer.Buffer, mesh.Buffers.VertexBuffer.Buffer
+                };
+                constexpr VkDeviceSize vertexOffsets[] = {0, 0};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, vertexOffsets);
+            } else {
+                constexpr VkDeviceSize vertexOffset = 0;
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.Buffers.VertexBuffer.Buffer, &vertexOffset);
+            }
+            vkCmdBindIndexBuffer(commandBuffer, mesh.Buffers.IndexBuffer.Buffer, 0, VK_INDEX_TYPE_UINT32);
+
+            const DrawPushConstants pushConstants{
+                .DequantizationScale = mesh.DequantizationScale,
+                .DequantizationOffset = mesh.DequantizationOffset
+            };
+            vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                               sizeof(DrawPushConstants), &pushConstants);
+
+            vkCmdDrawIndexed(commandBuffer, mesh.IndexCount, batch.InstanceCount, 0, 0, batch.FirstInstance);
+        }
+
+        vkCmdEndRendering(commandBuffer);
+
+        // The accumulation pass reads them right away, the next frame reads the normals and depths again.
+        for (const VkImage image : colorImages) {
+            Renderer::VulkanUtils::TransitionImage(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL,
+                                                   VK_IMAGE_LAYOUT_GENERAL);
+        }
+    }
+
+    void RayQueryRenderer::AccumulateLighting(const VkCommandBuffer commandBuffer) {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+        const VkExtent2D drawExtent = m_Renderer->DrawExtent;
+
+        const Renderer::AllocatedImage& history = m_AccumulationImages[m_HistoryIndex ^ 1];
+        const Renderer::AllocatedImage& accumulation = m_AccumulationImages[m_HistoryIndex];
+
+        // Waits for the previous frame to write the history, the new accumulation is entirely overwritten.
+        Renderer::VulkanUtils::TransitionImage(commandBuffer, history.Image, VK_IMAGE_LAYOUT_GENERAL,
+                                               VK_IMAGE_LAYOUT_GENERAL);
+        Renderer::VulkanUtils::TransitionImage(commandBuffer, accumulation.Image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                               VK_IMAGE_LAYOUT_GENERAL);
+
+        const VkDescriptorSet descriptorSet = m_Renderer->GetFrameDescriptors().Allocate(
+            device, m_AccumulationDescriptorLayout);
+
+        // Matches accumulate.comp.
+        const std::array<VkImageView, 6> imageViews = {
+            m_LightingImage.ImageView, m_MotionImage.ImageView, m_NormalDepthImages[m_HistoryIndex].ImageView,
+            m_NormalDepthImages[m_HistoryIndex ^ 1].ImageView, history.ImageView, accumulation.ImageView
+        };
+
+        Renderer::DescriptorWriter writer;
+        for (u32 binding = 0; binding < imageViews.size(); binding++) {
+            writer.WriteImage(binding, imageViews[binding], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL,
+                              VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        }
+        writer.UpdateSet(device, descriptorSet);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_AccumulationPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_AccumulationPipelineLayout, 0, 1,
+                                &descriptorSet, 0, nullptr);
+
+        // Still views keep refining up to the convergence, moving ones only keep a short history.
+        const AccumulationPushConstants pushConstants{
+            .Extent = glm::uvec2(drawExtent.width, drawExtent.height),
+            .HistoryValid = m_HistoryValid ? 1u : 0u,
+            .MaxHistoryLength = m_AccumulatedFrameCount > 0 ? g_MaxAccumulatedFrames : g_MaxMovingHistoryLength
+        };
+        vkCmdPushConstants(commandBuffer, m_AccumulationPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(AccumulationPushConstants), &pushConstants);
+
+        // 8x8 work groups.
+        vkCmdDispatch(commandBuffer, (drawExtent.width + 7) / 8, (drawExtent.height + 7) / 8, 1);
+    }
+
+    u64 RayQueryRenderer::GetMeshHash(const u64 contentHash, const bool quantized) {
+        return HashValue(quantized, contentHash);
+    }
+
+    std::optional<u32> RayQueryRenderer::FindMesh(const u64 meshHash, const usize vertexCount,
+                                                  const usize indexCount) const {
+        if (const auto it = m_MeshesByContentHash.find(meshHash); it != m_MeshesByContentHash.end()) {
+            const Mesh& existingMesh = m_Meshes[it->second];
+            if (existingMesh.VertexCount == vertexCount && existingMesh.IndexCount == indexCount) {
+                return it->second;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    Renderer::BottomLevelGeometry RayQueryRenderer::MakeBottomLevelGeometry(const Mesh& mesh) {
+        Renderer::BottomLevelGeometry geometry{};
+        if (mesh.Quantized) {
+            // The BLAS is built straight from the snorm position stream, in normalized space.
+            geometry.VertexAddress = mesh.Buffers.PositionBufferAddress;
+            geometry.VertexStride = sizeof(Renderer::QuantizedPosition);
+            geometry.VertexFormat = VK_FORMAT_R16G16B16A16_SNORM;
+        } else {
+            geometry.VertexAddress = mesh.Buffers.VertexBufferAddress;
+            geometry.VertexStride = sizeof(Renderer::Vertex);
+            geometry.VertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+        }
+
+        geometry.VertexCount = mesh.VertexCount;
+        geometry.IndexAddress = mesh.Buffers.IndexBufferAddress;
+        geometry.IndexCount = mesh.IndexCount;
+        geometry.UploadTicket = mesh.Buffers.UploadTicket;
+
+        return geometry;
+    }
+
+    u32 RayQueryRenderer::RegisterMesh(const Mesh& mesh, const u64 meshHash, const u64 positionHash) {
+        Renderer::BottomLevelGeometry geometry = MakeBottomLevelGeometry(mesh);
+        // The BLAS only depends on the positions, their format and the indices.
+        geometry.ContentHash = HashValue(mesh.Quantized, positionHash);
+
+        // The draws of the next frame read the buffers, the graphics queue waits for the upload on the GPU.
+        m_Renderer->WaitForUpload(mesh.Buffers.UploadTicket);
+
+        Mesh registeredMesh = mesh;
+        registeredMesh.BottomLevelIndex = m_AccelerationStructures.AddBottomLevel(geometry);
+        registeredMesh.Hash = meshHash;
+
+        u32 meshIndex;
+        if (!m_FreeMeshes.empty()) {
+            meshIndex = m_FreeMeshes.back();
+            m_FreeMeshes.pop_back();
+            m_Meshes[meshIndex] = registeredMesh;
+        } else {
+            meshIndex = static_cast<u32>(m_Meshes.size());
+            m_Meshes.push_back(registeredMesh);
+        }
+
+        m_MeshesByContentHash.emplace(meshHash, meshIndex);
+
+        return meshIndex;
+    }
+
+    u32 RayQueryRenderer::RegisterOpacityTexture(const Renderer::AllocatedImage& texture) {
+        if (!m_FreeOpacityTextures.empty()) {
+            const u32 textureIndex = m_FreeOpacityTextures.back();
+            m_FreeOpacityTextures.pop_back();
+            m_OpacityTextures[textureIndex] = texture;
+
+            return textureIndex;
+        }
+
+        m_OpacityTextures.push_back(texture);
+
+        return static_cast<u32>(m_OpacityTextures.size() - 1);
+    }
+
+    void RayQueryRenderer::InitializeDescriptors() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        // Matches input_structures.glsl.
+        Renderer::DescriptorLayoutBuilder builder;
+        builder.AddBinding(0, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
+        builder.AddBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        builder.AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        builder.AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, g_MaxOpacityTextures);
+        builder.AddBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        builder.AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        m_SceneDescriptorLayout = builder.Build(device, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+
+        m_DeletionQueue.PushFunction([this, device]() {
+            vkDestroyDescriptorSetLayout(device, m_SceneDescriptorLayout, nullptr);
+        });
+    }
+
+    void RayQueryRenderer::InitializePipeline() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        VkShaderModule vertexShader;
+        if (!Renderer::VulkanUtils::CreateShaderModule(device, "Shaders/ray_shadow.vert.spv", &vertexShader)) {
+            Log::RtFatal({0x02, 0x00}, "Failed to load the ray shadow vertex shader.");
+        }
+
+        VkShaderModule quantizedVertexShader;
+        if (!Renderer::VulkanUtils::CreateShaderModule(device, "Shaders/ray_shadow_quantized.vert.spv",
+                                                       &quantizedVertexShader)) {
+            Log::RtFatal({0x02, 0x03}, "Failed to load the quantized ray shadow vertex shader.");
+        }
+
+        VkShaderModule fragmentShader;
+        if (!Renderer::VulkanUtils::CreateShaderModule(device, "Shaders/ray_shadow.frag.spv", &fragmentShader)) {
+            Log::RtFatal({0x02, 0x01}, "Failed to load the ray shadow fragment shader.");
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawPushConstants);
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = Renderer::VulkanInit::PipelineLayoutCreateInfo();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_SceneDescriptorLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout))
+
+        // Positions and normals are read straight from the interleaved vertex buffer.
+        constexpr VkVertexInputBindingDescription vertexBinding{
+            .binding = 0,
+            .stride = sizeof(Renderer::Vertex),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        };
+
+        constexpr VkVertexInputAttributeDescription vertexAttributes[] = {
+            {
+                .location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT,
+                .offset = offsetof(Renderer::Vertex, Position)
+            },
+            {
+                .location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT,
+                .offset = offsetof(Renderer::Vertex, Normal)
+            }
+        };
+
+        // Quantized meshes have a position stream and an attribute stream, decoded by the vertex shader.
+        constexpr VkVertexInputBindingDescription quantizedVertexBindings[] = {
+            {.binding = 0, .stride = sizeof(Renderer::QuantizedPosition), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX},
+            {.binding = 1, .stride = sizeof(Renderer::QuantizedAttributes), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX}
+        };
+
+        constexpr VkVertexInputAttributeDescription quantizedVertexAttributes[] = {
+            {.location = 0, .binding = 0, .format = VK_FORMAT_R16G16B16A16_SNORM, .offset = 0},
+            {
+                .location = 1, .binding = 1, .format = VK_FORMAT_R16G16_SNORM,
+                .offset = offsetof(Renderer::QuantizedAttributes, NormalX)
+            }
+        };
+
+        Renderer::VulkanUtils::PipelineBuilder pipelineBuilder;
+        pipelineBuilder.SetPipelineLayout(m_PipelineLayout);
+        pipelineBuilder.SetShaders(vertexShader, fragmentShader);
+        pipelineBuilder.SetVertexInput({&vertexBinding, 1}, vertexAttributes);
+        pipelineBuilder.SetInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        pipelineBuilder.SetPolygonMode(VK_POLYGON_MODE_FILL);
+        pipelineBuilder.SetCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+        pipelineBuilder.SetMultisamplingNone();
+        pipelineBuilder.DisableBlending();
+        pipelineBuilder.EnableDepthTest(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+        constexpr std::array<VkFormat, 3> colorFormats = {
+            g_LightingImageFormat, g_MotionImageFormat, g_NormalDepthImageFormat
+        };
+        pipelineBuilder.SetColorAttachmentFormats(colorFormats);
+        pipelineBuilder.SetDepthFormat(VK_FORMAT_D32_SFLOAT);
+
+        m_Pipeline = pipelineBuilder.BuildPipeline(device);
+
+        pipelineBuilder.SetShaders(quantizedVertexShader, fragmentShader);
+        pipelineBuilder.SetVertexInput(quantizedVertexBindings, quantizedVertexAttributes);
+
+        m_QuantizedPipeline = pipelineBuilder.BuildPipeline(device);
+
+        vkDestroyShaderModule(device, fragmentShader, nullptr);
+        vkDestroyShaderModule(device, quantizedVertexShader, nullptr);
+        vkDestroyShaderModule(device, vertexShader, nullptr);
+
+        m_DeletionQueue.PushFunction([this, device]() {
+            vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr);
+            vkDestroyPipeline(device, m_QuantizedPipeline, nullptr);
+            vkDestroyPipeline(device, m_Pipeline, nullptr);
+        });
+    }
+
+    void RayQueryRenderer::InitializeDepthImage() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        m_DepthImage = Renderer::VulkanUtils::CreateImage(m_Renderer->GetAllocator(), device,
+                                                          m_Renderer->DrawImage.ImageExtent, VK_FORMAT_D32_SFLOAT,
+                                                          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+        m_DeletionQueue.PushFunction([this, device]() {
+            Renderer::VulkanUtils::DestroyImage(m_Renderer->GetAllocator(), device, m_DepthImage);
+        });
+    }
+
+    void RayQueryRenderer::InitializeAccumulation() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        const VkExtent3D extent = m_Renderer->DrawImage.ImageExtent;
+        constexpr VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+
+        m_LightingImage = Renderer::VulkanUtils::CreateImage(allocator, device, extent, g_LightingImageFormat,
+                                                             attachmentUsage);
+        m_MotionImage = Renderer::VulkanUtils::CreateImage(allocator, device, extent, g_MotionImageFormat,
+                                                           attachmentUsage);
+        for (u32 i = 0; i < 2; i++) {
+            m_NormalDepthImages[i] = Renderer::VulkanUtils::CreateImage(allocator, device, extent,
+                                                                        g_NormalDepthImageFormat, attachmentUsage);
+            m_AccumulationImages[i] = Renderer::VulkanUtils::CreateImage(allocator, device, extent,
+                                                                         g_AccumulationImageFormat,
+                                                                         VK_IMAGE_USAGE_STORAGE_BIT);
+        }
+
+        // The history images are bound before the first frame writes them.
+        m_Renderer->ImmediateSubmit([this](const VkCommandBuffer commandBuffer) {
+            for (u32 i = 0; i < 2; i++) {
+                Renderer::VulkanUtils::TransitionImage(commandBuffer, m_NormalDepthImages[i].Image,
+                                                       VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+                Renderer::VulkanUtils::TransitionImage(commandBuffer, m_AccumulationImages[i].Image,
+                                                       VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+            }
+        });
+
+        Renderer::DescriptorLayoutBuilder builder;
+        for (u32 binding = 0; binding < 6; binding++) {
+            builder.AddBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        }
+        m_AccumulationDescriptorLayout = builder.Build(device, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VkShaderModule computeShader;
+        if (!Renderer::VulkanUtils::CreateShaderModule(device, "Shaders/accumulate.comp.spv", &computeShader)) {
+            Log::RtFatal({0x02, 0x04}, "Failed to load the accumulation compute shader.");
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(AccumulationPushConstants);
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = Renderer::VulkanInit::PipelineLayoutCreateInfo();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_AccumulationDescriptorLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_AccumulationPipelineLayout))
+
+        VkComputePipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipelineInfo.stage = Renderer::VulkanInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                                 computeShader);
+        pipelineInfo.layout = m_AccumulationPipelineLayout;
+
+        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_AccumulationPipeline))
+
+        vkDestroyShaderModule(device, computeShader, nullptr);
+
+        m_DeletionQueue.PushFunction([this, device, allocator]() {
+            vkDestroyPipeline(device, m_AccumulationPipeline, nullptr);
+            vkDestroyPipelineLayout(device, m_AccumulationPipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(device, m_AccumulationDescriptorLayout, nullptr);
+            for (u32 i = 0; i < 2; i++) {
+                Renderer::VulkanUtils::DestroyImage(allocator, device, m_AccumulationImages[i]);
+                Renderer::VulkanUtils::DestroyImage(allocator, device, m_NormalDepthImages[i]);
+            }
+            Renderer::VulkanUtils::DestroyImage(allocator, device, m_MotionImage);
+            Renderer::VulkanUtils::DestroyImage(allocator, device, m_LightingImage);
+        });
+    }
+
+    void RayQueryRenderer::InitializeOpacityTextures() {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+
+        VkSamplerCreateInfo samplerInfo{.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+        VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_OpacitySampler))
+
+        constexpr u32 opaqueTexel = 0xFFFFFFFF;
+        m_DefaultOpacityTexture = Renderer::VulkanUtils::CreateImage(m_Renderer->GetAllocator(), device, m_Renderer,
+                                                                     &opaqueTexel, VkExtent3D{1, 1, 1},
+                                                                     VK_FORMAT_R8G8B8A8_UNORM,
+                                                                     VK_IMAGE_USAGE_SAMPLED_BIT);
+
+        m_DeletionQueue.PushFunction([this, device]() {
+            Renderer::VulkanUtils::DestroyImage(m_Renderer->GetAllocator(), device, m_DefaultOpacityTexture);
+            vkDestroySampler(device, m_OpacitySampler, nullptr);
+        });
+    }
+
+    void RayQueryRenderer::GatherAccelerationStructureInstances() {
+        m_AccelerationStructureInstances.clear();
+        m_AccelerationStructureInstances.reserve(m_Instances.size());
+        m_AlphaTestedInstanceCount = 0;
+
+        for (u32 i = 0; i < m_Instances.size(); i++) {
+            const MeshInstance& instance = m_Instances[i];
+            const Mesh& mesh = m_Meshes[instance.MeshIndex];
+            const u32 bottomLevelIndex = mesh.BottomLevelIndex;
+
+            // Instances of meshes still building on the compute queue are left out of the TLAS for now.
+            if (!m_AccelerationStructures.IsBottomLevelReady(bottomLevelIndex)) {
+                continue;
+            }
+
+            const bool opaque = instance.Material.OpacityTexture == g_NoOpacityTexture;
+            if (!opaque) {
+                m_AlphaTestedInstanceCount++;
+            }
+
+            // The BLAS of a quantized mesh is in normalized space, the instance transform dequantizes it.
+            m_AccelerationStructureInstances.push_back(Renderer::AccelerationStructureInstance{
+                .BottomLevelIndex = bottomLevelIndex,
+                .Transform = mesh.Quantized ? instance.Transform * mesh.Dequantization : instance.Transform,
+                .CustomIndex = i,
+                .Mask = instance.Layers,
+                .Opaque = opaque
+            });
+        }
+    }
+
+    void RayQueryRenderer::BuildDrawBatches() {
+        m_DrawBatches.clear();
+        m_DrawInstanceIndices.resize(m_Instances.size());
+
+        // Counting sort of the visible instances by mesh, so that each mesh is drawn once.
+        std::vector<u32> meshInstanceCounts(m_Meshes.size(), 0);
+        for (const MeshInstance& instance : m_Instances) {
+            // Instances outside of the camera layer only show up in shadows and AO.
+            if (instance.Layers & InstanceLayer::VisibleToCamera) {
+                meshInstanceCounts[instance.MeshIndex]++;
+            }
+        }
+
+        std::vector<u32> meshFirstInstances(m_Meshes.size(), 0);
+        u32 visibleInstanceCount = 0;
+        for (u32 meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++) {
+            if (meshInstanceCounts[meshIndex] == 0) {
+                continue;
+            }
+
+            meshFirstInstances[meshIndex] = visibleInstanceCount;
+            m_DrawBatches.push_back({meshIndex, visibleInstanceCount, meshInstanceCounts[meshIndex]});
+
+            visibleInstanceCount += meshInstanceCounts[meshIndex];
+        }
+
+        for (u32 i = 0; i < m_Instances.size(); i++) {
+            const MeshInstance& instance = m_Instances[i];
+            if (instance.Layers & InstanceLayer::VisibleToCamera) {
+                m_DrawInstanceIndices[meshFirstInstances[instance.MeshIndex]++] = i;
+            }
+        }
+
+        m_DrawInstanceIndices.resize(visibleInstanceCount);
+    }
+
+    GlobalUniform RayQueryRenderer::MakeGlobalUniform() {
+        // The camera matrix is its world transform, the view matrix is its inverse.
+        glm::mat4 projection = m_Camera.GetProjectionMatrix(m_Renderer->DrawExtent);
+        projection[1][1] *= -1;
+
+        GlobalUniform globalUniform{};
+        globalUniform.View = glm::inverse(m_Camera.GetViewMatrix());
+        globalUniform.Projection = projection;
+        globalUniform.CameraPosition = glm::vec4(m_Camera.Position, 1.f);
+        globalUniform.LightPosition = glm::vec4(m_LightPosition, m_LightRadius);
+        globalUniform.RayMasks = glm::uvec4(InstanceLayer::CastsShadow, InstanceLayer::OccludesAmbientOcclusion,
+                                            InstanceLayer::VisibleToCamera, 0);
+        globalUniform.AlphaTestedInstanceCount = m_AlphaTestedInstanceCount;
+        globalUniform.DrawExtent = glm::uvec2(m_Renderer->DrawExtent.width, m_Renderer->DrawExtent.height);
+
+        const AmbientOcclusionSettings& ambientOcclusion = m_AmbientOcclusionSettings;
+        const u32 sampleCount = std::max(ambientOcclusion.SampleCount, 1u);
+        globalUniform.AmbientOcclusionSampleCount = sampleCount;
+        globalUniform.AmbientOcclusionRayDistance = ambientOcclusion.RayDistance;
+        globalUniform.AmbientOcclusionVarianceThreshold = ambientOcclusion.VarianceThreshold;
+        if (ambientOcclusion.AdaptiveSampling) {
+            globalUniform.AmbientOcclusionMinSampleCount = std::clamp(ambientOcclusion.MinSampleCount, 1u, sampleCount);
+            globalUniform.AmbientOcclusionMaxSampleCount = std::max(ambientOcclusion.MaxSampleCount, sampleCount);
+        } else {
+            globalUniform.AmbientOcclusionMinSampleCount = sampleCount;
+            globalUniform.AmbientOcclusionMaxSampleCount = sampleCount;
+        }
+
+        return globalUniform;
+    }
+
+    VkDescriptorSet RayQueryRenderer::WriteSceneDescriptorSet(const GlobalUniform& globalUniform) {
+        const VkDevice device = m_Renderer->GetDevice().GetDevice();
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        // The uniform buffer only lives for the frame, like the descriptor set pointing to it.
+        const Renderer::AllocatedBuffer globalUniformBuffer = Renderer::VulkanUtils::CreateBuffer(
+            allocator, sizeof(GlobalUniform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+        m_Renderer->PlanFrameDeletion([allocator, globalUniformBuffer]() {
+            Renderer::VulkanUtils::DestroyBuffer(allocator, globalUniformBuffer);
+        });
+
+        memcpy(globalUniformBuffer.Info.pMappedData, &globalUniform, sizeof(GlobalUniform));
+
+        // Indexed by the instance custom index, so it covers every instance even those not in the TLAS yet.
+        const usize instanceDataSize = std::max<usize>(m_Instances.size(), 1) * sizeof(InstanceData);
+        const Renderer::AllocatedBuffer instanceDataBuffer = Renderer::VulkanUtils::CreateBuffer(
+            allocator, instanceDataSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+        m_Renderer->PlanFrameDeletion([allocator, instanceDataBuffer]() {
+            Renderer::VulkanUtils::DestroyBuffer(allocator, instanceDataBuffer);
+        });
+
+        auto* instanceData = static_cast<InstanceData*>(instanceDataBuffer.Info.pMappedData);
+        for (usize i = 0; i < m_Instances.size(); i++) {
+            const MeshInstance& instance = m_Instances[i];
+            const Mesh& mesh = m_Meshes[instance.MeshIndex];
+
+            instanceData[i] = InstanceData{
+                .Transform = instance.Transform,
+                .VertexBufferAddress = mesh.Buffers.VertexBufferAddress,
+                .IndexBufferAddress = mesh.Buffers.IndexBufferAddress,
+                .OpacityTexture = instance.Material.OpacityTexture,
+                .AlphaCutoff = instance.Material.AlphaCutoff,
+                .Quantized = mesh.Quantized ? 1u : 0u
+            };
+        }
+
+        // Visible instance indices grouped by mesh, indexed by gl_InstanceIndex.
+        const usize drawInstanceSize = std::max<usize>(m_DrawInstanceIndices.size(), 1) * sizeof(u32);
+        const Renderer::AllocatedBuffer drawInstanceBuffer = Renderer::VulkanUtils::CreateBuffer(
+            allocator, drawInstanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+        m_Renderer->PlanFrameDeletion([allocator, drawInstanceBuffer]() {
+            Renderer::VulkanUtils::DestroyBuffer(allocator, drawInstanceBuffer);
+        });
+
+        memcpy(drawInstanceBuffer.Info.pMappedData, m_DrawInstanceIndices.data(),
+               m_DrawInstanceIndices.size() * sizeof(u32));
+
+        const VkDescriptorSet sceneDescriptorSet = m_Renderer->GetFrameDescriptors().Allocate(
+            device, m_SceneDescriptorLayout);
+
+        Renderer::DescriptorWriter writer;
+        writer.WriteAccelerationStructure(0, m_AccelerationStructures.GetTopLevel());
+        writer.WriteBuffer(1, globalUniformBuffer.Buffer, sizeof(GlobalUniform), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        writer.WriteBuffer(2, instanceDataBuffer.Buffer, instanceDataSize, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        writer.WriteBuffer(4, drawInstanceBuffer.Buffer, drawInstanceSize, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        // Accumulated by the previous frame, the current one is written after the raster pass.
+        writer.WriteImage(5, m_AccumulationImages[m_HistoryIndex ^ 1].ImageView, VK_NULL_HANDLE,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        for (u32 i = 0; i < g_MaxOpacityTextures; i++) {
+            const Renderer::AllocatedImage& texture =
+                i < m_OpacityTextures.size() && m_OpacityTextures[i].Image != VK_NULL_HANDLE
+                    ? m_OpacityTextures[i]
+                    : m_DefaultOpacityTexture;
+            writer.WriteImage(3, texture.ImageView, m_OpacitySampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, i);
+        }
+        writer.UpdateSet(device, sceneDescriptorSet);
+
+        return sceneDescriptorSet;
+    }
 }
@@ -0,0 +1,260 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/RaytracerApp/SceneStreamer.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+
+#include <Raytracer/Scene/SceneImporter.hpp>
+
+namespace Raytracer {
+    namespace {
+        constexpr usize g_PageSize = 4096;
+
+        // The mapping is only read from disk when touched. Reading one byte per page on the loader thread makes it
+        // resident before the main thread copies from it.
+        void FaultIn(const std::span<const std::byte> data) {
+            volatile std::byte sink{};
+            for (usize offset = 0; offset < data.size(); offset += g_PageSize) {
+                sink = data[offset];
+            }
+            (void)sink;
+        }
+    }
+
+    SceneStreamer::SceneStreamer(RayQueryRenderer& rayQueryRenderer) : m_RayQueryRenderer(rayQueryRenderer) {
+        m_LoaderThread = std::jthread([this](const std::stop_token& stopToken) {
+            RunLoader(stopToken);
+        });
+    }
+
+    void SceneStreamer::RequestScene(const std::filesystem::path& path) {
+        DecodedScene request;
+        request.Path = path;
+        request.Name = path.string();
+
+        Request(std::move(request));
+    }
+
+    void SceneStreamer::RequestGeneratedScene(const Scene::ProceduralSceneSettings& settings) {
+        DecodedScene request;
+        request.Procedural = settings;
+        request.Name = Scene::DescribeProceduralScene(settings);
+
+        Request(std::move(request));
+    }
+
+    void SceneStreamer::Update() {
+        std::optional<DecodedScene> decoded;
+        {
+            std::scoped_lock lock(m_Mutex);
+            decoded.swap(m_Decoded);
+        }
+
+        // Scenes decoded for an older request were superseded in the meantime.
+        if (decoded && decoded->Generation == m_Generation) {
+            if (!decoded->Description && !decoded->Cooked) {
+                Log::RtError("Failed to load scene {0}.", decoded->Name);
+                m_Loading = false;
+            } else {
+                m_RayQueryRenderer.ClearInstances();
+
+                m_Streaming = std::move(decoded);
+                m_NextMesh = 0;
+            }
+        }
+
+        if (!m_Streaming) {
+            return;
+        }
+
+        // Uploads are queued into the staging ring and flushed with the frame submission, the budget keeps the copies
+        // of a frame within the ring.
+        const usize meshCount = GetMeshCount();
+        usize uploadedSize = 0;
+        while (m_NextMesh < meshCount && uploadedSize < g_StreamingUploadBudget) {
+            uploadedSize += StreamMesh(m_NextMesh);
+            m_NextMesh++;
+        }
+
+        if (m_NextMesh == meshCount) {
+            const std::chrono::duration<f64, std::milli> loadTime =
+                std::chrono::high_resolution_clock::now() - m_Streaming->RequestTime;
+            Log::RtInfo("Streamed {0} meshes and {1} instances from {2} in {3:.1f} ms.", meshCount,
+                        m_Streaming->MeshInstances.size(), m_Streaming->Name, loadTime.count());
+
+            m_HasScene = !m_Streaming->MeshInstances.empty();
+            if (!m_HasScene) {
+                Log::RtWarn("Scene {0} has no instance to render.", m_Streaming->Name);
+            }
+
+            // What the previous scene doesn't share with this one is no longer instanced.
+            m_RayQueryRenderer.ReleaseUnusedMeshes();
+
+            m_Streaming.reset();
+            m_Loading = false;
+        }
+    }
+
+    void SceneStreamer::Request(DecodedScene&& request) {
+        m_Generation++;
+        m_Loading = true;
+        m_HasScene = false;
+
+        // What was streamed of the previous request stays on screen until the new scene replaces it.
+        m_Streaming.reset();
+
+        request.Generation = m_Generation;
+        request.RequestTime = std::chrono::high_resolution_clock::now();
+
+        Log::RtInfo("Loading scene {0} in the background.", request.Name);
+
+        {
+            std::scoped_lock lock(m_Mutex);
+            m_Request = std::move(request);
+        }
+
+        m_RequestCondition.notify_one();
+    }
+
+    void SceneStreamer::RunLoader(const std::stop_token& stopToken) {
+        while (!stopToken.stop_requested()) {
+            DecodedScene scene;
+            {
+                std::unique_lock lock(m_Mutex);
+                if (!m_RequestCondition.wait(lock, stopToken, [this]() { return m_Request.has_value(); })) {
+                    return;
+                }
+
+                scene = std::move(*m_Request);
+                m_Request.reset();
+            }
+
+            // A failed decode is still handed over, without geometry, so that the main thread stops waiting for it.
+            if (!Decode(scene)) {
+                scene.Description.reset();
+                scene.Cooked.reset();
+            }
+
+            std::scoped_lock lock(m_Mutex);
+            m_Decoded = std::move(scene);
+        }
+    }
+
+    bool SceneStreamer::Decode(DecodedScene& scene) {
+        std::vector<u32> instanceMeshes;
+        usize meshCount;
+
+        if (scene.Path.extension() == ".rtscene") {
+            scene.Cooked = std::make_unique<Scene::CookedScene>(scene.Path);
+            if (!scene.Cooked->IsValid()) {
+                return false;
+            }
+
+            FaultIn(scene.Cooked->GetGeometry());
+
+            meshCount = scene.Cooked->GetMeshes().size();
+            instanceMeshes.reserve(scene.Cooked->GetInstances().size());
+            for (const auto& instance : scene.Cooked->GetInstances()) {
+                instanceMeshes.push_back(instance.MeshIndex);
+            }
+        } else {
+            scene.Description = std::make_unique<Scene::SceneDescription>();
+            if (scene.Procedural) {
+                Scene::GenerateProceduralScene(*scene.Procedural, *scene.Description);
+            } else if (!Scene::ImportScene(scene.Path, *scene.Description)) {
+                return false;
+            }
+
+            meshCount = scene.Description->Meshes.size();
+            scene.OpacityTextures.resize(scene.Description->Textures.size());
+            instanceMeshes.reserve(scene.Description->Placements.size());
+            for (const auto& placement : scene.Description->Placements) {
+                instanceMeshes.push_back(placement.MeshIndex);
+            }
+        }
+
+        // Counting sort of the instances by mesh.
+        scene.MeshInstanceOffsets.assign(meshCount + 1, 0);
+        for (const u32 meshIndex : instanceMeshes) {
+            scene.MeshInstanceOffsets[meshIndex + 1]++;
+        }
+        for (usize i = 0; i < meshCount; i++) {
+            scene.MeshInstanceOffsets[i + 1] += scene.MeshInstanceOffsets[i];
+        }
+
+        std::vector<u32> nextInstances(scene.MeshInstanceOffsets.begin(), scene.MeshInstanceOffsets.end() - 1);
+        scene.MeshInstances.resize(instanceMeshes.size());
+        for (u32 i = 0; i < instanceMeshes.size(); i++) {
+            scene.MeshInstances[nextInstances[instanceMeshes[i]]++] = i;
+        }
+
+        return true;
+    }
+
+    usize SceneStreamer::GetMeshCount() const {
+        if (m_Streaming->Description) {
+            return m_Streaming->Description->Meshes.size();
+        }
+
+        return m_Streaming->Cooked->GetMeshes().size();
+    }
+
+    usize SceneStreamer::StreamMesh(const usize meshIndex) {
+        const DecodedScene& scene = *m_Streaming;
+        const u32 firstInstance = scene.MeshInstanceOffsets[meshIndex];
+        const u32 lastInstance = scene.MeshInstanceOffsets[meshIndex + 1];
+
+        if (scene.Description) {
+            const Scene::MeshData& meshData = scene.Description->Meshes[meshIndex];
+            const u32 rendererMeshIndex = m_RayQueryRenderer.AddMesh(meshData.Vertices, meshData.Indices);
+            usize streamedSize = meshData.Vertices.size() * sizeof(Renderer::Vertex) +
+                                 meshData.Indices.size() * sizeof(u32);
+
+            MeshMaterial material{g_NoOpacityTexture, meshData.Material.AlphaCutoff};
+            if (meshData.Material.OpacityTexture != Scene::g_NoTexture) {
+                material.OpacityTexture = StreamOpacityTexture(meshData.Material.OpacityTexture, streamedSize);
+            }
+
+            for (u32 i = firstInstance; i < lastInstance; i++) {
+                m_RayQueryRenderer.AddInstance(rendererMeshIndex,
+                                               scene.Description->Placements[scene.MeshInstances[i]].Transform,
+                                               material);
+            }
+
+            return streamedSize;
+        }
+
+        const u32 rendererMeshIndex = m_RayQueryRenderer.AddCookedMesh(*scene.Cooked, meshIndex);
+        const Scene::CookedMaterial& cookedMaterial = scene.Cooked->GetMaterials()[meshIndex];
+        const MeshMaterial material{cookedMaterial.OpacityTexture, cookedMaterial.AlphaCutoff};
+
+        for (u32 i = firstInstance; i < lastInstance; i++) {
+            const Scene::CookedInstance& instance = scene.Cooked->GetInstances()[scene.MeshInstances[i]];
+            m_RayQueryRenderer.AddInstance(rendererMeshIndex, instance.Transform, material,
+                                           static_cast<u8>(instance.Layers & InstanceLayer::All));
+        }
+
+        const Scene::CookedMesh& cookedMesh = scene.Cooked->GetMeshes()[meshIndex];
+        return cookedMesh.VertexCount * sizeof(Renderer::Vertex) + cookedMesh.IndexCount * sizeof(u32);
+    }
+
+    u32 SceneStreamer::StreamOpacityTexture(const u32 textureIndex, usize& inOutStreamedSize) {
+        std::optional<u32>& rendererTexture = m_Streaming->OpacityTextures[textureIndex];
+        if (!rendererTexture) {
+            // Decoded images only have their base level, KTX2 textures come block-compressed with their mips.
+            const Scene::TextureData& texture = m_Streaming->Description->Textures[textureIndex];
+            if (texture.Format == VK_FORMAT_R8G8B8A8_UNORM) {
+                rendererTexture = m_RayQueryRenderer.AddOpacityTexture(texture.Data.data(),
+                                                                       VkExtent2D{texture.Width, texture.Height});
+            } else {
+                rendererTexture = m_RayQueryRenderer.AddOpacityTexture(texture);
+            }
+
+            inOutStreamedSize += texture.Data.size();
+        }
+
+        return *rendererTexture;
+    }
+}
@@ -0,0 +1,1003 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/AccelerationStructureManager.hpp>
+
+#include <Raytracer/Renderer/UploadService.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace Raytracer::Renderer {
+    namespace {
+        VkTransformMatrixKHR ToTransformMatrix(const glm::mat4& matrix) {
+            // VkTransformMatrixKHR is a row-major 3x4 matrix, glm matrices are column-major.
+            VkTransformMatrixKHR transform;
+            for (i32 row = 0; row < 3; row++) {
+                for (i32 column = 0; column < 4; column++) {
+                    transform.matrix[row][column] = matrix[column][row];
+                }
+            }
+
+            return transform;
+        }
+
+        VkAccelerationStructureGeometryKHR MakeTriangleGeometry(const BottomLevelGeometry& input) {
+            VkAccelerationStructureGeometryKHR geometry{.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR};
+            geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+            geometry.flags = 0;
+
+            VkAccelerationStructureGeometryTrianglesDataKHR& triangles = geometry.geometry.triangles;
+            triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+            triangles.vertexFormat = input.VertexFormat;
+            triangles.vertexData.deviceAddress = input.VertexAddress;
+            triangles.vertexStride = input.VertexStride;
+            triangles.maxVertex = input.VertexCount - 1;
+            triangles.indexType = VK_INDEX_TYPE_UINT32;
+            triangles.indexData.deviceAddress = input.IndexAddress;
+
+            return geometry;
+        }
+
+        void DestroyAccelerationStructure(const VulkanWrapper::Device& device, const VmaAllocator allocator,
+                                          const AllocatedAccelerationStructure& accelerationStructure) {
+            device.GetDispatchTable().destroyAccelerationStructureKHR(accelerationStructure.Handle, nullptr);
+            VulkanUtils::DestroyBuffer(allocator, accelerationStructure.Buffer);
+        }
+
+        void AccelerationStructureBuildBarrier(const VkCommandBuffer commandBuffer) {
+            // Makes previous acceleration structure builds visible to the builds recorded after this barrier, and
+            // waits for the shaders of previous frames still tracing against a TLAS that is about to be rewritten.
+            VkMemoryBarrier2 memoryBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+            memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
+                                         VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            memoryBarrier.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+            memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+            memoryBarrier.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR |
+                                          VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+            VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            dependencyInfo.memoryBarrierCount = 1;
+            dependencyInfo.pMemoryBarriers = &memoryBarrier;
+
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        }
+
+        void AccelerationStructureReadBarrier(const VkCommandBuffer commandBuffer) {
+            // Makes the TLAS build visible to the ray queries of the shading work recorded after it.
+            VkMemoryBarrier2 memoryBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+            memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+            memoryBarrier.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+            memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+
+            VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            dependencyInfo.memoryBarrierCount = 1;
+            dependencyInfo.pMemoryBarriers = &memoryBarrier;
+
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        }
+    }
+
+    AccelerationStructureManager::AccelerationStructureManager(VulkanRenderer* renderer) : m_Renderer(renderer),
+        m_ScratchArena(renderer, g_ScratchBlockSize, g_MaxScratchBlocks) {
+    }
+
+    AccelerationStructureManager::~AccelerationStructureManager() {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        // Serializations in flight are finished so that the next launch finds them in the cache.
+        while (!m_InFlightSerializations.empty()) {
+            m_Renderer->GetComputeQueue().Wait(m_InFlightSerializations.back().Ticket);
+            PollSerializations();
+        }
+
+        // Waits for the builds still running on the compute queue.
+        m_Renderer->GetComputeQueue().Wait(m_Renderer->GetComputeQueue().GetLastSubmittedTicket());
+
+        for (const auto& batch : m_InFlightBatches) {
+            if (batch.CompactedSizeQueryPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device.GetDevice(), batch.CompactedSizeQueryPool, nullptr);
+            }
+
+            for (const auto& uncompactedBottomLevel : batch.UncompactedBottomLevels) {
+                DestroyAccelerationStructure(device, allocator, uncompactedBottomLevel);
+            }
+
+            for (const auto& stagingBuffer : batch.StagingBuffers) {
+                VulkanUtils::DestroyBuffer(allocator, stagingBuffer);
+            }
+        }
+
+        for (const auto& bottomLevel : m_BottomLevels) {
+            if (bottomLevel.Handle != VK_NULL_HANDLE) {
+                DestroyAccelerationStructure(device, allocator, bottomLevel);
+            }
+        }
+
+        if (m_TopLevel.Handle != VK_NULL_HANDLE) {
+            DestroyAccelerationStructure(device, allocator, m_TopLevel);
+        }
+
+        for (const auto& instanceBuffer : m_InstanceBuffers) {
+            if (instanceBuffer.Buffer != VK_NULL_HANDLE) {
+                VulkanUtils::DestroyBuffer(allocator, instanceBuffer);
+            }
+        }
+
+        if (m_TopLevelScratchBuffer.Buffer != VK_NULL_HANDLE) {
+            VulkanUtils::DestroyBuffer(allocator, m_TopLevelScratchBuffer);
+        }
+    }
+
+    u32 AccelerationStructureManager::AddBottomLevel(const BottomLevelGeometry& geometry) {
+        // Geometry already added, possibly from another file, shares the existing BLAS.
+        if (geometry.ContentHash != 0) {
+            if (const auto it = m_BottomLevelsByContentHash.find(geometry.ContentHash);
+                it != m_BottomLevelsByContentHash.end()) {
+                m_BottomLevelReferenceCounts[it->second]++;
+                return it->second;
+            }
+        }
+
+        // The slot is filled with the real acceleration structure when the batch is built, released slots first.
+        u32 index;
+        if (!m_FreeBottomLevels.empty()) {
+            index = m_FreeBottomLevels.back();
+            m_FreeBottomLevels.pop_back();
+        } else {
+            index = static_cast<u32>(m_BottomLevels.size());
+            m_BottomLevels.push_back({});
+            m_BottomLevelsReady.push_back(false);
+            m_BottomLevelReferenceCounts.push_back(0);
+            m_BottomLevelContentHashes.push_back(0);
+        }
+
+        m_BottomLevelReferenceCounts[index] = 1;
+        m_BottomLevelContentHashes[index] = geometry.ContentHash;
+        m_PendingBuilds.push_back({index, geometry});
+
+        if (geometry.ContentHash != 0) {
+            m_BottomLevelsByContentHash.emplace(geometry.ContentHash, index);
+        }
+
+        return index;
+    }
+
+    void AccelerationStructureManager::RemoveBottomLevel(const u32 index) {
+        if (--m_BottomLevelReferenceCounts[index] > 0) {
+            return;
+        }
+
+        // Geometry with the same content added afterward gets a new BLAS.
+        if (m_BottomLevelContentHashes[index] != 0) {
+            m_BottomLevelsByContentHash.erase(m_BottomLevelContentHashes[index]);
+        }
+
+        // Never submitted, there is nothing to destroy yet.
+        const usize droppedBuildCount = std::erase_if(m_PendingBuilds, [index](const PendingBuild& build) {
+            return build.BottomLevelIndex == index;
+        });
+        if (droppedBuildCount > 0) {
+            m_BottomLevelContentHashes[index] = 0;
+            m_FreeBottomLevels.push_back(index);
+            return;
+        }
+
+        if (IsBottomLevelInFlight(index)) {
+            m_PendingRemovals.push_back(index);
+            return;
+        }
+
+        ReleaseBottomLevel(index);
+    }
+
+    void AccelerationStructureManager::RetargetPendingBuild(const u32 index, const BottomLevelGeometry& geometry) {
+        for (PendingBuild& build : m_PendingBuilds) {
+            if (build.BottomLevelIndex == index) {
+                // The cache key stays the one of the shared BLAS.
+                const u64 contentHash = build.Geometry.ContentHash;
+                build.Geometry = geometry;
+                build.Geometry.ContentHash = contentHash;
+            }
+        }
+    }
+
+    void AccelerationStructureManager::EnableBottomLevelCache(const std::filesystem::path& directory) {
+        m_BottomLevelCache = std::make_unique<BottomLevelCache>(m_Renderer->GetDevice(), directory);
+
+        Log::RtTrace("BLAS cache enabled in {0}.", directory.string());
+    }
+
+    void AccelerationStructureManager::BuildBottomLevels() {
+        if (m_PendingBuilds.empty()) {
+            return;
+        }
+
+        // Cached BLAS are copied back instead of being built, only the remaining ones go through the build below.
+        if (m_BottomLevelCache) {
+            DeserializeBottomLevels();
+
+            if (m_PendingBuilds.empty()) {
+                return;
+            }
+        }
+
+        // Every build of a batch runs concurrently, each one gets its own slice of the scratch arena. The arena can
+        // only be reset once the last batch using it is done on the compute queue, until then the builds stay queued.
+        if (IsScratchArenaInUse()) {
+            return;
+        }
+        m_ScratchArena.Reset();
+
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+        const usize pendingCount = m_PendingBuilds.size();
+
+        // These vectors are referenced by pointer from the build infos, they must not be resized after this point.
+        std::vector<VkAccelerationStructureGeometryKHR> geometries(pendingCount);
+        std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(pendingCount);
+        std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges(pendingCount);
+        std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> buildRangePointers(pendingCount);
+
+        VkDeviceSize totalScratchSize = 0;
+        VkDeviceSize totalAccelerationStructureSize = 0;
+
+        usize buildCount = 0;
+        for (usize i = 0; i < pendingCount; i++) {
+            const PendingBuild& build = m_PendingBuilds[i];
+
+            geometries[i] = MakeTriangleGeometry(build.Geometry);
+
+            VkAccelerationStructureBuildGeometryInfoKHR& buildInfo = buildInfos[i];
+            buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+            buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+            buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+            if (m_CompactionEnabled) {
+                buildInfo.flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+            }
+            buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+            buildInfo.geometryCount = 1;
+            buildInfo.pGeometries = &geometries[i];
+
+            const u32 primitiveCount = build.Geometry.IndexCount / 3;
+
+            VkAccelerationStructureBuildSizesInfoKHR buildSizes{
+                .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
+            };
+            dispatch.getAccelerationStructureBuildSizesKHR(VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                                           &buildInfo, &primitiveCount, &buildSizes);
+
+            // The arena is full, the remaining builds go in a batch of their own once this one is done with it.
+            VkDeviceAddress scratchAddress;
+            if (!m_ScratchArena.Allocate(buildSizes.buildScratchSize, &scratchAddress)) {
+                assert(i > 0 && "An empty scratch arena must fit any build.");
+                break;
+            }
+            buildInfo.scratchData.deviceAddress = scratchAddress;
+
+            m_BottomLevels[build.BottomLevelIndex] = CreateAccelerationStructure(
+                VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, buildSizes.accelerationStructureSize);
+            buildInfo.dstAccelerationStructure = m_BottomLevels[build.BottomLevelIndex].Handle;
+
+            totalScratchSize += buildSizes.buildScratchSize;
+            totalAccelerationStructureSize += buildSizes.accelerationStructureSize;
+
+            buildRanges[i] = VkAccelerationStructureBuildRangeInfoKHR{
+                .primitiveCount = primitiveCount,
+                .primitiveOffset = 0,
+                .firstVertex = 0,
+                .transformOffset = 0
+            };
+            buildRangePointers[i] = &buildRanges[i];
+
+            buildCount++;
+        }
+
+        std::vector<u32> bottomLevelIndices(buildCount);
+        std::vector<u64> contentHashes(buildCount);
+        u64 uploadTicket = 0;
+        for (usize i = 0; i < buildCount; i++) {
+            bottomLevelIndices[i] = m_PendingBuilds[i].BottomLevelIndex;
+            contentHashes[i] = m_PendingBuilds[i].Geometry.ContentHash;
+            uploadTicket = std::max(uploadTicket, m_PendingBuilds[i].Geometry.UploadTicket);
+        }
+
+        // The builds read vertex and index data that may still be in flight on the transfer queue, the upload
+        // timeline is waited on by the GPU instead of the CPU.
+        std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
+        UploadService& uploadService = m_Renderer->GetUploadService();
+        if (uploadTicket != 0 && !uploadService.IsComplete(uploadTicket)) {
+            if (uploadTicket > uploadService.GetLastSubmittedTicket()) {
+                uploadService.Flush();
+            }
+
+            waitSemaphores.push_back(VkSemaphoreSubmitInfo{
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                .semaphore = uploadService.GetTimelineSemaphore(),
+                .value = uploadTicket,
+                .stageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR
+            });
+        }
+
+        SubmitBottomLevelBatch(std::span(buildInfos).first(buildCount), std::span(buildRangePointers).first(buildCount),
+                               bottomLevelIndices, contentHashes, waitSemaphores);
+
+        Log::RtTrace("Submitted {0} bottom level acceleration structure builds, {1} left for the next batches ({2} "
+                     "bytes, {3} bytes of scratch).", buildCount, pendingCount - buildCount,
+                     totalAccelerationStructureSize, totalScratchSize);
+
+        m_PendingBuilds.erase(m_PendingBuilds.begin(),
+                              m_PendingBuilds.begin() + static_cast<std::ptrdiff_t>(buildCount));
+    }
+
+    u32 AccelerationStructureManager::PollBottomLevels() {
+        AsyncQueue& computeQueue = m_Renderer->GetComputeQueue();
+
+        u32 readyCount = 0;
+
+        // The compute queue executes the batches in submission order, only the oldest one needs to be checked.
+        while (!m_InFlightBatches.empty() && computeQueue.IsComplete(m_InFlightBatches.front().Ticket)) {
+            BottomLevelBatch batch = std::move(m_InFlightBatches.front());
+            m_InFlightBatches.pop_front();
+
+            if (batch.CompactedSizeQueryPool != VK_NULL_HANDLE) {
+                // The compaction copy is submitted after every batch in flight, keep the queue order.
+                CompactBottomLevels(batch);
+                m_InFlightBatches.push_back(std::move(batch));
+                continue;
+            }
+
+            // Nothing ever referenced the original structures, and the compaction copy is done.
+            for (const auto& uncompactedBottomLevel : batch.UncompactedBottomLevels) {
+                DestroyAccelerationStructure(m_Renderer->GetDevice(), m_Renderer->GetAllocator(),
+                                             uncompactedBottomLevel);
+            }
+
+            for (const auto& stagingBuffer : batch.StagingBuffers) {
+                VulkanUtils::DestroyBuffer(m_Renderer->GetAllocator(), stagingBuffer);
+            }
+
+            if (m_BottomLevelCache && !batch.ContentHashes.empty()) {
+                SerializeBottomLevels(batch);
+            }
+
+            for (const u32 bottomLevelIndex : batch.BottomLevelIndices) {
+                m_BottomLevelsReady[bottomLevelIndex] = true;
+            }
+            readyCount += static_cast<u32>(batch.BottomLevelIndices.size());
+
+            // The TLAS build reading these BLAS on the graphics queue must wait for the compute queue writes.
+            m_Renderer->WaitOnNextSubmit(computeQueue.GetTimelineSemaphore(), batch.Ticket,
+                                         VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+        }
+
+        PollSerializations();
+
+        std::erase_if(m_PendingRemovals, [this](const u32 index) {
+            if (IsBottomLevelInFlight(index)) {
+                return false;
+            }
+
+            ReleaseBottomLevel(index);
+            return true;
+        });
+
+        computeQueue.CollectCompleted();
+
+        return readyCount;
+    }
+
+    bool AccelerationStructureManager::IsScratchArenaInUse() const {
+        return !m_Renderer->GetComputeQueue().IsComplete(m_ScratchArenaTicket);
+    }
+
+    void AccelerationStructureManager::DeserializeBottomLevels() {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+        BottomLevelBatch batch{};
+        std::vector<VkDeviceAddress> sourceAddresses;
+        std::vector<PendingBuild> remainingBuilds;
+        VkDeviceSize totalSerializedSize = 0;
+
+        std::vector<u8> serializedData;
+        for (const PendingBuild& build : m_PendingBuilds) {
+            const u64 contentHash = build.Geometry.ContentHash;
+
+            if (contentHash == 0 || !m_BottomLevelCache->Load(contentHash, serializedData)) {
+                remainingBuilds.push_back(build);
+                continue;
+            }
+
+            m_BottomLevels[build.BottomLevelIndex] = CreateAccelerationStructure(
+                VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, BottomLevelCache::GetDeserializedSize(serializedData));
+
+            VkDeviceAddress sourceAddress;
+            VkDeviceSize sourceOffset;
+            const AllocatedBuffer stagingBuffer = CreateSerializationBuffer(
+                serializedData.size(), VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                VMA_MEMORY_USAGE_CPU_TO_GPU, &sourceAddress, &sourceOffset);
+            std::memcpy(static_cast<u8*>(stagingBuffer.Info.pMappedData) + sourceOffset, serializedData.data(),
+                        serializedData.size());
+
+            batch.BottomLevelIndices.push_back(build.BottomLevelIndex);
+            batch.StagingBuffers.push_back(stagingBuffer);
+            sourceAddresses.push_back(sourceAddress);
+            totalSerializedSize += serializedData.size();
+        }
+
+        if (batch.BottomLevelIndices.empty()) {
+            return;
+        }
+
+        batch.Ticket = m_Renderer->GetComputeQueue().Submit([&](const VkCommandBuffer commandBuffer) {
+            for (usize i = 0; i < batch.BottomLevelIndices.size(); i++) {
+                VkCopyMemoryToAccelerationStructureInfoKHR copyInfo{
+                    .sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR
+                };
+                copyInfo.src.deviceAddress = sourceAddresses[i];
+                copyInfo.dst = m_BottomLevels[batch.BottomLevelIndices[i]].Handle;
+                copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR;
+
+                dispatch.cmdCopyMemoryToAccelerationStructureKHR(commandBuffer, &copyInfo);
+            }
+        });
+
+        Log::RtInfo("Loading {0} bottom level acceleration structures from the cache ({1} bytes), {2} left to build.",
+                    batch.BottomLevelIndices.size(), totalSerializedSize, remainingBuilds.size());
+
+        m_InFlightBatches.push_back(std::move(batch));
+        m_PendingBuilds = std::move(remainingBuilds);
+    }
+
+    void AccelerationStructureManager::SubmitBottomLevelBatch(
+        const std::span<const VkAccelerationStructureBuildGeometryInfoKHR> buildInfos,
+        const std::span<const VkAccelerationStructureBuildRangeInfoKHR* const> buildRangePointers,
+        const std::span<const u32> bottomLevelIndices, const std::span<const u64> contentHashes,
+        const std::span<const VkSemaphoreSubmitInfo> waitSemaphores) {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+        const u32 buildCount = static_cast<u32>(buildInfos.size());
+
+        BottomLevelBatch batch{};
+        batch.BottomLevelIndices.assign(bottomLevelIndices.begin(), bottomLevelIndices.end());
+        batch.ContentHashes.assign(contentHashes.begin(), contentHashes.end());
+
+        // The compacted sizes are queried in the same submission as the build.
+        std::vector<VkAccelerationStructureKHR> builtHandles(buildCount);
+        for (u32 i = 0; i < buildCount; i++) {
+            builtHandles[i] = buildInfos[i].dstAccelerationStructure;
+        }
+
+        // Without compaction the batch has no query pool, its BLAS are ready as soon as the build is done.
+        if (m_CompactionEnabled) {
+            VkQueryPoolCreateInfo queryPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+            queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+            queryPoolInfo.queryCount = buildCount;
+
+            VK_CHECK(vkCreateQueryPool(device.GetDevice(), &queryPoolInfo, nullptr, &batch.CompactedSizeQueryPool))
+        }
+
+        batch.Ticket = m_Renderer->GetComputeQueue().Submit([&](const VkCommandBuffer commandBuffer) {
+            if (batch.CompactedSizeQueryPool != VK_NULL_HANDLE) {
+                vkCmdResetQueryPool(commandBuffer, batch.CompactedSizeQueryPool, 0, buildCount);
+            }
+
+            dispatch.cmdBuildAccelerationStructuresKHR(commandBuffer, buildCount, buildInfos.data(),
+                                                       buildRangePointers.data());
+
+            if (batch.CompactedSizeQueryPool != VK_NULL_HANDLE) {
+                AccelerationStructureBuildBarrier(commandBuffer);
+
+                dispatch.cmdWriteAccelerationStructuresPropertiesKHR(
+                    commandBuffer, buildCount, builtHandles.data(),
+                    VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, batch.CompactedSizeQueryPool, 0);
+            }
+        }, waitSemaphores);
+
+        m_ScratchArenaTicket = batch.Ticket;
+        m_InFlightBatches.push_back(std::move(batch));
+    }
+
+    void AccelerationStructureManager::CompactBottomLevels(BottomLevelBatch& batch) {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+        const u32 count = static_cast<u32>(batch.BottomLevelIndices.size());
+
+        std::vector<VkDeviceSize> compactedSizes(count);
+        VK_CHECK(vkGetQueryPoolResults(device.GetDevice(), batch.CompactedSizeQueryPool, 0, count,
+                                       count * sizeof(VkDeviceSize), compactedSizes.data(), sizeof(VkDeviceSize),
+                                       VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT))
+
+        vkDestroyQueryPool(device.GetDevice(), batch.CompactedSizeQueryPool, nullptr);
+        batch.CompactedSizeQueryPool = VK_NULL_HANDLE;
+
+        // Right-sized copies of every BLAS of the batch.
+        std::vector<AllocatedAccelerationStructure> compactedBottomLevels(count);
+        for (u32 i = 0; i < count; i++) {
+            compactedBottomLevels[i] = CreateAccelerationStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+                                                                   compactedSizes[i]);
+        }
+
+        batch.Ticket = m_Renderer->GetComputeQueue().Submit([&](const VkCommandBuffer commandBuffer) {
+            AccelerationStructureBuildBarrier(commandBuffer);
+
+            for (u32 i = 0; i < count; i++) {
+                VkCopyAccelerationStructureInfoKHR copyInfo{
+                    .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR
+                };
+                copyInfo.src = m_BottomLevels[batch.BottomLevelIndices[i]].Handle;
+                copyInfo.dst = compactedBottomLevels[i].Handle;
+                copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+
+                dispatch.cmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+            }
+        });
+
+        VkDeviceSize totalOriginalSize = 0;
+        VkDeviceSize totalCompactedSize = 0;
+
+        // The originals are released once the copy is done, see PollBottomLevels.
+        batch.UncompactedBottomLevels.resize(count);
+        for (u32 i = 0; i < count; i++) {
+            const u32 bottomLevelIndex = batch.BottomLevelIndices[i];
+            const AllocatedAccelerationStructure& original = m_BottomLevels[bottomLevelIndex];
+
+            Log::RtTrace("BLAS #{0} compacted from {1} to {2} bytes ({3} bytes saved).", bottomLevelIndex,
+                         original.Size, compactedBottomLevels[i].Size, original.Size - compactedBottomLevels[i].Size);
+
+            totalOriginalSize += original.Size;
+            totalCompactedSize += compactedBottomLevels[i].Size;
+
+            batch.UncompactedBottomLevels[i] = original;
+            m_BottomLevels[bottomLevelIndex] = compactedBottomLevels[i];
+        }
+
+        Log::RtInfo("Compacted {0} bottom level acceleration structures from {1} to {2} bytes ({3} bytes saved).",
+                    count, totalOriginalSize, totalCompactedSize, totalOriginalSize - totalCompactedSize);
+    }
+
+    void AccelerationStructureManager::SerializeBottomLevels(const BottomLevelBatch& batch) {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+        SerializationBatch serialization{};
+        std::vector<VkAccelerationStructureKHR> handles;
+        for (usize i = 0; i < batch.BottomLevelIndices.size(); i++) {
+            if (batch.ContentHashes[i] != 0) {
+                serialization.BottomLevelIndices.push_back(batch.BottomLevelIndices[i]);
+                serialization.ContentHashes.push_back(batch.ContentHashes[i]);
+                handles.push_back(m_BottomLevels[batch.BottomLevelIndices[i]].Handle);
+            }
+        }
+
+        if (handles.empty()) {
+            return;
+        }
+
+        const u32 count = static_cast<u32>(handles.size());
+
+        VkQueryPoolCreateInfo queryPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR;
+        queryPoolInfo.queryCount = count;
+
+        VK_CHECK(vkCreateQueryPool(device.GetDevice(), &queryPoolInfo, nullptr,
+                                   &serialization.SerializationSizeQueryPool))
+
+        serialization.Ticket = m_Renderer->GetComputeQueue().Submit([&](const VkCommandBuffer commandBuffer) {
+            vkCmdResetQueryPool(commandBuffer, serialization.SerializationSizeQueryPool, 0, count);
+
+            AccelerationStructureBuildBarrier(commandBuffer);
+
+            dispatch.cmdWriteAccelerationStructuresPropertiesKHR(
+                commandBuffer, count, handles.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+                serialization.SerializationSizeQueryPool, 0);
+        });
+
+        m_InFlightSerializations.push_back(std::move(serialization));
+    }
+
+    void AccelerationStructureManager::PollSerializations() {
+        const AsyncQueue& computeQueue = m_Renderer->GetComputeQueue();
+
+        while (!m_InFlightSerializations.empty() && computeQueue.IsComplete(m_InFlightSerializations.front().Ticket)) {
+            SerializationBatch batch = std::move(m_InFlightSerializations.front());
+            m_InFlightSerializations.pop_front();
+
+            if (batch.SerializationSizeQueryPool != VK_NULL_HANDLE) {
+                ReadBackSerializedBottomLevels(batch);
+                m_InFlightSerializations.push_back(std::move(batch));
+                continue;
+            }
+
+            StoreSerializedBottomLevels(batch);
+        }
+    }
+
+    void AccelerationStructureManager::ReadBackSerializedBottomLevels(SerializationBatch& batch) {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+        const u32 count = static_cast<u32>(batch.BottomLevelIndices.size());
+
+        batch.SerializedSizes.resize(count);
+        VK_CHECK(vkGetQueryPoolResults(device.GetDevice(), batch.SerializationSizeQueryPool, 0, count,
+                                       count * sizeof(VkDeviceSize), batch.SerializedSizes.data(),
+                                       sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT))
+
+        vkDestroyQueryPool(device.GetDevice(), batch.SerializationSizeQueryPool, nullptr);
+        batch.SerializationSizeQueryPool = VK_NULL_HANDLE;
+
+        std::vector<VkDeviceAddress> destinationAddresses(count);
+        batch.ReadbackBuffers.resize(count);
+        batch.ReadbackOffsets.resize(count);
+        for (u32 i = 0; i < count; i++) {
+            batch.ReadbackBuffers[i] = CreateSerializationBuffer(batch.SerializedSizes[i],
+                                                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                 VMA_MEMORY_USAGE_GPU_TO_CPU,
+                                                                 &destinationAddresses[i], &batch.ReadbackOffsets[i]);
+        }
+
+        batch.Ticket = m_Renderer->GetComputeQueue().Submit([&](const VkCommandBuffer commandBuffer) {
+            for (u32 i = 0; i < count; i++) {
+                VkCopyAccelerationStructureToMemoryInfoKHR copyInfo{
+                    .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR
+                };
+                copyInfo.src = m_BottomLevels[batch.BottomLevelIndices[i]].Handle;
+                copyInfo.dst.deviceAddress = destinationAddresses[i];
+                copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+
+                dispatch.cmdCopyAccelerationStructureToMemoryKHR(commandBuffer, &copyInfo);
+            }
+
+            // The serialized data is read on the host once the ticket is reached.
+            VkMemoryBarrier2 memoryBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+            memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+            memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+            VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            dependencyInfo.memoryBarrierCount = 1;
+            dependencyInfo.pMemoryBarriers = &memoryBarrier;
+
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        });
+    }
+
+    void AccelerationStructureManager::StoreSerializedBottomLevels(const SerializationBatch& batch) {
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        VkDeviceSize totalSerializedSize = 0;
+        for (usize i = 0; i < batch.BottomLevelIndices.size(); i++) {
+            const AllocatedBuffer& readbackBuffer = batch.ReadbackBuffers[i];
+
+            VK_CHECK(vmaInvalidateAllocation(allocator, readbackBuffer.Allocation, 0, VK_WHOLE_SIZE))
+
+            const u8* serializedData = static_cast<const u8*>(readbackBuffer.Info.pMappedData) +
+                                       batch.ReadbackOffsets[i];
+            m_BottomLevelCache->Store(batch.ContentHashes[i],
+                                      std::span(serializedData, batch.SerializedSizes[i]));
+
+            totalSerializedSize += batch.SerializedSizes[i];
+
+            VulkanUtils::DestroyBuffer(allocator, readbackBuffer);
+        }
+
+        Log::RtTrace("Stored {0} bottom level acceleration structures in the cache ({1} bytes).",
+                     batch.BottomLevelIndices.size(), totalSerializedSize);
+    }
+
+    bool AccelerationStructureManager::IsBottomLevelInFlight(const u32 index) const {
+        const auto readsBottomLevel = [index](const auto& batch) {
+            return std::ranges::find(batch.BottomLevelIndices, index) != batch.BottomLevelIndices.end();
+        };
+
+        return std::ranges::any_of(m_InFlightBatches, readsBottomLevel) ||
+               std::ranges::any_of(m_InFlightSerializations, readsBottomLevel);
+    }
+
+    void AccelerationStructureManager::ReleaseBottomLevel(const u32 index) {
+        // Frames in flight may still trace against a TLAS instancing the BLAS.
+        if (m_BottomLevels[index].Handle != VK_NULL_HANDLE) {
+            m_Renderer->PlanFrameDeletion([&device = m_Renderer->GetDevice(), allocator = m_Renderer->GetAllocator(),
+                                           bottomLevel = m_BottomLevels[index]]() {
+                DestroyAccelerationStructure(device, allocator, bottomLevel);
+            });
+        }
+
+        m_BottomLevels[index] = {};
+        m_BottomLevelsReady[index] = false;
+        m_BottomLevelContentHashes[index] = 0;
+        m_FreeBottomLevels.push_back(index);
+    }
+
+    bool AccelerationStructureManager::UpdateTopLevel(const VkCommandBuffer commandBuffer,
+                                                      const std::span<const AccelerationStructureInstance> instances,
+                                                      const bool topologyChanged) {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        const u32 frameIndex = m_Renderer->GetCurrentFrameIndex();
+        const u32 instanceCount = static_cast<u32>(instances.size());
+
+        WriteInstances(instances, frameIndex);
+
+        // Refitting keeps the tree topology, so it is only valid when nothing but the transforms changed, and gets
+        // worse as the instances move.
+        const bool update = m_TopLevel.Handle != VK_NULL_HANDLE && !topologyChanged &&
+                            instanceCount == m_TopLevelInstanceCount && !HasTopLevelTopologyChanged(instances) &&
+                            m_TopLevelUpdateCount < g_MaxTopLevelUpdates && !HasTopLevelDegraded(instances);
+
+        VkAccelerationStructureGeometryKHR geometry{.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR};
+        geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+        geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+        geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+        geometry.geometry.instances.data.deviceAddress = VulkanUtils::GetBufferDeviceAddress(
+            device.GetDevice(), m_InstanceBuffers[frameIndex]);
+
+        VkAccelerationStructureBuildGeometryInfoKHR buildInfo{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR
+        };
+        buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+        buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                          VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+        buildInfo.mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR
+                                : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+        buildInfo.geometryCount = 1;
+        buildInfo.pGeometries = &geometry;
+
+        VkAccelerationStructureBuildSizesInfoKHR buildSizes{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
+        };
+        dispatch.getAccelerationStructureBuildSizesKHR(VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo,
+                                                       &instanceCount, &buildSizes);
+
+        // Rebuilds reuse the current TLAS as long as it is big enough, so the descriptors stay valid.
+        bool topLevelChanged = false;
+        if (!update && buildSizes.accelerationStructureSize > m_TopLevel.Size) {
+            // Frames in flight may still trace against the previous TLAS.
+            if (m_TopLevel.Handle != VK_NULL_HANDLE) {
+                m_Renderer->PlanFrameDeletion([&device, allocator, topLevel = m_TopLevel]() {
+                    DestroyAccelerationStructure(device, allocator, topLevel);
+                });
+            }
+
+            m_TopLevel = CreateAccelerationStructure(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+                                                     buildSizes.accelerationStructureSize);
+            topLevelChanged = true;
+        }
+
+        buildInfo.srcAccelerationStructure = update ? m_TopLevel.Handle : VK_NULL_HANDLE;
+        buildInfo.dstAccelerationStructure = m_TopLevel.Handle;
+
+        ReserveTopLevelScratch(update ? buildSizes.updateScratchSize : buildSizes.buildScratchSize);
+        buildInfo.scratchData.deviceAddress = m_TopLevelScratchAddress;
+
+        const VkAccelerationStructureBuildRangeInfoKHR buildRange{
+            .primitiveCount = instanceCount,
+            .primitiveOffset = 0,
+            .firstVertex = 0,
+            .transformOffset = 0
+        };
+        const VkAccelerationStructureBuildRangeInfoKHR* buildRangePointer = &buildRange;
+
+        AccelerationStructureBuildBarrier(commandBuffer);
+
+        dispatch.cmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, &buildRangePointer);
+
+        AccelerationStructureReadBarrier(commandBuffer);
+
+        if (update) {
+            m_TopLevelUpdateCount++;
+        } else {
+            RecordTopLevelRebuild(instances);
+
+            Log::RtTrace("Rebuilt top level acceleration structure with {0} instances ({1} bytes).", instanceCount,
+                         buildSizes.accelerationStructureSize);
+        }
+
+        return topLevelChanged;
+    }
+
+    void AccelerationStructureManager::WriteInstances(const std::span<const AccelerationStructureInstance> instances,
+                                                      const u32 frameIndex) {
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        AllocatedBuffer& instanceBuffer = m_InstanceBuffers[frameIndex];
+        usize& instanceBufferCapacity = m_InstanceBufferCapacities[frameIndex];
+
+        // The last build reading this buffer belongs to a frame the GPU is done with.
+        if (instanceBuffer.Buffer == VK_NULL_HANDLE || instances.size() > instanceBufferCapacity) {
+            if (instanceBuffer.Buffer != VK_NULL_HANDLE) {
+                VulkanUtils::DestroyBuffer(allocator, instanceBuffer);
+            }
+
+            instanceBufferCapacity = std::max<usize>(instances.size(), 1);
+            instanceBuffer = VulkanUtils::CreateBuffer(allocator,
+                                                       instanceBufferCapacity * sizeof(VkAccelerationStructureInstanceKHR),
+                                                       VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                                                       VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                                                       VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        auto* mappedInstances = static_cast<VkAccelerationStructureInstanceKHR*>(instanceBuffer.Info.pMappedData);
+        for (usize i = 0; i < instances.size(); i++) {
+            const AccelerationStructureInstance& instance = instances[i];
+
+            VkAccelerationStructureInstanceKHR vkInstance{};
+            vkInstance.transform = ToTransformMatrix(instance.Transform);
+            vkInstance.instanceCustomIndex = instance.CustomIndex;
+            vkInstance.mask = instance.Mask;
+            vkInstance.instanceShaderBindingTableRecordOffset = 0;
+            vkInstance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+            if (instance.Opaque) {
+                vkInstance.flags |= VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR;
+            }
+            vkInstance.accelerationStructureReference = m_BottomLevels[instance.BottomLevelIndex].DeviceAddress;
+
+            memcpy(&mappedInstances[i], &vkInstance, sizeof(VkAccelerationStructureInstanceKHR));
+        }
+        VK_CHECK(vmaFlushAllocation(allocator, instanceBuffer.Allocation, 0, VK_WHOLE_SIZE))
+    }
+
+    bool AccelerationStructureManager::HasTopLevelTopologyChanged(
+        const std::span<const AccelerationStructureInstance> instances) const {
+        for (usize i = 0; i < instances.size(); i++) {
+            const AccelerationStructureInstance& instance = instances[i];
+
+            // BLAS slots are reused once released, the address tells the structures apart.
+            const InstanceTopology topology{
+                m_BottomLevels[instance.BottomLevelIndex].DeviceAddress, instance.CustomIndex, instance.Mask,
+                instance.Opaque
+            };
+            if (topology != m_RebuildInstanceTopologies[i]) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool AccelerationStructureManager::HasTopLevelDegraded(
+        const std::span<const AccelerationStructureInstance> instances) const {
+        // Refitted bounds grow with the distance instances travelled since the tree was built.
+        const f32 maxDrift = g_MaxInstanceDrift * m_RebuildInstanceExtent;
+
+        for (usize i = 0; i < instances.size(); i++) {
+            const glm::vec3 translation = glm::vec3(instances[i].Transform[3]);
+
+            if (glm::distance(translation, m_RebuildInstanceTranslations[i]) > maxDrift) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void AccelerationStructureManager::RecordTopLevelRebuild(
+        const std::span<const AccelerationStructureInstance> instances) {
+        m_TopLevelInstanceCount = static_cast<u32>(instances.size());
+        m_TopLevelUpdateCount = 0;
+
+        m_RebuildInstanceTranslations.resize(instances.size());
+        m_RebuildInstanceTopologies.resize(instances.size());
+
+        glm::vec3 minimum(std::numeric_limits<f32>::max());
+        glm::vec3 maximum(std::numeric_limits<f32>::lowest());
+        for (usize i = 0; i < instances.size(); i++) {
+            m_RebuildInstanceTranslations[i] = glm::vec3(instances[i].Transform[3]);
+            m_RebuildInstanceTopologies[i] = {
+                m_BottomLevels[instances[i].BottomLevelIndex].DeviceAddress, instances[i].CustomIndex,
+                instances[i].Mask, instances[i].Opaque
+            };
+
+            minimum = glm::min(minimum, m_RebuildInstanceTranslations[i]);
+            maximum = glm::max(maximum, m_RebuildInstanceTranslations[i]);
+        }
+
+        // Single instance scenes have no extent, fall back to a unit one.
+        m_RebuildInstanceExtent = instances.empty() ? 1.f : std::max(glm::distance(minimum, maximum), 1.f);
+    }
+
+    void AccelerationStructureManager::ReserveTopLevelScratch(const VkDeviceSize size) {
+        if (size <= m_TopLevelScratchSize) {
+            return;
+        }
+
+        // The previous frame may still be building with the old scratch buffer.
+        if (m_TopLevelScratchBuffer.Buffer != VK_NULL_HANDLE) {
+            m_Renderer->PlanFrameDeletion([allocator = m_Renderer->GetAllocator(), buffer = m_TopLevelScratchBuffer]() {
+                VulkanUtils::DestroyBuffer(allocator, buffer);
+            });
+        }
+
+        m_TopLevelScratchBuffer = CreateScratchBuffer(size, &m_TopLevelScratchAddress);
+        m_TopLevelScratchSize = size;
+    }
+
+    AllocatedAccelerationStructure AccelerationStructureManager::CreateAccelerationStructure(
+        const VkAccelerationStructureTypeKHR type, const VkDeviceSize size) const {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+
+        AllocatedAccelerationStructure accelerationStructure{};
+        accelerationStructure.Size = size;
+        // BLAS are built on the compute queue and traced against on the graphics queue.
+        accelerationStructure.Buffer = VulkanUtils::CreateBuffer(m_Renderer->GetAllocator(), size,
+                                                                 VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR
+                                                                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                                 VMA_MEMORY_USAGE_GPU_ONLY,
+                                                                 device.GetSharedQueueFamilyIndices());
+
+        VkAccelerationStructureCreateInfoKHR createInfo{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR
+        };
+        createInfo.buffer = accelerationStructure.Buffer.Buffer;
+        createInfo.offset = 0;
+        createInfo.size = size;
+        createInfo.type = type;
+
+        VK_CHECK(device.GetDispatchTable().createAccelerationStructureKHR(&createInfo, nullptr,
+                                                                         &accelerationStructure.Handle))
+
+        VkAccelerationStructureDeviceAddressInfoKHR addressInfo{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR
+        };
+        addressInfo.accelerationStructure = accelerationStructure.Handle;
+        accelerationStructure.DeviceAddress = device.GetDispatchTable().getAccelerationStructureDeviceAddressKHR(
+            &addressInfo);
+
+        return accelerationStructure;
+    }
+
+    AllocatedBuffer AccelerationStructureManager::CreateScratchBuffer(const VkDeviceSize size,
+                                                                      VkDeviceAddress* outAlignedAddress) const {
+        const VulkanWrapper::Device& device = m_Renderer->GetDevice();
+        const VkDeviceSize alignment = device.GetAccelerationStructureProperties().
+                                              minAccelerationStructureScratchOffsetAlignment;
+
+        const AllocatedBuffer scratchBuffer = VulkanUtils::CreateBuffer(m_Renderer->GetAllocator(), size + alignment,
+                                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                                        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                                        VMA_MEMORY_USAGE_GPU_ONLY);
+
+        *outAlignedAddress = VulkanUtils::AlignUp(VulkanUtils::GetBufferDeviceAddress(device.GetDevice(),
+                                                                                      scratchBuffer), alignment);
+
+        return scratchBuffer;
+    }
+
+    AllocatedBuffer AccelerationStructureManager::CreateSerializationBuffer(const VkDeviceSize size,
+                                                                            const VkBufferUsageFlags usage,
+                                                                            const VmaMemoryUsage memoryUsage,
+                                                                            VkDeviceAddress* outAlignedAddress,
+                                                                            VkDeviceSize* outAlignedOffset) const {
+        constexpr VkDeviceSize alignment = 256;
+
+        const AllocatedBuffer buffer = VulkanUtils::CreateBuffer(m_Renderer->GetAllocator(), size + alignment,
+                                                                 usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                                 memoryUsage);
+
+        const VkDeviceAddress address = VulkanUtils::GetBufferDeviceAddress(m_Renderer->GetDevice().GetDevice(),
+                                                                            buffer);
+        *outAlignedAddress = VulkanUtils::AlignUp(address, alignment);
+        *outAlignedOffset = *outAlignedAddress - address;
+
+        return buffer;
+    }
+}
@@ -0,0 +1,105 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/AsyncQueue.hpp>
+
+#include <Raytracer/Renderer/VulkanInitializers.hpp>
+
+namespace Raytracer::Renderer {
+    AsyncQueue::AsyncQueue(const VulkanWrapper::Device& device, const VkQueue queue, const u32 queueFamilyIndex)
+        : m_Device(device), m_Queue(queue), m_QueueFamilyIndex(queueFamilyIndex) {
+        const VkCommandPoolCreateInfo commandPoolInfo = VulkanInit::CommandPoolCreateInfo(
+            m_QueueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+        VK_CHECK(vkCreateCommandPool(m_Device.GetDevice(), &commandPoolInfo, nullptr, &m_CommandPool))
+
+        VkSemaphoreTypeCreateInfo semaphoreTypeInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        semaphoreTypeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = VulkanInit::SemaphoreCreateInfo();
+        semaphoreInfo.pNext = &semaphoreTypeInfo;
+
+        VK_CHECK(vkCreateSemaphore(m_Device.GetDevice(), &semaphoreInfo, nullptr, &m_TimelineSemaphore))
+
+        Log::RtTrace("Asynchronous queue created on queue family #{0}.", m_QueueFamilyIndex);
+    }
+
+    AsyncQueue::~AsyncQueue() {
+        Wait(m_LastSubmittedTicket);
+
+        vkDestroySemaphore(m_Device.GetDevice(), m_TimelineSemaphore, nullptr);
+        vkDestroyCommandPool(m_Device.GetDevice(), m_CommandPool, nullptr);
+    }
+
+    u64 AsyncQueue::Submit(const std::function<void(VkCommandBuffer commandBuffer)>& function,
+                           const std::span<const VkSemaphoreSubmitInfo> waitSemaphores) {
+        CollectCompleted();
+
+        VkCommandBuffer commandBuffer;
+        if (m_FreeCommandBuffers.empty()) {
+            const VkCommandBufferAllocateInfo commandBufferInfo = VulkanInit::CommandBufferAllocateInfo(m_CommandPool);
+            VK_CHECK(vkAllocateCommandBuffers(m_Device.GetDevice(), &commandBufferInfo, &commandBuffer))
+        } else {
+            commandBuffer = m_FreeCommandBuffers.back();
+            m_FreeCommandBuffers.pop_back();
+
+            VK_CHECK(vkResetCommandBuffer(commandBuffer, 0))
+        }
+
+        const VkCommandBufferBeginInfo beginInfo = VulkanInit::CommandBufferBeginInfo(
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo))
+
+        function(commandBuffer);
+
+        VK_CHECK(vkEndCommandBuffer(commandBuffer))
+
+        const u64 ticket = m_LastSubmittedTicket + 1;
+
+        const VkCommandBufferSubmitInfo commandBufferInfo = VulkanInit::CommandBufferSubmitInfo(commandBuffer);
+
+        VkSemaphoreSubmitInfo signalInfo = VulkanInit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                                                           m_TimelineSemaphore);
+        signalInfo.value = ticket;
+
+        VkSubmitInfo2 submit = VulkanInit::SubmitInfo(&commandBufferInfo, &signalInfo, nullptr);
+        submit.waitSemaphoreInfoCount = static_cast<u32>(waitSemaphores.size());
+        submit.pWaitSemaphoreInfos = waitSemaphores.data();
+
+        VK_CHECK(vkQueueSubmit2(m_Queue, 1, &submit, VK_NULL_HANDLE))
+
+        m_LastSubmittedTicket = ticket;
+        m_InFlightSubmissions.push_back({commandBuffer, ticket});
+
+        return ticket;
+    }
+
+    bool AsyncQueue::IsComplete(const u64 ticket) const {
+        u64 completedTicket;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_Device.GetDevice(), m_TimelineSemaphore, &completedTicket))
+
+        return completedTicket >= ticket;
+    }
+
+    void AsyncQueue::Wait(const u64 ticket) const {
+        VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_TimelineSemaphore;
+        waitInfo.pValues = &ticket;
+
+        VK_CHECK(vkWaitSemaphores(m_Device.GetDevice(), &waitInfo, UINT64_MAX))
+    }
+
+    void AsyncQueue::CollectCompleted() {
+        u64 completedTicket;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_Device.GetDevice(), m_TimelineSemaphore, &completedTicket))
+
+        while (!m_InFlightSubmissions.empty() && m_InFlightSubmissions.front().Ticket <= completedTicket) {
+            m_FreeCommandBuffers.push_back(m_InFlightSubmissions.front().CommandBuffer);
+            m_InFlightSubmissions.pop_front();
+        }
+    }
+}
@@ -0,0 +1,133 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/BottomLevelCache.hpp>
+
+#include <Raytracer/Core/Hash.hpp>
+
+#include <cstring>
+#include <format>
+#include <fstream>
+
+namespace Raytracer::Renderer {
+    namespace {
+        constexpr u32 g_CacheFileMagic = 0x53414C42; // "BLAS"
+        constexpr u32 g_CacheFileVersion = 2;
+
+        // Serialized acceleration structures start with the driver UUID, the compatibility UUID, the serialized size,
+        // the deserialized size and the number of instance handles that follow.
+        constexpr usize g_SerializedHeaderSize = 2 * VK_UUID_SIZE + 3 * sizeof(u64);
+        constexpr usize g_SerializedSizeOffset = 2 * VK_UUID_SIZE;
+        constexpr usize g_DeserializedSizeOffset = 2 * VK_UUID_SIZE + sizeof(u64);
+    }
+
+    BottomLevelCache::BottomLevelCache(const VulkanWrapper::Device& device, std::filesystem::path directory)
+        : m_Device(device), m_Directory(std::move(directory)) {
+        std::error_code error;
+        std::filesystem::create_directories(m_Directory, error);
+
+        if (error) {
+            Log::RtWarn("Failed to create the BLAS cache directory {0}: {1}.", m_Directory.string(), error.message());
+        }
+    }
+
+    bool BottomLevelCache::Load(const u64 contentHash, std::vector<u8>& outSerializedData) const {
+        const std::filesystem::path path = GetEntryPath(contentHash);
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        FileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        bool valid = file.good() && header.Magic == g_CacheFileMagic && header.Version == g_CacheFileVersion &&
+                     header.ContentHash == contentHash && header.DataSize >= g_SerializedHeaderSize;
+
+        if (valid) {
+            outSerializedData.resize(header.DataSize);
+            file.read(reinterpret_cast<char*>(outSerializedData.data()),
+                      static_cast<std::streamsize>(header.DataSize));
+
+            u64 serializedSize;
+            std::memcpy(&serializedSize, outSerializedData.data() + g_SerializedSizeOffset, sizeof(u64));
+
+            valid = file.good() && serializedSize == header.DataSize;
+        }
+
+        file.close();
+
+        if (!valid) {
+            Log::RtWarn("Discarding corrupted BLAS cache entry {0}.", path.string());
+            std::filesystem::remove(path);
+            return false;
+        }
+
+        // The driver tells whether it can still read what it serialized, e.g. after an update.
+        VkAccelerationStructureVersionInfoKHR versionInfo{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR
+        };
+        versionInfo.pVersionData = outSerializedData.data();
+
+        VkAccelerationStructureCompatibilityKHR compatibility;
+        m_Device.GetDispatchTable().getDeviceAccelerationStructureCompatibilityKHR(&versionInfo, &compatibility);
+
+        if (compatibility != VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR) {
+            Log::RtInfo("BLAS cache entry {0} is incompatible with the current driver, it will be rebuilt.",
+                        path.string());
+            std::filesystem::remove(path);
+            return false;
+        }
+
+        return true;
+    }
+
+    void BottomLevelCache::Store(const u64 contentHash, const std::span<const u8> serializedData) const {
+        const std::filesystem::path path = GetEntryPath(contentHash);
+
+        // Written next to the entry then renamed, a crash mid-write never leaves a truncated entry behind.
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            Log::RtWarn("Failed to open BLAS cache entry {0} for writing.", temporaryPath.string());
+            return;
+        }
+
+        const FileHeader header{
+            .Magic = g_CacheFileMagic,
+            .Version = g_CacheFileVersion,
+            .ContentHash = contentHash,
+            .DataSize = serializedData.size()
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(serializedData.data()),
+                   static_cast<std::streamsize>(serializedData.size()));
+        file.close();
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+
+        if (error) {
+            Log::RtWarn("Failed to write BLAS cache entry {0}: {1}.", path.string(), error.message());
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+
+    VkDeviceSize BottomLevelCache::GetDeserializedSize(const std::span<const u8> serializedData) {
+        u64 deserializedSize;
+        std::memcpy(&deserializedSize, serializedData.data() + g_DeserializedSizeOffset, sizeof(u64));
+
+        return deserializedSize;
+    }
+
+    std::filesystem::path BottomLevelCache::GetEntryPath(const u64 contentHash) const {
+        // The same mesh serialized by another driver is a different entry.
+        const u64 key = HashRange(std::span<const u8>(m_Device.GetDriverUUID()), contentHash);
+
+        return m_Directory / std::format("{:016x}.blas", key);
+    }
+}
@@ -0,0 +1,230 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/FrameReadback.hpp>
+
+#include <Raytracer/Core/ImageWriter.hpp>
+
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
+
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace Raytracer::Renderer {
+    namespace {
+        u32 GetTexelSize(const VkFormat format) {
+            switch (format) {
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                case VK_FORMAT_R8G8B8A8_SRGB:
+                case VK_FORMAT_B8G8R8A8_UNORM:
+                case VK_FORMAT_B8G8R8A8_SRGB:
+                    return 4;
+                case VK_FORMAT_R16G16B16A16_SFLOAT:
+                    return 8;
+                case VK_FORMAT_R32G32B32A32_SFLOAT:
+                    return 16;
+                default:
+                    return 0;
+            }
+        }
+
+        bool IsFloatFormat(const VkFormat format) {
+            return format == VK_FORMAT_R16G16B16A16_SFLOAT || format == VK_FORMAT_R32G32B32A32_SFLOAT;
+        }
+
+        f32 HalfToFloat(const u16 half) {
+            const u32 sign = static_cast<u32>(half & 0x8000) << 16;
+            const u32 exponent = (half >> 10) & 0x1F;
+            const u32 mantissa = half & 0x3FF;
+
+            if (exponent == 0) {
+                // Zero or denormal, 2^-24 is the smallest denormal step.
+                const f32 value = static_cast<f32>(mantissa) * 0x1.0p-24f;
+                return sign != 0 ? -value : value;
+            }
+
+            if (exponent == 0x1F) {
+                return std::bit_cast<f32>(sign | 0x7F800000u | (mantissa << 13));
+            }
+
+            return std::bit_cast<f32>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+        }
+    }
+
+    FrameReadback::FrameReadback(const VmaAllocator allocator, const u32 framesInFlight, const u32 workerCount)
+        : m_Allocator(allocator) {
+        m_Slots.resize(framesInFlight + workerCount);
+        for (u32 i = 0; i < m_Slots.size(); i++) {
+            m_FreeSlots.push_back(i);
+        }
+
+        m_Workers.reserve(workerCount);
+        for (u32 i = 0; i < workerCount; i++) {
+            m_Workers.emplace_back([this](const std::stop_token& stopToken) {
+                RunWorker(stopToken);
+            });
+        }
+    }
+
+    FrameReadback::~FrameReadback() {
+        {
+            std::unique_lock lock(m_Mutex);
+            m_SlotFreedCondition.wait(lock, [this]() { return m_FreeSlots.size() == m_Slots.size(); });
+        }
+
+        for (std::jthread& worker : m_Workers) {
+            worker.request_stop();
+        }
+        m_Workers.clear();
+
+        for (const Slot& slot : m_Slots) {
+            if (slot.Capacity != 0) {
+                VulkanUtils::DestroyBuffer(m_Allocator, slot.Buffer);
+            }
+        }
+    }
+
+    u32 FrameReadback::RecordCapture(const VkCommandBuffer commandBuffer, const AllocatedImage& image,
+                                     const VkExtent2D extent, std::filesystem::path path) {
+        assert(IsSupportedFormat(image.ImageFormat) && "Unsupported capture format.");
+
+        u32 slotIndex;
+        {
+            std::unique_lock lock(m_Mutex);
+            if (m_FreeSlots.empty()) {
+                Log::RtWarn("Frame captures are waiting for the encoders.");
+            }
+
+            m_SlotFreedCondition.wait(lock, [this]() { return !m_FreeSlots.empty(); });
+
+            slotIndex = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+
+        // Free slots aren't referenced by the GPU nor the workers anymore.
+        Slot& slot = m_Slots[slotIndex];
+
+        const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height *
+                                  GetTexelSize(image.ImageFormat);
+        if (slot.Capacity < size) {
+            if (slot.Capacity != 0) {
+                VulkanUtils::DestroyBuffer(m_Allocator, slot.Buffer);
+            }
+
+            slot.Buffer = VulkanUtils::CreateBuffer(m_Allocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                    VMA_MEMORY_USAGE_GPU_TO_CPU);
+            slot.Capacity = size;
+        }
+
+        slot.Format = image.ImageFormat;
+        slot.Extent = extent;
+        slot.Path = std::move(path);
+        slot.Path.replace_extension(IsFloatFormat(slot.Format) ? ".exr" : ".png");
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+
+        vkCmdCopyImageToBuffer(commandBuffer, image.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.Buffer.Buffer, 1,
+                               &region);
+
+        // The fence signal alone doesn't make the copy visible to the host.
+        VkMemoryBarrier2 memoryBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+        VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependencyInfo.memoryBarrierCount = 1;
+        dependencyInfo.pMemoryBarriers = &memoryBarrier;
+
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+        return slotIndex;
+    }
+
+    void FrameReadback::Encode(const u32 slotIndex) {
+        {
+            std::scoped_lock lock(m_Mutex);
+            m_EncodeQueue.push_back(slotIndex);
+        }
+
+        m_EncodeCondition.notify_one();
+    }
+
+    bool FrameReadback::IsSupportedFormat(const VkFormat format) {
+        return GetTexelSize(format) != 0;
+    }
+
+    void FrameReadback::RunWorker(const std::stop_token& stopToken) {
+        while (!stopToken.stop_requested()) {
+            u32 slotIndex;
+            {
+                std::unique_lock lock(m_Mutex);
+                if (!m_EncodeCondition.wait(lock, stopToken, [this]() { return !m_EncodeQueue.empty(); })) {
+                    return;
+                }
+
+                slotIndex = m_EncodeQueue.front();
+                m_EncodeQueue.pop_front();
+            }
+
+            WriteImage(m_Slots[slotIndex]);
+
+            {
+                std::scoped_lock lock(m_Mutex);
+                m_FreeSlots.push_back(slotIndex);
+            }
+
+            m_SlotFreedCondition.notify_all();
+        }
+    }
+
+    void FrameReadback::WriteImage(const Slot& slot) const {
+        const u32 width = slot.Extent.width;
+        const u32 height = slot.Extent.height;
+        const usize pixelCount = static_cast<usize>(width) * height;
+
+        VK_CHECK(vmaInvalidateAllocation(m_Allocator, slot.Buffer.Allocation, 0, VK_WHOLE_SIZE))
+        const auto* data = static_cast<const std::byte*>(slot.Buffer.Info.pMappedData);
+
+        bool written;
+        if (IsFloatFormat(slot.Format)) {
+            std::vector<f32> rgb(pixelCount * 3);
+            for (usize i = 0; i < pixelCount; i++) {
+                for (usize channel = 0; channel < 3; channel++) {
+                    if (slot.Format == VK_FORMAT_R16G16B16A16_SFLOAT) {
+                        u16 half;
+                        std::memcpy(&half, data + (i * 4 + channel) * sizeof(u16), sizeof(u16));
+                        rgb[i * 3 + channel] = HalfToFloat(half);
+                    } else {
+                        std::memcpy(&rgb[i * 3 + channel], data + (i * 4 + channel) * sizeof(f32), sizeof(f32));
+                    }
+                }
+            }
+
+            written = WriteExr(slot.Path, width, height, rgb);
+        } else {
+            // Alpha is dropped, the draw image doesn't hold coverage.
+            const bool bgr = slot.Format == VK_FORMAT_B8G8R8A8_UNORM || slot.Format == VK_FORMAT_B8G8R8A8_SRGB;
+            const auto* texels = reinterpret_cast<const u8*>(data);
+
+            std::vector<u8> rgb(pixelCount * 3);
+            for (usize i = 0; i < pixelCount; i++) {
+                rgb[i * 3 + 0] = texels[i * 4 + (bgr ? 2 : 0)];
+                rgb[i * 3 + 1] = texels[i * 4 + 1];
+                rgb[i * 3 + 2] = texels[i * 4 + (bgr ? 0 : 2)];
+            }
+
+            written = WritePng(slot.Path, width, height, rgb);
+        }
+
+        if (written) {
+            Log::RtTrace("Captured frame to {0}.", slot.Path.string());
+        }
+    }
+}
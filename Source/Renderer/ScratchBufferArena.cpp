@@ -0,0 +1,88 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/ScratchBufferArena.hpp>
+
+#include <Raytracer/Renderer/VulkanRenderer.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
+
+namespace Raytracer::Renderer {
+    ScratchBufferArena::ScratchBufferArena(VulkanRenderer* renderer, const VkDeviceSize blockSize,
+                                           const u32 maxBlocks) : m_Renderer(renderer), m_BlockSize(blockSize),
+                                                                  m_MaxBlocks(maxBlocks) {
+        m_Alignment = m_Renderer->GetDevice().GetAccelerationStructureProperties().
+                                  minAccelerationStructureScratchOffsetAlignment;
+    }
+
+    ScratchBufferArena::~ScratchBufferArena() {
+        for (const auto& block : m_Blocks) {
+            VulkanUtils::DestroyBuffer(m_Renderer->GetAllocator(), block.Buffer);
+        }
+    }
+
+    bool ScratchBufferArena::Allocate(const VkDeviceSize size, VkDeviceAddress* outAddress) {
+        if (m_CurrentBlock < m_MaxBlocks && AllocateFromBlock(m_CurrentBlock, size, outAddress)) {
+            return true;
+        }
+
+        // The allocation doesn't fit in the current block, the rest of it is wasted for this batch.
+        while (m_CurrentBlock + 1 < m_MaxBlocks) {
+            m_CurrentBlock++;
+            m_CurrentOffset = 0;
+
+            if (AllocateFromBlock(m_CurrentBlock, size, outAddress)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void ScratchBufferArena::Reset() {
+        m_CurrentBlock = 0;
+        m_CurrentOffset = 0;
+    }
+
+    bool ScratchBufferArena::AllocateFromBlock(const usize blockIndex, const VkDeviceSize size,
+                                               VkDeviceAddress* outAddress) {
+        // Blocks past the current one are unused by the batch, they can be created or grown on demand.
+        if (blockIndex >= m_Blocks.size() || (m_CurrentOffset == 0 && m_Blocks[blockIndex].Capacity < size)) {
+            CreateBlock(blockIndex, std::max(m_BlockSize, VulkanUtils::AlignUp(size, m_Alignment)));
+        }
+
+        const Block& block = m_Blocks[blockIndex];
+        if (m_CurrentOffset + size > block.Capacity) {
+            return false;
+        }
+
+        *outAddress = block.Address + m_CurrentOffset;
+
+        m_CurrentOffset += VulkanUtils::AlignUp(size, m_Alignment);
+
+        return true;
+    }
+
+    void ScratchBufferArena::CreateBlock(const usize blockIndex, const VkDeviceSize capacity) {
+        const VmaAllocator allocator = m_Renderer->GetAllocator();
+
+        // Only called on blocks the GPU is done with, see Reset.
+        if (blockIndex < m_Blocks.size()) {
+            VulkanUtils::DestroyBuffer(allocator, m_Blocks[blockIndex].Buffer);
+        } else {
+            m_Blocks.resize(blockIndex + 1);
+        }
+
+        // Over-allocated so that the block start honors the scratch offset alignment.
+        Block& block = m_Blocks[blockIndex];
+        block.Buffer = VulkanUtils::CreateBuffer(allocator, capacity + m_Alignment,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+        block.Address = VulkanUtils::AlignUp(VulkanUtils::GetBufferDeviceAddress(m_Renderer->GetDevice().GetDevice(),
+                                                                                 block.Buffer), m_Alignment);
+        block.Capacity = capacity;
+
+        Log::RtTrace("Created acceleration structure scratch block #{0} ({1} bytes).", blockIndex, capacity);
+    }
+}
@@ -0,0 +1,225 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/UploadService.hpp>
+
+#include <Raytracer/Renderer/VulkanInitializers.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
+
+#include <cstring>
+
+namespace Raytracer::Renderer {
+    namespace {
+        // Covers the buffer offset alignment of buffer to image copies for every format, block compressed included.
+        constexpr VkDeviceSize g_StagingAlignment = 16;
+
+        VkImageMemoryBarrier2 MakeUploadBarrier(const VkImage image, const u32 mipLevels,
+                                                const VkImageLayout oldLayout, const VkImageLayout newLayout) {
+            VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
+            barrier.oldLayout = oldLayout;
+            barrier.newLayout = newLayout;
+            barrier.image = image;
+            barrier.subresourceRange = VulkanInit::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+            barrier.subresourceRange.levelCount = mipLevels;
+
+            return barrier;
+        }
+
+        void RecordBarriers(const VkCommandBuffer commandBuffer,
+                            const std::span<const VkImageMemoryBarrier2> barriers) {
+            if (barriers.empty()) {
+                return;
+            }
+
+            VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            dependencyInfo.imageMemoryBarrierCount = static_cast<u32>(barriers.size());
+            dependencyInfo.pImageMemoryBarriers = barriers.data();
+
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        }
+    }
+
+    UploadService::UploadService(const VulkanWrapper::Device& device, const VmaAllocator allocator,
+                                 const VkDeviceSize stagingRingSize)
+        : m_Device(device), m_Allocator(allocator),
+          m_Queue(device, device.GetTransferQueue(), device.GetTransferQueueFamilyIndex()),
+          m_StagingRingSize(stagingRingSize) {
+        m_StagingRing = VulkanUtils::CreateBuffer(m_Allocator, m_StagingRingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                  VMA_MEMORY_USAGE_CPU_ONLY);
+
+        Log::RtTrace("Upload service created with a {0} MiB staging ring.", m_StagingRingSize >> 20);
+    }
+
+    UploadService::~UploadService() {
+        Flush();
+        m_Queue.Wait(m_Queue.GetLastSubmittedTicket());
+
+        for (const auto& staging : m_DedicatedStagings) {
+            VulkanUtils::DestroyBuffer(m_Allocator, staging.Buffer);
+        }
+
+        VulkanUtils::DestroyBuffer(m_Allocator, m_StagingRing);
+    }
+
+    u64 UploadService::UploadBuffer(const std::span<const std::byte> data, const VkBuffer destination,
+                                    const VkDeviceSize destinationOffset) {
+        if (data.empty()) {
+            return m_Queue.GetLastSubmittedTicket();
+        }
+
+        const StagingAllocation staging = AllocateStaging(data.size());
+        std::memcpy(staging.Data, data.data(), data.size());
+
+        const VkBufferCopy region{staging.Offset, destinationOffset, data.size()};
+        m_PendingBufferCopies.push_back({staging.Buffer, destination, region});
+
+        return GetPendingTicket();
+    }
+
+    u64 UploadService::UploadImage(const std::span<const std::byte> data, const VkImage destination,
+                                   const std::span<const VkBufferImageCopy> regions, const u32 mipLevels,
+                                   const VkImageLayout finalLayout) {
+        const StagingAllocation staging = AllocateStaging(data.size());
+        std::memcpy(staging.Data, data.data(), data.size());
+
+        PendingImageCopy copy{staging.Buffer, destination, {regions.begin(), regions.end()}, mipLevels, finalLayout};
+        for (auto& region : copy.Regions) {
+            region.bufferOffset += staging.Offset;
+        }
+
+        m_PendingImageCopies.push_back(std::move(copy));
+
+        return GetPendingTicket();
+    }
+
+    void UploadService::Flush() {
+        if (m_PendingBufferCopies.empty() && m_PendingImageCopies.empty()) {
+            return;
+        }
+
+        (void)m_Queue.Submit([&](const VkCommandBuffer commandBuffer) {
+            std::vector<VkImageMemoryBarrier2> barriers;
+            barriers.reserve(m_PendingImageCopies.size());
+            for (const auto& copy : m_PendingImageCopies) {
+                barriers.push_back(MakeUploadBarrier(copy.Destination, copy.MipLevels, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+            }
+            RecordBarriers(commandBuffer, barriers);
+
+            for (const auto& copy : m_PendingBufferCopies) {
+                vkCmdCopyBuffer(commandBuffer, copy.Source, copy.Destination, 1, &copy.Region);
+            }
+
+            for (const auto& copy : m_PendingImageCopies) {
+                vkCmdCopyBufferToImage(commandBuffer, copy.Source, copy.Destination,
+                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<u32>(copy.Regions.size()),
+                                       copy.Regions.data());
+            }
+
+            barriers.clear();
+            for (const auto& copy : m_PendingImageCopies) {
+                if (copy.FinalLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+                    barriers.push_back(MakeUploadBarrier(copy.Destination, copy.MipLevels,
+                                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy.FinalLayout));
+                }
+            }
+            RecordBarriers(commandBuffer, barriers);
+        });
+
+        m_PendingBufferCopies.clear();
+        m_PendingImageCopies.clear();
+    }
+
+    bool UploadService::IsComplete(const u64 ticket) const {
+        return ticket <= m_Queue.GetLastSubmittedTicket() && m_Queue.IsComplete(ticket);
+    }
+
+    void UploadService::Wait(const u64 ticket) {
+        if (ticket > m_Queue.GetLastSubmittedTicket()) {
+            Flush();
+        }
+
+        m_Queue.Wait(ticket);
+    }
+
+    u64 UploadService::GetPendingTicket() const {
+        return m_Queue.GetLastSubmittedTicket() + 1;
+    }
+
+    UploadService::StagingAllocation UploadService::AllocateStaging(const VkDeviceSize size) {
+        const VkDeviceSize alignedSize = VulkanUtils::AlignUp(size, g_StagingAlignment);
+
+        if (alignedSize > m_StagingRingSize) {
+            const AllocatedBuffer buffer = VulkanUtils::CreateBuffer(m_Allocator, size,
+                                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                                     VMA_MEMORY_USAGE_CPU_ONLY);
+            m_DedicatedStagings.push_back({buffer, GetPendingTicket()});
+
+            return {buffer.Buffer, 0, static_cast<std::byte*>(buffer.Info.pMappedData)};
+        }
+
+        VkDeviceSize offset;
+        while (!TryAllocateFromRing(alignedSize, offset)) {
+            // The ring is full of data the GPU hasn't read yet, the oldest region has to be submitted and copied.
+            Wait(m_RingRegions.front().Ticket);
+        }
+
+        m_RingRegions.push_back({offset, alignedSize, GetPendingTicket()});
+
+        return {m_StagingRing.Buffer, offset, static_cast<std::byte*>(m_StagingRing.Info.pMappedData) + offset};
+    }
+
+    bool UploadService::TryAllocateFromRing(const VkDeviceSize size, VkDeviceSize& outOffset) {
+        ReleaseCompleted();
+
+        if (m_RingRegions.empty()) {
+            m_RingHead = 0;
+        }
+
+        const VkDeviceSize tail = m_RingRegions.empty() ? 0 : m_RingRegions.front().Offset;
+
+        // The regions in use span [tail, head), the free space is after the head then before the tail.
+        if (m_RingRegions.empty() || m_RingHead > tail) {
+            if (m_RingHead + size <= m_StagingRingSize) {
+                outOffset = m_RingHead;
+                m_RingHead += size;
+                return true;
+            }
+
+            if (size <= tail) {
+                outOffset = 0;
+                m_RingHead = size;
+                return true;
+            }
+
+            return false;
+        }
+
+        // Wrapped around, the regions in use span [tail, end) and [0, head).
+        if (m_RingHead + size <= tail) {
+            outOffset = m_RingHead;
+            m_RingHead += size;
+            return true;
+        }
+
+        return false;
+    }
+
+    void UploadService::ReleaseCompleted() {
+        while (!m_RingRegions.empty() && IsComplete(m_RingRegions.front().Ticket)) {
+            m_RingRegions.pop_front();
+        }
+
+        while (!m_DedicatedStagings.empty() && IsComplete(m_DedicatedStagings.front().Ticket)) {
+            VulkanUtils::DestroyBuffer(m_Allocator, m_DedicatedStagings.front().Buffer);
+            m_DedicatedStagings.pop_front();
+        }
+
+        m_Queue.CollectCompleted();
+    }
+}
@@ -0,0 +1,88 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Renderer/VertexQuantization.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <limits>
+
+namespace Raytracer::Renderer {
+    namespace {
+        i16 ToSnorm16(const f32 value) {
+            return static_cast<i16>(glm::round(glm::clamp(value, -1.f, 1.f) * 32767.f));
+        }
+
+        glm::vec2 EncodeOctahedral(const glm::vec3& normal) {
+            const f32 length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+            if (length == 0.f) {
+                return {0.f, 0.f};
+            }
+
+            const glm::vec3 n = normal / length;
+
+            // The lower hemisphere is folded over the diagonals of the upper one.
+            if (n.z >= 0.f) {
+                return {n.x, n.y};
+            }
+
+            const glm::vec2 signs{n.x >= 0.f ? 1.f : -1.f, n.y >= 0.f ? 1.f : -1.f};
+            return (1.f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+        }
+    }
+
+    glm::mat4 QuantizedMesh::GetDequantizationMatrix() const {
+        glm::mat4 matrix{1.f};
+        matrix[0][0] = DequantizationScale.x;
+        matrix[1][1] = DequantizationScale.y;
+        matrix[2][2] = DequantizationScale.z;
+        matrix[3] = glm::vec4(DequantizationOffset, 1.f);
+
+        return matrix;
+    }
+
+    QuantizedMesh QuantizeVertices(const std::span<const Vertex> vertices) {
+        glm::vec3 boundsMin{std::numeric_limits<f32>::max()};
+        glm::vec3 boundsMax{std::numeric_limits<f32>::lowest()};
+        for (const Vertex& vertex : vertices) {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+
+        QuantizedMesh mesh{};
+        mesh.DequantizationOffset = vertices.empty() ? glm::vec3{0.f} : (boundsMin + boundsMax) * 0.5f;
+        // Flat meshes would otherwise divide by zero on their flat axis.
+        mesh.DequantizationScale = vertices.empty()
+                                       ? glm::vec3{1.f}
+                                       : glm::max((boundsMax - boundsMin) * 0.5f,
+                                                  glm::vec3{std::numeric_limits<f32>::min()});
+
+        mesh.Positions.resize(vertices.size());
+        mesh.Attributes.resize(vertices.size());
+
+        for (usize i = 0; i < vertices.size(); i++) {
+            const Vertex& vertex = vertices[i];
+
+            const glm::vec3 normalized = (vertex.Position - mesh.DequantizationOffset) / mesh.DequantizationScale;
+            mesh.Positions[i] = QuantizedPosition{
+                .X = ToSnorm16(normalized.x),
+                .Y = ToSnorm16(normalized.y),
+                .Z = ToSnorm16(normalized.z),
+                .W = 0
+            };
+
+            const glm::vec2 octahedralNormal = EncodeOctahedral(vertex.Normal);
+            mesh.Attributes[i] = QuantizedAttributes{
+                .NormalX = ToSnorm16(octahedralNormal.x),
+                .NormalY = ToSnorm16(octahedralNormal.y),
+                .UvX = glm::packHalf1x16(vertex.UvX),
+                .UvY = glm::packHalf1x16(vertex.UvY)
+            };
+        }
+
+        return mesh;
+    }
+}
@@ -6,10 +6,10 @@
 
 namespace Raytracer::Renderer {
 #pragma region Descriptor Layout Builder
-    void DescriptorLayoutBuilder::AddBinding(const u32 binding, const VkDescriptorType type) {
+    void DescriptorLayoutBuilder::AddBinding(const u32 binding, const VkDescriptorType type, const u32 count) {
         VkDescriptorSetLayoutBinding newBinding{};
         newBinding.binding = binding;
-        newBinding.descriptorCount = 1;
+        newBinding.descriptorCount = count;
         newBinding.descriptorType = type;
 
         Bindings.push_back(newBinding);
@@ -193,7 +193,8 @@ namespace Raytracer::Renderer {
 
 #pragma region Descriptor Writer
     void DescriptorWriter::WriteImage(const u32 binding, const VkImageView imageView, const VkSampler sampler,
-                                      const VkImageLayout layout, const VkDescriptorType type) {
+                                      const VkImageLayout layout, const VkDescriptorType type,
+                                      const u32 arrayElement) {
         const VkDescriptorImageInfo& info = ImageInfos.emplace_back(VkDescriptorImageInfo{
             .sampler = sampler,
             .imageView = imageView,
@@ -203,6 +204,7 @@ namespace Raytracer::Renderer {
         VkWriteDescriptorSet write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
         write.dstBinding = binding;
         write.dstSet = VK_NULL_HANDLE; // Left empty until we need to write it.
+        write.dstArrayElement = arrayElement;
         write.descriptorCount = 1;
         write.descriptorType = type;
         write.pImageInfo = &info;
@@ -230,11 +232,15 @@ namespace Raytracer::Renderer {
 
     void DescriptorWriter::WriteAccelerationStructure(const u32 binding,
                                                       const VkAccelerationStructureKHR accelerationStructure) {
-        VkWriteDescriptorSetAccelerationStructureKHR descriptorAccelerationStructuresInfo{};
-        descriptorAccelerationStructuresInfo.sType =
-            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+        // Both the handle and the info struct have to outlive this call, they are only read in UpdateSet.
+        const VkAccelerationStructureKHR& handle = AccelerationStructures.emplace_back(accelerationStructure);
+
+        VkWriteDescriptorSetAccelerationStructureKHR& descriptorAccelerationStructuresInfo =
+            AccelerationStructureInfos.emplace_back(VkWriteDescriptorSetAccelerationStructureKHR{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR
+            });
         descriptorAccelerationStructuresInfo.accelerationStructureCount = 1;
-        descriptorAccelerationStructuresInfo.pAccelerationStructures = &accelerationStructure;
+        descriptorAccelerationStructuresInfo.pAccelerationStructures = &handle;
 
         VkWriteDescriptorSet accelerationStructureWrite{};
         accelerationStructureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -251,6 +257,8 @@ namespace Raytracer::Renderer {
         ImageInfos.clear();
         Writes.clear();
         BufferInfos.clear();
+        AccelerationStructureInfos.clear();
+        AccelerationStructures.clear();
     }
 
     void DescriptorWriter::UpdateSet(VkDevice device, VkDescriptorSet set) {
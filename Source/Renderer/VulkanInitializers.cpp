@@ -147,6 +147,15 @@ namespace Raytracer::Renderer::VulkanInit {
         return renderInfo;
     }
 
+    VkRenderingInfo RenderingInfo(const VkExtent2D renderExtent,
+                                  const std::span<const VkRenderingAttachmentInfo> colorAttachments,
+                                  const VkRenderingAttachmentInfo* depthAttachment) {
+        VkRenderingInfo renderInfo = RenderingInfo(renderExtent, colorAttachments.data(), depthAttachment);
+        renderInfo.colorAttachmentCount = static_cast<u32>(colorAttachments.size());
+
+        return renderInfo;
+    }
+
     VkImageSubresourceRange ImageSubresourceRange(const VkImageAspectFlags aspectMask) {
         VkImageSubresourceRange subImage;
         subImage.aspectMask = aspectMask;
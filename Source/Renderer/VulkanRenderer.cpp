@@ -5,6 +5,7 @@
 #include <Raytracer/Renderer/VulkanRenderer.hpp>
 
 #include <Raytracer/Renderer/VulkanInitializers.hpp>
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
 #include <Raytracer/Renderer/VulkanUtils/VulkanImageUtils.hpp>
 #include <Raytracer/Renderer/VulkanUtils/VulkanPipelineUtils.hpp>
 
@@ -15,15 +16,32 @@
 namespace Raytracer::Renderer {
 
     VulkanRenderer::VulkanRenderer(const Window& window, const DebugLevel& debugLevel) {
-        InitializeVulkan(window, debugLevel);
+        m_Instance = std::make_unique<VulkanWrapper::Instance>(window, debugLevel);
+
+        InitializeVulkan();
         InitializeSwapchain(window);
+        // Draw image size will match the window.
+        InitializeDrawImage(window.GetExtent());
         InitializeCommands();
         InitializeSynchronisationPrimitives();
+        InitializeDescriptors();
         InitializeImGui(window);
 
         m_RendererInitialized = true;
     }
 
+    VulkanRenderer::VulkanRenderer(const VkExtent2D extent, const DebugLevel& debugLevel) {
+        m_Instance = std::make_unique<VulkanWrapper::Instance>(debugLevel);
+
+        InitializeVulkan();
+        InitializeDrawImage(extent);
+        InitializeCommands();
+        InitializeSynchronisationPrimitives();
+        InitializeDescriptors();
+
+        m_RendererInitialized = true;
+    }
+
     VulkanRenderer::~VulkanRenderer() {
         if (m_RendererInitialized) {
             vkDeviceWaitIdle(m_Device->GetDevice());
@@ -45,6 +63,13 @@ namespace Raytracer::Renderer {
         m_MainDeletionQueue.PushFunction(std::move(deletor));
     }
 
+    void VulkanRenderer::PlanFrameDeletion(std::function<void()>&& deletor) {
+        // Outside of BeginCommandBuffer/EndCommandBuffer, the last submitted frame is the newest one that can still
+        // reference the resource.
+        const i32 frameNumber = m_FrameRecording ? m_FrameNumber : m_FrameNumber + static_cast<i32>(g_FrameOverlap) - 1;
+        m_Frames[frameNumber % g_FrameOverlap].DeletionQueue.PushFunction(std::move(deletor));
+    }
+
     void VulkanRenderer::BeginUi() {
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -70,21 +95,7 @@ namespace Raytracer::Renderer {
             m_SwapchainResizeRequired = true;
         }
 
-        frame.DeletionQueue.Flush();
-        frame.FrameDescriptors.ClearPools(m_Device->GetDevice());
-
-        const VkCommandBuffer cmd = frame.MainCommandBuffer;
-
-        VK_CHECK(vkResetCommandBuffer(cmd, 0))
-
-        const VkCommandBufferBeginInfo cmdBeginInfo = VulkanInit::CommandBufferBeginInfo(
-            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-        VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo))
-
-        VulkanUtils::TransitionImage(cmd, DrawImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-        return cmd;
+        return BeginFrame(frame);
     }
 
     void VulkanRenderer::EndCommandBuffer(Window& window) {
@@ -94,6 +105,8 @@ namespace Raytracer::Renderer {
         //transition the draw image and the swapchain image into their correct transfer layouts
         VulkanUtils::TransitionImage(cmd, DrawImage.Image, VK_IMAGE_LAYOUT_GENERAL,
                                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        RecordPendingCapture(cmd);
+
         VulkanUtils::TransitionImage(cmd, m_Swapchain->GetImageAtIndex(frame.SwapchainImageIndex),
                                      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
@@ -110,16 +123,12 @@ namespace Raytracer::Renderer {
 
         VK_CHECK(vkEndCommandBuffer(cmd))
 
-        const VkCommandBufferSubmitInfo cmdInfo = VulkanInit::CommandBufferSubmitInfo(cmd);
-
-        const VkSemaphoreSubmitInfo waitInfo = VulkanInit::SemaphoreSubmitInfo(
-            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, frame.SwapchainSemaphore);
+        m_PendingWaitSemaphores.push_back(VulkanInit::SemaphoreSubmitInfo(
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, frame.SwapchainSemaphore));
         const VkSemaphoreSubmitInfo signalInfo = VulkanInit::SemaphoreSubmitInfo(
             VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, frame.RenderSemaphore);
 
-        const VkSubmitInfo2 submit = VulkanInit::SubmitInfo(&cmdInfo, &signalInfo, &waitInfo);
-
-        VK_CHECK(vkQueueSubmit2(m_Device->GetGraphicsQueue(), 1, &submit, frame.RenderFence))
+        SubmitFrame(frame, &signalInfo);
 
         const VkSwapchainKHR swapchain = m_Swapchain->GetSwapchain();
 
@@ -148,6 +157,38 @@ namespace Raytracer::Renderer {
         m_FrameNumber++;
     }
 
+    VkCommandBuffer VulkanRenderer::BeginCommandBuffer() {
+        DrawExtent = {DrawImage.ImageExtent.width, DrawImage.ImageExtent.height};
+
+        auto& frame = GetCurrentFrame();
+
+        // Without swapchain image to acquire, the frame fence alone keeps the CPU at most g_FrameOverlap frames ahead.
+        // Software implementations can take seconds per traced frame, so there is no timeout.
+        VK_CHECK(vkWaitForFences(m_Device->GetDevice(), 1, &frame.RenderFence, true, UINT64_MAX))
+        VK_CHECK(vkResetFences(m_Device->GetDevice(), 1, &frame.RenderFence))
+
+        return BeginFrame(frame);
+    }
+
+    void VulkanRenderer::EndCommandBuffer() {
+        const auto& frame = GetCurrentFrame();
+        const auto cmd = frame.MainCommandBuffer;
+
+        VulkanUtils::TransitionImage(cmd, DrawImage.Image, VK_IMAGE_LAYOUT_GENERAL,
+                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        RecordPendingCapture(cmd);
+
+        VK_CHECK(vkEndCommandBuffer(cmd))
+
+        SubmitFrame(frame, nullptr);
+
+        m_FrameNumber++;
+    }
+
+    void VulkanRenderer::CaptureDrawImage(std::filesystem::path path) {
+        m_PendingCapture = std::move(path);
+    }
+
     void VulkanRenderer::ImmediateSubmit(const std::function<void(VkCommandBuffer commandBuffer)>& function) const {
         VK_CHECK(vkResetFences(m_Device->GetDevice(), 1, &m_ImmediateFence))
         VK_CHECK(vkResetCommandBuffer(m_ImmediateCommandBuffer, 0))
@@ -163,18 +204,129 @@ namespace Raytracer::Renderer {
 
         VK_CHECK(vkEndCommandBuffer(commandBuffer))
 
+        m_UploadService->Flush();
+
         const VkCommandBufferSubmitInfo cmdInfo = VulkanInit::CommandBufferSubmitInfo(commandBuffer);
-        const VkSubmitInfo2 submit = VulkanInit::SubmitInfo(&cmdInfo, nullptr, nullptr);
+        VkSubmitInfo2 submit = VulkanInit::SubmitInfo(&cmdInfo, nullptr, nullptr);
+        submit.waitSemaphoreInfoCount = static_cast<u32>(m_PendingWaitSemaphores.size());
+        submit.pWaitSemaphoreInfos = m_PendingWaitSemaphores.data();
 
         // Submit command buffer to the queue and execute it.
         // m_RenderFence will now block until the graphics command finish executing.
         VK_CHECK(vkQueueSubmit2(m_Device->GetGraphicsQueue(), 1, &submit, m_ImmediateFence))
 
+        m_PendingWaitSemaphores.clear();
+
         VK_CHECK(vkWaitForFences(m_Device->GetDevice(), 1, &m_ImmediateFence, true, 9999999999))
     }
 
-    void VulkanRenderer::InitializeVulkan(const Window& window, const DebugLevel& debugLevel) {
-        m_Instance = std::make_unique<VulkanWrapper::Instance>(window, debugLevel);
+    void VulkanRenderer::WaitOnNextSubmit(const VkSemaphore timelineSemaphore, const u64 value,
+                                          const VkPipelineStageFlags2 stageMask) const {
+        VkSemaphoreSubmitInfo waitInfo = VulkanInit::SemaphoreSubmitInfo(stageMask, timelineSemaphore);
+        waitInfo.value = value;
+
+        m_PendingWaitSemaphores.push_back(waitInfo);
+    }
+
+    void VulkanRenderer::WaitForUpload(const u64 ticket) const {
+        if (ticket == 0 || m_UploadService->IsComplete(ticket)) {
+            return;
+        }
+
+        WaitOnNextSubmit(m_UploadService->GetTimelineSemaphore(), ticket, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+    }
+
+    GPUMeshBuffers VulkanRenderer::UploadMesh(const std::span<const u32> indices,
+                                              const std::span<const Vertex> vertices) const {
+        return UploadMeshStreams(indices, std::as_bytes(vertices), {});
+    }
+
+    GPUMeshBuffers VulkanRenderer::UploadQuantizedMesh(const std::span<const u32> indices,
+                                                       const QuantizedMesh& mesh) const {
+        return UploadMeshStreams(indices, std::as_bytes(std::span(mesh.Attributes)),
+                                 std::as_bytes(std::span(mesh.Positions)));
+    }
+
+    std::vector<GPUMeshBuffers> VulkanRenderer::UploadPackedMeshes(const std::span<const std::byte> packedData,
+                                                                   const std::span<const MeshStreamRange> ranges) const {
+        std::vector<GPUMeshBuffers> meshes;
+        meshes.reserve(ranges.size());
+
+        // The streams are already in their GPU layout, each one is a single copy into the staging ring.
+        for (const MeshStreamRange& range : ranges) {
+            GPUMeshBuffers& mesh = meshes.emplace_back(CreateMeshBuffers(range.VertexSize, range.IndexSize, 0));
+
+            (void)m_UploadService->UploadBuffer(packedData.subspan(range.VertexOffset, range.VertexSize),
+                                                mesh.VertexBuffer.Buffer);
+            mesh.UploadTicket = m_UploadService->UploadBuffer(packedData.subspan(range.IndexOffset, range.IndexSize),
+                                                              mesh.IndexBuffer.Buffer);
+        }
+
+        return meshes;
+    }
+
+    GPUMeshBuffers VulkanRenderer::CreateMeshBuffers(const VkDeviceSize vertexBufferSize,
+                                                     const VkDeviceSize indexBufferSize,
+                                                     const VkDeviceSize positionBufferSize) const {
+        // Both buffers are read by the raster pipeline and as BLAS build inputs, so they need device addresses.
+        constexpr VkBufferUsageFlags accelerationStructureInputUsage =
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+
+        constexpr VkBufferUsageFlags vertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                   accelerationStructureInputUsage;
+
+        GPUMeshBuffers newSurface{};
+        newSurface.VertexBuffer = VulkanUtils::CreateBuffer(m_Allocator, vertexBufferSize, vertexUsage,
+                                                            VMA_MEMORY_USAGE_GPU_ONLY,
+                                                            m_Device->GetSharedQueueFamilyIndices());
+        newSurface.IndexBuffer = VulkanUtils::CreateBuffer(m_Allocator, indexBufferSize,
+                                                           VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                           accelerationStructureInputUsage,
+                                                           VMA_MEMORY_USAGE_GPU_ONLY,
+                                                           m_Device->GetSharedQueueFamilyIndices());
+
+        newSurface.VertexBufferAddress = VulkanUtils::GetBufferDeviceAddress(m_Device->GetDevice(),
+                                                                             newSurface.VertexBuffer);
+        newSurface.IndexBufferAddress = VulkanUtils::GetBufferDeviceAddress(m_Device->GetDevice(),
+                                                                            newSurface.IndexBuffer);
+
+        // Quantized meshes keep their positions in a separate stream, the BLAS build input.
+        if (positionBufferSize != 0) {
+            newSurface.PositionBuffer = VulkanUtils::CreateBuffer(m_Allocator, positionBufferSize, vertexUsage,
+                                                                  VMA_MEMORY_USAGE_GPU_ONLY,
+                                                                  m_Device->GetSharedQueueFamilyIndices());
+            newSurface.PositionBufferAddress = VulkanUtils::GetBufferDeviceAddress(m_Device->GetDevice(),
+                                                                                   newSurface.PositionBuffer);
+        }
+
+        return newSurface;
+    }
+
+    GPUMeshBuffers VulkanRenderer::UploadMeshStreams(const std::span<const u32> indices,
+                                                     const std::span<const std::byte> vertexData,
+                                                     const std::span<const std::byte> positionData) const {
+        const usize vertexBufferSize = vertexData.size();
+        const usize indexBufferSize = indices.size() * sizeof(u32);
+        const usize positionBufferSize = positionData.size();
+
+        GPUMeshBuffers newSurface = CreateMeshBuffers(vertexBufferSize, indexBufferSize, positionBufferSize);
+
+        // Queued on the upload service, meshes uploaded back to back share a single transfer submission.
+        (void)m_UploadService->UploadBuffer(vertexData, newSurface.VertexBuffer.Buffer);
+        newSurface.UploadTicket = m_UploadService->UploadBuffer(std::as_bytes(indices), newSurface.IndexBuffer.Buffer);
+        if (!positionData.empty()) {
+            newSurface.UploadTicket = m_UploadService->UploadBuffer(positionData, newSurface.PositionBuffer.Buffer);
+        }
+
+        return newSurface;
+    }
+
+    void VulkanRenderer::InitializeVulkan() {
         m_Device = std::make_unique<VulkanWrapper::Device>(*m_Instance);
 
         Log::RtTrace("Creating VMA allocator...");
@@ -197,17 +349,40 @@ namespace Raytracer::Renderer {
             Log::RtTrace("Destroying VMA allocator.");
             vmaDestroyAllocator(m_Allocator);
         });
+
+        // Acceleration structure builds run on this queue while the graphics queue keeps presenting.
+        m_ComputeQueue = std::make_unique<AsyncQueue>(*m_Device, m_Device->GetComputeQueue(),
+                                                      m_Device->GetComputeQueueFamilyIndex());
+
+        m_MainDeletionQueue.PushFunction([this]() {
+            m_ComputeQueue.reset();
+        });
+
+        // Uploads go through a persistent staging ring on the transfer queue instead of blocking immediate submits.
+        m_UploadService = std::make_unique<UploadService>(*m_Device, m_Allocator, g_UploadStagingRingSize);
+
+        m_MainDeletionQueue.PushFunction([this]() {
+            m_UploadService.reset();
+        });
+
+        // Destroyed after the frames deletion queues were flushed, so that every recorded capture is encoded.
+        m_FrameReadback = std::make_unique<FrameReadback>(m_Allocator, g_FrameOverlap, g_CaptureEncoderCount);
+
+        m_MainDeletionQueue.PushFunction([this]() {
+            m_FrameReadback.reset();
+        });
     }
 
     void VulkanRenderer::InitializeSwapchain(const Window& window) {
         m_Swapchain = std::make_unique<VulkanWrapper::Swapchain>(window, *m_Instance, *m_Device);
+    }
 
-        // Draw image size will match the window.
-        const VkExtent3D drawImageExtent = {
-            static_cast<u32>(window.GetWidth()), static_cast<u32>(window.GetHeight()), 1
-        };
+    void VulkanRenderer::InitializeDrawImage(const VkExtent2D extent) {
+        const VkExtent3D drawImageExtent = {extent.width, extent.height, 1};
 
-        DrawImage.ImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+        // Written by compute passes, unlike BGRA8 the RGBA8 storage images are supported everywhere. The blit to the
+        // swapchain swizzles the channels.
+        DrawImage.ImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
         DrawImage.ImageExtent = drawImageExtent;
 
         VkImageUsageFlags drawImageUsages{};
@@ -335,6 +510,28 @@ namespace Raytracer::Renderer {
         });
     }
 
+    void VulkanRenderer::InitializeDescriptors() {
+        // Per-frame descriptors are reset at the start of every frame, the ratios cover the scene and compute passes.
+        std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> frameSizes = {
+            {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4}
+        };
+
+        Log::RtTrace("Creating frames descriptor allocators...");
+        for (u32 i = 0; i < g_FrameOverlap; i++) {
+            m_Frames[i].FrameDescriptors.Initialize(m_Device->GetDevice(), 1000, frameSizes);
+        }
+
+        m_MainDeletionQueue.PushFunction([this]() {
+            for (u32 i = 0; i < g_FrameOverlap; i++) {
+                m_Frames[i].FrameDescriptors.DestroyPools(m_Device->GetDevice());
+            }
+        });
+    }
+
     void VulkanRenderer::InitializeImGui(const Window& window) {
         // 1: Create descriptor pool for ImGui
         //    The pool is very oversize, but it's copied from ImGui demo
@@ -405,6 +602,58 @@ namespace Raytracer::Renderer {
         });
     }
 
+    VkCommandBuffer VulkanRenderer::BeginFrame(FrameData& frame) {
+        frame.DeletionQueue.Flush();
+        frame.FrameDescriptors.ClearPools(m_Device->GetDevice());
+
+        const VkCommandBuffer cmd = frame.MainCommandBuffer;
+
+        VK_CHECK(vkResetCommandBuffer(cmd, 0))
+
+        const VkCommandBufferBeginInfo cmdBeginInfo = VulkanInit::CommandBufferBeginInfo(
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+        VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo))
+
+        VulkanUtils::TransitionImage(cmd, DrawImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+        m_FrameRecording = true;
+
+        return cmd;
+    }
+
+    void VulkanRenderer::RecordPendingCapture(const VkCommandBuffer commandBuffer) {
+        if (!m_PendingCapture) {
+            return;
+        }
+
+        const u32 slotIndex = m_FrameReadback->RecordCapture(commandBuffer, DrawImage, DrawExtent,
+                                                             std::move(*m_PendingCapture));
+        m_PendingCapture.reset();
+
+        // The frame deletion queue runs once the frame fence signaled.
+        PlanFrameDeletion([this, slotIndex]() {
+            m_FrameReadback->Encode(slotIndex);
+        });
+    }
+
+    void VulkanRenderer::SubmitFrame(const FrameData& frame, const VkSemaphoreSubmitInfo* signalSemaphoreInfo) {
+        // The pending waits may reference uploads that are still queued.
+        m_UploadService->Flush();
+
+        const VkCommandBufferSubmitInfo cmdInfo = VulkanInit::CommandBufferSubmitInfo(frame.MainCommandBuffer);
+
+        VkSubmitInfo2 submit = VulkanInit::SubmitInfo(&cmdInfo, signalSemaphoreInfo, nullptr);
+        submit.waitSemaphoreInfoCount = static_cast<u32>(m_PendingWaitSemaphores.size());
+        submit.pWaitSemaphoreInfos = m_PendingWaitSemaphores.data();
+
+        VK_CHECK(vkQueueSubmit2(m_Device->GetGraphicsQueue(), 1, &submit, frame.RenderFence))
+
+        m_PendingWaitSemaphores.clear();
+
+        m_FrameRecording = false;
+    }
+
     void VulkanRenderer::DrawImGui(const VkCommandBuffer commandBuffer, const VkImageView targetImageView) const {
         const VkRenderingAttachmentInfo colorAttachmentInfo = VulkanInit::AttachmentInfo(
             targetImageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
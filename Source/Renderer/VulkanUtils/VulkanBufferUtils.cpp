@@ -6,13 +6,19 @@
 
 namespace Raytracer::Renderer::VulkanUtils {
     AllocatedBuffer CreateBuffer(const VmaAllocator allocator, const usize allocSize, const VkBufferUsageFlags usage,
-                                 const VmaMemoryUsage memoryUsage) {
+                                 const VmaMemoryUsage memoryUsage, const std::span<const u32> queueFamilyIndices) {
         // Allocate buffer
         VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, .pNext = nullptr};
         bufferInfo.size = allocSize;
 
         bufferInfo.usage = usage;
 
+        if (queueFamilyIndices.size() > 1) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = static_cast<u32>(queueFamilyIndices.size());
+            bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+        }
+
         VmaAllocationCreateInfo vmaAllocInfo{};
         vmaAllocInfo.usage = memoryUsage;
         vmaAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
@@ -28,4 +34,11 @@ namespace Raytracer::Renderer::VulkanUtils {
     void DestroyBuffer(const VmaAllocator allocator, const AllocatedBuffer& buffer) {
         vmaDestroyBuffer(allocator, buffer.Buffer, buffer.Allocation);
     }
+
+    VkDeviceAddress GetBufferDeviceAddress(const VkDevice device, const AllocatedBuffer& buffer) {
+        VkBufferDeviceAddressInfo addressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+        addressInfo.buffer = buffer.Buffer;
+
+        return vkGetBufferDeviceAddress(device, &addressInfo);
+    }
 }
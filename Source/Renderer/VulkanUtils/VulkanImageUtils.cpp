@@ -74,83 +74,206 @@ namespace Raytracer::Renderer::VulkanUtils {
         vkCmdBlitImage2(commandBuffer, &blitInfo);
     }
 
-    AllocatedImage CreateImage(const VmaAllocator allocator, const VkDevice device, const VkExtent3D size,
-                               const VkFormat format, const VkImageUsageFlags usage, const bool mipmapped) {
-        AllocatedImage newImage;
-        newImage.ImageFormat = format;
-        newImage.ImageExtent = size;
+    namespace {
+        AllocatedImage CreateImageWithLevels(const VmaAllocator allocator, const VkDevice device,
+                                             const VkExtent3D size, const VkFormat format,
+                                             const VkImageUsageFlags usage, const u32 mipLevels,
+                                             const std::span<const u32> queueFamilyIndices,
+                                             const VkComponentMapping& components) {
+            AllocatedImage newImage;
+            newImage.ImageFormat = format;
+            newImage.ImageExtent = size;
+
+            VkImageCreateInfo imageInfo = VulkanInit::ImageCreateInfo(format, usage, size);
+            imageInfo.mipLevels = mipLevels;
+
+            if (queueFamilyIndices.size() > 1) {
+                imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                imageInfo.queueFamilyIndexCount = static_cast<u32>(queueFamilyIndices.size());
+                imageInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+            }
 
-        VkImageCreateInfo imageInfo = VulkanInit::ImageCreateInfo(format, usage, size);
-        if (mipmapped) {
-            imageInfo.mipLevels = static_cast<u32>(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+            // Always allocate images on dedicated GPU memory.
+            VmaAllocationCreateInfo allocationInfo{};
+            allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+            VK_CHECK(
+                vmaCreateImage(allocator, &imageInfo, &allocationInfo, &newImage.Image, &newImage.Allocation, nullptr))
+
+            // If the format is a depth format, we will need to have it use the correct aspect flag.
+            VkImageAspectFlags aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT;
+            if (format == VK_FORMAT_D32_SFLOAT) {
+                aspectFlag = VK_IMAGE_ASPECT_DEPTH_BIT;
+            }
+
+            // Build an image view for the image.
+            VkImageViewCreateInfo imageViewInfo = VulkanInit::ImageViewCreateInfo(format, newImage.Image, aspectFlag);
+            imageViewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+            imageViewInfo.components = components;
+
+            VK_CHECK(vkCreateImageView(device, &imageViewInfo, nullptr, &newImage.ImageView))
+
+            return newImage;
         }
 
-        // Always allocate images on dedicated GPU memory.
-        VmaAllocationCreateInfo allocationInfo{};
-        allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-        allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        u32 GetMipLevelCount(const VkExtent3D size) {
+            return static_cast<u32>(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+        }
+
+        // Writes the regions straight from host memory, nothing is submitted: host writes are visible to every later
+        // queue submission.
+        void CopyMemoryToImage(const VulkanWrapper::Device& device, const VkImage image,
+                               const std::span<const std::byte> data,
+                               const std::span<const VkBufferImageCopy> regions, const VkImageLayout layout) {
+            const vkb::DispatchTable& dispatch = device.GetDispatchTable();
+
+            VkHostImageLayoutTransitionInfoEXT transition{
+                .sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT
+            };
+            transition.image = image;
+            transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            transition.newLayout = layout;
+            transition.subresourceRange = VulkanInit::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+
+            VK_CHECK(dispatch.transitionImageLayoutEXT(1, &transition))
+
+            std::vector<VkMemoryToImageCopyEXT> copies;
+            copies.reserve(regions.size());
+            for (const VkBufferImageCopy& region : regions) {
+                VkMemoryToImageCopyEXT& copy = copies.emplace_back(VkMemoryToImageCopyEXT{
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT
+                });
+                copy.pHostPointer = data.data() + region.bufferOffset;
+                copy.memoryRowLength = region.bufferRowLength;
+                copy.memoryImageHeight = region.bufferImageHeight;
+                copy.imageSubresource = region.imageSubresource;
+                copy.imageOffset = region.imageOffset;
+                copy.imageExtent = region.imageExtent;
+            }
 
-        VK_CHECK(
-            vmaCreateImage(allocator, &imageInfo, &allocationInfo, &newImage.Image, &newImage.Allocation, nullptr))
+            VkCopyMemoryToImageInfoEXT copyInfo{.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT};
+            copyInfo.dstImage = image;
+            copyInfo.dstImageLayout = layout;
+            copyInfo.regionCount = static_cast<u32>(copies.size());
+            copyInfo.pRegions = copies.data();
 
-        // If the format is a depth format, we will need to have it use the correct aspect flag.
-        VkImageAspectFlags aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT;
-        if (format == VK_FORMAT_D32_SFLOAT) {
-            aspectFlag = VK_IMAGE_ASPECT_DEPTH_BIT;
+            VK_CHECK(dispatch.copyMemoryToImageEXT(&copyInfo))
         }
 
-        // Build an image view for the image.
-        VkImageViewCreateInfo imageViewInfo = VulkanInit::ImageViewCreateInfo(format, newImage.Image, aspectFlag);
-        imageViewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+        // Host copy when the image was created for it, upload service otherwise. Returns the upload ticket the next
+        // graphics submission must wait for, 0 for a host copy.
+        u64 UploadImageData(const VulkanRenderer* renderer, const bool hostCopy, const VkImage image,
+                            const std::span<const std::byte> data, const std::span<const VkBufferImageCopy> regions,
+                            const u32 mipLevels, const VkImageLayout layout) {
+            if (hostCopy) {
+                CopyMemoryToImage(renderer->GetDevice(), image, data, regions, layout);
+                return 0;
+            }
 
-        VK_CHECK(vkCreateImageView(device, &imageViewInfo, nullptr, &newImage.ImageView))
+            return renderer->GetUploadService().UploadImage(data, image, regions, mipLevels, layout);
+        }
 
-        return newImage;
+        // Host copies skip the transfer queue, images written by them are only shared with the graphics queue.
+        VkImageUsageFlags GetUploadUsage(const bool hostCopy) {
+            return hostCopy ? VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT : 0;
+        }
+    }
+
+    AllocatedImage CreateImage(const VmaAllocator allocator, const VkDevice device, const VkExtent3D size,
+                               const VkFormat format, const VkImageUsageFlags usage, const bool mipmapped,
+                               const std::span<const u32> queueFamilyIndices) {
+        return CreateImageWithLevels(allocator, device, size, format, usage, mipmapped ? GetMipLevelCount(size) : 1,
+                                     queueFamilyIndices, {});
     }
 
     AllocatedImage CreateImage(const VmaAllocator allocator, const VkDevice device, const VulkanRenderer* renderer,
                                const void* data, const VkExtent3D size, const VkFormat format,
                                const VkImageUsageFlags usage, const bool mipmapped) {
         const std::size_t dataSize = static_cast<std::size_t>(size.depth * size.width * size.height) * 4;
-        const AllocatedBuffer uploadBuffer = CreateBuffer(allocator, dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                          VMA_MEMORY_USAGE_CPU_TO_GPU);
 
-        memcpy(uploadBuffer.Info.pMappedData, data, dataSize);
+        // The mip chain is blitted from the base level on the graphics queue.
+        const VkImageLayout uploadLayout = mipmapped ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                                                     : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        const VulkanWrapper::Device& vulkanDevice = renderer->GetDevice();
+        const bool hostCopy = vulkanDevice.SupportsHostImageCopy(format, uploadLayout);
 
+        // Otherwise written by the transfer queue, sampled by the graphics queue.
         const AllocatedImage newImage = CreateImage(allocator, device, size, format,
                                                     usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                                                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipmapped);
+                                                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | GetUploadUsage(hostCopy),
+                                                    mipmapped,
+                                                    hostCopy ? std::span<const u32>{}
+                                                             : vulkanDevice.GetSharedQueueFamilyIndices());
+
+        VkBufferImageCopy copyRegion{};
+        copyRegion.bufferOffset = 0;
+        copyRegion.bufferRowLength = 0;
+        copyRegion.bufferImageHeight = 0;
+
+        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copyRegion.imageSubresource.mipLevel = 0;
+        copyRegion.imageSubresource.baseArrayLayer = 0;
+        copyRegion.imageSubresource.layerCount = 1;
+        copyRegion.imageExtent = size;
+
+        const u32 mipLevels = mipmapped ? GetMipLevelCount(size) : 1;
+        const u64 uploadTicket = UploadImageData(renderer, hostCopy, newImage.Image,
+                                                 std::span(static_cast<const std::byte*>(data), dataSize),
+                                                 std::span(&copyRegion, 1), mipLevels, uploadLayout);
+
+        // The next graphics submission waits for the copy, the mip chain is blitted there once the base level is in
+        // place.
+        renderer->WaitForUpload(uploadTicket);
 
-        renderer->ImmediateSubmit([&](const VkCommandBuffer commandBuffer) {
-            TransitionImage(commandBuffer, newImage.Image, VK_IMAGE_LAYOUT_UNDEFINED,
-                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        if (mipmapped) {
+            renderer->ImmediateSubmit([&](const VkCommandBuffer commandBuffer) {
+                GenerateMipmaps(commandBuffer, newImage.Image, VkExtent2D{
+                                    newImage.ImageExtent.width, newImage.ImageExtent.height
+                                });
+            });
+        }
+
+        return newImage;
+    }
 
-            VkBufferImageCopy copyRegion{};
-            copyRegion.bufferOffset = 0;
+    AllocatedImage CreateImage(const VmaAllocator allocator, const VkDevice device, const VulkanRenderer* renderer,
+                               const std::span<const std::byte> data, const std::span<const VkDeviceSize> levelOffsets,
+                               const VkExtent3D size, const VkFormat format, const VkImageUsageFlags usage,
+                               const VkComponentMapping& components) {
+        const u32 mipLevels = static_cast<u32>(levelOffsets.size());
+
+        const VulkanWrapper::Device& vulkanDevice = renderer->GetDevice();
+        const bool hostCopy = vulkanDevice.SupportsHostImageCopy(format, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // No blit is involved, the image is never a transfer source.
+        const AllocatedImage newImage = CreateImageWithLevels(allocator, device, size, format,
+                                                              usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                                              GetUploadUsage(hostCopy), mipLevels,
+                                                              hostCopy ? std::span<const u32>{}
+                                                                       : vulkanDevice.GetSharedQueueFamilyIndices(),
+                                                              components);
+
+        std::vector<VkBufferImageCopy> copyRegions(mipLevels);
+        for (u32 level = 0; level < mipLevels; level++) {
+            VkBufferImageCopy& copyRegion = copyRegions[level];
+            copyRegion.bufferOffset = levelOffsets[level];
             copyRegion.bufferRowLength = 0;
             copyRegion.bufferImageHeight = 0;
 
             copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            copyRegion.imageSubresource.mipLevel = 0;
+            copyRegion.imageSubresource.mipLevel = level;
             copyRegion.imageSubresource.baseArrayLayer = 0;
             copyRegion.imageSubresource.layerCount = 1;
-            copyRegion.imageExtent = size;
-
-            // Copy the buffer into the image.
-            vkCmdCopyBufferToImage(commandBuffer, uploadBuffer.Buffer, newImage.Image,
-                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-            if (mipmapped) {
-                GenerateMipmaps(commandBuffer, newImage.Image, VkExtent2D{
-                                    newImage.ImageExtent.width, newImage.ImageExtent.height
-                                });
-            } else {
-                TransitionImage(commandBuffer, newImage.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-            }
-        });
+            // Levels smaller than a block are still copied as a whole block, the extent reaches the level edge.
+            copyRegion.imageExtent = VkExtent3D{
+                std::max(size.width >> level, 1u), std::max(size.height >> level, 1u), 1
+            };
+        }
 
-        DestroyBuffer(allocator, uploadBuffer);
+        const u64 uploadTicket = UploadImageData(renderer, hostCopy, newImage.Image, data, copyRegions, mipLevels,
+                                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        renderer->WaitForUpload(uploadTicket);
 
         return newImage;
     }
@@ -71,6 +71,8 @@ namespace Raytracer::Renderer::VulkanUtils {
         m_RenderInfo = {.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
 
         m_ShaderStages.clear();
+        m_VertexBindings.clear();
+        m_VertexAttributes.clear();
     }
 
     void PipelineBuilder::SetShaders(const VkShaderModule vertexShader, const VkShaderModule fragmentShader) {
@@ -82,6 +84,12 @@ namespace Raytracer::Renderer::VulkanUtils {
             VulkanInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
     }
 
+    void PipelineBuilder::SetVertexInput(const std::span<const VkVertexInputBindingDescription> bindings,
+                                         const std::span<const VkVertexInputAttributeDescription> attributes) {
+        m_VertexBindings.assign(bindings.begin(), bindings.end());
+        m_VertexAttributes.assign(attributes.begin(), attributes.end());
+    }
+
     void PipelineBuilder::SetInputTopology(const VkPrimitiveTopology topology) {
         m_InputAssembly.topology = topology;
         m_InputAssembly.primitiveRestartEnable = VK_FALSE;
@@ -137,7 +145,11 @@ namespace Raytracer::Renderer::VulkanUtils {
     }
 
     void PipelineBuilder::SetColorAttachmentFormat(const VkFormat format) {
-        m_ColorAttachmentFormat = format;
+        m_ColorAttachmentFormats.assign(1, format);
+    }
+
+    void PipelineBuilder::SetColorAttachmentFormats(const std::span<const VkFormat> formats) {
+        m_ColorAttachmentFormats.assign(formats.begin(), formats.end());
     }
 
     void PipelineBuilder::SetDepthFormat(const VkFormat format) {
@@ -188,20 +200,27 @@ namespace Raytracer::Renderer::VulkanUtils {
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlending.pNext = nullptr;
 
+        const std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(m_ColorAttachmentFormats.size(),
+                                                                                   m_ColorBlendAttachment);
+
         colorBlending.logicOpEnable = VK_FALSE;
         colorBlending.logicOp = VK_LOGIC_OP_COPY;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &m_ColorBlendAttachment;
+        colorBlending.attachmentCount = static_cast<u32>(colorBlendAttachments.size());
+        colorBlending.pAttachments = colorBlendAttachments.data();
 
-        // Completely clear VkVertexInputStateCreateInfo, no need for it.
-        constexpr VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
+        // Empty unless SetVertexInput was called, pipelines pulling their vertices from buffers don't need it.
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
         };
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<u32>(m_VertexBindings.size());
+        vertexInputInfo.pVertexBindingDescriptions = m_VertexBindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<u32>(m_VertexAttributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions = m_VertexAttributes.data();
 
         VkGraphicsPipelineCreateInfo pipelineInfo = {.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
 
-        m_RenderInfo.colorAttachmentCount = 1;
-        m_RenderInfo.pColorAttachmentFormats = &m_ColorAttachmentFormat;
+        m_RenderInfo.colorAttachmentCount = static_cast<u32>(m_ColorAttachmentFormats.size());
+        m_RenderInfo.pColorAttachmentFormats = m_ColorAttachmentFormats.data();
         m_RenderInfo.depthAttachmentFormat = m_DepthAttachmentFormat; // For some reason this works.
 
         pipelineInfo.pNext = &m_RenderInfo;
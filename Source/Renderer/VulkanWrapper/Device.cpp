@@ -4,6 +4,9 @@
 
 #include <Raytracer/Renderer/VulkanWrapper/Device.hpp>
 
+#include <algorithm>
+#include <optional>
+
 namespace Raytracer::Renderer::VulkanWrapper {
     Device::Device(const Instance& instance) {
         // Vulkan 1.3 features
@@ -19,26 +22,140 @@ namespace Raytracer::Renderer::VulkanWrapper {
         };
         features12.bufferDeviceAddress = VK_TRUE;
         features12.descriptorIndexing = VK_TRUE;
+        features12.timelineSemaphore = VK_TRUE;
+        // Alpha-tested geometry indexes its opacity texture from the instance hit by a ray.
+        features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+        // Ray query features, the shaders trace against the scene TLAS from the fragment stage.
+        VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructureFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR
+        };
+        accelerationStructureFeatures.accelerationStructure = VK_TRUE;
+
+        VkPhysicalDeviceRayQueryFeaturesKHR rayQueryFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR
+        };
+        rayQueryFeatures.rayQuery = VK_TRUE;
 
         Log::RtTrace("Selecting Vulkan physical device & creating Vulkan logical device...");
         vkb::PhysicalDeviceSelector selector{instance.GetVkbInstance()};
 
+        // Headless instances have no surface to present to, any device with the required features fits, including
+        // software implementations.
+        if (instance.GetSurface() != VK_NULL_HANDLE) {
+            selector.set_surface(instance.GetSurface());
+        }
+
         vkb::PhysicalDevice physicalDevice = selector
                                              .set_minimum_version(1, 3)
                                              .set_required_features_13(features)
                                              .set_required_features_12(features12)
-                                             .set_surface(instance.GetSurface())
+                                             .add_required_extension(
+                                                 VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME)
+                                             .add_required_extension(VK_KHR_RAY_QUERY_EXTENSION_NAME)
+                                             .add_required_extension(
+                                                 VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME)
+                                             .add_required_extension_features(accelerationStructureFeatures)
+                                             .add_required_extension_features(rayQueryFeatures)
                                              .select()
                                              .value();
 
+        // Textures are written straight from host memory when the device supports it, without staging buffer nor
+        // queue submission. The upload service stays the fallback.
+        VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT
+        };
+        hostImageCopyFeatures.hostImageCopy = VK_TRUE;
+
+        m_HostImageCopyEnabled = physicalDevice.enable_extension_if_present(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME) &&
+                                 physicalDevice.enable_extension_features_if_present(hostImageCopyFeatures);
+
+        // Block-compressed textures are sampled straight from their BCn payload. Many mobile and software
+        // implementations lack them, only KTX2 textures need them.
+        VkPhysicalDeviceFeatures features10{};
+        features10.textureCompressionBC = VK_TRUE;
+
+        m_TextureCompressionBCEnabled = physicalDevice.enable_features_if_present(features10);
+        if (!m_TextureCompressionBCEnabled) {
+            Log::RtWarn("The device doesn't support BC textures, KTX2 opacity textures are traced as opaque.");
+        }
+
+        // Acceleration structures are built asynchronously, preferably on a compute-only family, otherwise on a second
+        // queue of the graphics family. One queue is created per family, and two for the graphics family in the latter
+        // case.
+        const std::vector<VkQueueFamilyProperties> queueFamilies = physicalDevice.get_queue_families();
+
+        std::optional<u32> graphicsFamilyIndex;
+        std::optional<u32> computeFamilyIndex;
+        std::optional<u32> transferFamilyIndex;
+        for (u32 i = 0; i < queueFamilies.size(); i++) {
+            const VkQueueFlags flags = queueFamilies[i].queueFlags;
+            const VkExtent3D granularity = queueFamilies[i].minImageTransferGranularity;
+
+            if (!graphicsFamilyIndex && (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                graphicsFamilyIndex = i;
+            }
+
+            if (!computeFamilyIndex && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                computeFamilyIndex = i;
+            }
+
+            // Copy engines with a coarse image granularity can't upload the small mip levels.
+            if (!transferFamilyIndex && (flags & VK_QUEUE_TRANSFER_BIT) &&
+                !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+                granularity.width == 1 && granularity.height == 1 && granularity.depth == 1) {
+                transferFamilyIndex = i;
+            }
+        }
+
+        const bool secondGraphicsQueue = !computeFamilyIndex && queueFamilies[graphicsFamilyIndex.value()].queueCount
+            >= 2;
+
+        std::vector<vkb::CustomQueueDescription> queueDescriptions;
+        for (u32 i = 0; i < queueFamilies.size(); i++) {
+            const usize queueCount = (secondGraphicsQueue && i == graphicsFamilyIndex.value()) ? 2 : 1;
+            queueDescriptions.emplace_back(i, std::vector<f32>(queueCount, 1.f));
+        }
+
         // Create the final Vulkan device.
         vkb::DeviceBuilder deviceBuilder{physicalDevice};
+        deviceBuilder.custom_queue_setup(queueDescriptions);
 
         vkb::Device vkbDevice = deviceBuilder.build().value();
 
         Log::RtTrace("Vulkan physical device selected & logical device created.");
         m_Device = vkbDevice.device;
         m_PhysicalDevice = physicalDevice.physical_device;
+        m_VkbDevice = vkbDevice;
+
+        // Extension entry points (acceleration structures, ...) aren't exported by the loader, fetch them once.
+        m_DispatchTable = vkbDevice.make_table();
+
+        m_AccelerationStructureProperties.sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+        m_IdProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        m_AccelerationStructureProperties.pNext = &m_IdProperties;
+
+        VkPhysicalDeviceProperties2 physicalDeviceProperties2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2
+        };
+        physicalDeviceProperties2.pNext = &m_AccelerationStructureProperties;
+        vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &physicalDeviceProperties2);
+
+        if (m_HostImageCopyEnabled) {
+            // Layouts an image can be in while written by a host copy, queried in two passes.
+            VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT
+            };
+            physicalDeviceProperties2.pNext = &hostImageCopyProperties;
+            vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &physicalDeviceProperties2);
+
+            m_HostImageCopyLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+            hostImageCopyProperties.pCopyDstLayouts = m_HostImageCopyLayouts.data();
+            vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &physicalDeviceProperties2);
+
+            Log::RtTrace("Host image copies enabled, textures are uploaded without staging.");
+        }
 
         VkPhysicalDeviceProperties physicalDeviceProperties;
         vkGetPhysicalDeviceProperties(m_PhysicalDevice, &physicalDeviceProperties);
@@ -82,8 +199,46 @@ namespace Raytracer::Renderer::VulkanWrapper {
 
         m_GraphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
         m_GraphicsQueueFamilyIndex = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
-        m_PresentQueue = vkbDevice.get_queue(vkb::QueueType::present).value();
-        m_PresentQueueFamilyIndex = vkbDevice.get_queue_index(vkb::QueueType::present).value();
+        if (instance.GetSurface() != VK_NULL_HANDLE) {
+            m_PresentQueue = vkbDevice.get_queue(vkb::QueueType::present).value();
+            m_PresentQueueFamilyIndex = vkbDevice.get_queue_index(vkb::QueueType::present).value();
+        }
+
+        if (computeFamilyIndex) {
+            m_ComputeQueueFamilyIndex = computeFamilyIndex.value();
+            vkGetDeviceQueue(m_Device, m_ComputeQueueFamilyIndex, 0, &m_ComputeQueue);
+
+            Log::RtTrace("Using dedicated compute queue family #{0} for asynchronous work.", m_ComputeQueueFamilyIndex);
+        } else {
+            m_ComputeQueueFamilyIndex = m_GraphicsQueueFamilyIndex;
+            vkGetDeviceQueue(m_Device, m_ComputeQueueFamilyIndex, secondGraphicsQueue ? 1 : 0, &m_ComputeQueue);
+
+            if (secondGraphicsQueue) {
+                Log::RtTrace("No compute-only queue family, using a second graphics queue for asynchronous work.");
+            } else {
+                Log::RtWarn("No secondary queue available, asynchronous work shares the graphics queue.");
+            }
+        }
+
+        if (transferFamilyIndex) {
+            m_TransferQueueFamilyIndex = transferFamilyIndex.value();
+            vkGetDeviceQueue(m_Device, m_TransferQueueFamilyIndex, 0, &m_TransferQueue);
+
+            Log::RtTrace("Using dedicated transfer queue family #{0} for uploads.", m_TransferQueueFamilyIndex);
+        } else {
+            m_TransferQueue = m_ComputeQueue;
+            m_TransferQueueFamilyIndex = m_ComputeQueueFamilyIndex;
+
+            Log::RtTrace("No transfer-only queue family, uploads go through the asynchronous compute queue.");
+        }
+
+        // Resources touched by several queues are shared concurrently between their families.
+        m_SharedQueueFamilyIndices.push_back(m_GraphicsQueueFamilyIndex);
+        for (const u32 familyIndex : {m_ComputeQueueFamilyIndex, m_TransferQueueFamilyIndex}) {
+            if (std::ranges::find(m_SharedQueueFamilyIndices, familyIndex) == m_SharedQueueFamilyIndices.end()) {
+                m_SharedQueueFamilyIndices.push_back(familyIndex);
+            }
+        }
 
         m_DeletionQueue.PushFunction([this]() {
             Log::RtTrace("Destroying Vulkan device.");
@@ -93,6 +248,20 @@ namespace Raytracer::Renderer::VulkanWrapper {
         m_Initialized = true;
     }
 
+    bool Device::SupportsHostImageCopy(const VkFormat format, const VkImageLayout layout) const {
+        if (!m_HostImageCopyEnabled ||
+            std::ranges::find(m_HostImageCopyLayouts, layout) == m_HostImageCopyLayouts.end()) {
+            return false;
+        }
+
+        VkFormatProperties3 formatProperties3 = {.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3};
+        VkFormatProperties2 formatProperties2 = {.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2};
+        formatProperties2.pNext = &formatProperties3;
+        vkGetPhysicalDeviceFormatProperties2(m_PhysicalDevice, format, &formatProperties2);
+
+        return (formatProperties3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT) != 0;
+    }
+
     Device::~Device() {
         if (m_Initialized) {
             m_DeletionQueue.Flush();
@@ -64,9 +64,6 @@ namespace Raytracer::Renderer::VulkanWrapper {
     }
     
     Instance::Instance(const Window& window, const DebugLevel& debugLevel) {
-        Log::RtTrace("Creating Vulkan instance & debug messenger...");
-        vkb::InstanceBuilder builder;
-
         u32 extensionCount = 0;
         glfwGetRequiredInstanceExtensions(&extensionCount);
         const char** extensions = glfwGetRequiredInstanceExtensions(&extensionCount);
@@ -76,10 +73,38 @@ namespace Raytracer::Renderer::VulkanWrapper {
             Log::RtTrace("\t - {0}", extensions[i]);
         }
 
-        builder.set_app_name(window.GetTitle().c_str())
+        CreateInstance(window.GetTitle(), debugLevel, false);
+
+        Log::RtTrace("Creating Vulkan window surface...");
+        glfwCreateWindowSurface(m_Instance, window.GetNativeWindow(), nullptr, &m_Surface);
+        Log::RtTrace("Vulkan window surface created.");
+
+        m_DeletionQueue.PushFunction([this]() {
+            Log::RtTrace("Destroying Vulkan surface.");
+            vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        });
+
+        m_Initialized = true;
+    }
+
+    Instance::Instance(const DebugLevel& debugLevel) {
+        CreateInstance("Raytracer", debugLevel, true);
+
+        m_Initialized = true;
+    }
+
+    void Instance::CreateInstance(const std::string& applicationName, const DebugLevel& debugLevel,
+                                  const bool headless) {
+        Log::RtTrace("Creating Vulkan instance & debug messenger...");
+        vkb::InstanceBuilder builder;
+
+        // Headless instances don't enable the surface extensions, which the window system of a compute node may not
+        // provide.
+        builder.set_app_name(applicationName.c_str())
                .set_app_version(0, 1, 0)
                .set_engine_name("Raytracer")
                .set_engine_version(0, 1, 0)
+               .set_headless(headless)
                .request_validation_layers(debugLevel > DebugLevel::None)
                .require_api_version(1, 3, 0);
 
@@ -109,7 +134,8 @@ namespace Raytracer::Renderer::VulkanWrapper {
                .add_debug_messenger_type(messageType)
                .set_debug_callback(DebugCallback);
 
-        if (debugLevel > DebugLevel::None) {
+        // The monitor layer shows the frame rate in the window title.
+        if (debugLevel > DebugLevel::None && !headless) {
             builder.enable_layer("VK_LAYER_LUNARG_monitor");
         }
 
@@ -128,18 +154,6 @@ namespace Raytracer::Renderer::VulkanWrapper {
             Log::RtTrace("Destroying Vulkan instance.");
             vkDestroyInstance(m_Instance, nullptr);
         });
-
-        
-        Log::RtTrace("Creating Vulkan window surface...");
-        glfwCreateWindowSurface(m_Instance, window.GetNativeWindow(), nullptr, &m_Surface);
-        Log::RtTrace("Vulkan window surface created.");
-
-        m_DeletionQueue.PushFunction([this]() {
-            Log::RtTrace("Destroying Vulkan surface.");
-            vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
-        });
-
-        m_Initialized = true;
     }
 
     Instance::~Instance() {
@@ -0,0 +1,194 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/CookedScene.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+
+#include <Raytracer/Renderer/VulkanUtils/VulkanBufferUtils.hpp>
+
+#include <Raytracer/Scene/MeshHash.hpp>
+
+#include <fstream>
+
+namespace Raytracer::Scene {
+    namespace {
+        constexpr u32 g_AllInstanceLayers = 0xFF;
+
+        // Tables are read in place from the mapping, their layout must not depend on the compiler padding.
+        static_assert(sizeof(CookedSceneHeader) == 56);
+        static_assert(sizeof(CookedMesh) == 40);
+        static_assert(sizeof(CookedMaterial) == 8);
+        static_assert(sizeof(CookedInstance) == 80);
+
+        void WritePadding(std::ofstream& file, const u64 alignment) {
+            constexpr char zeros[g_CookedSceneAlignment]{};
+
+            const u64 position = static_cast<u64>(file.tellp());
+            const u64 padding = Renderer::VulkanUtils::AlignUp(position, alignment) - position;
+            file.write(zeros, static_cast<std::streamsize>(padding));
+        }
+
+        template <typename T>
+        void WriteTable(std::ofstream& file, const std::span<const T> table) {
+            file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size_bytes()));
+            WritePadding(file, g_CookedSceneAlignment);
+        }
+
+        template <typename T>
+        bool ResolveTable(const std::span<const std::byte> data, const u64 offset, const u64 count,
+                          std::span<const T>& outTable) {
+            if (offset % alignof(T) != 0 || offset > data.size() || count > (data.size() - offset) / sizeof(T)) {
+                return false;
+            }
+
+            outTable = {reinterpret_cast<const T*>(data.data() + offset), count};
+            return true;
+        }
+    }
+
+    bool CookScene(const SceneDescription& scene, const std::filesystem::path& path) {
+        const u32 meshCount = static_cast<u32>(scene.Meshes.size());
+        const u32 instanceCount = static_cast<u32>(scene.Placements.size());
+
+        // Lay the tables and the streams out first, the header needs every offset.
+        std::vector<CookedMesh> meshes(meshCount);
+        u64 geometrySize = 0;
+        for (u32 i = 0; i < meshCount; i++) {
+            const auto& mesh = scene.Meshes[i];
+
+            meshes[i].VertexOffset = geometrySize;
+            geometrySize = Renderer::VulkanUtils::AlignUp(geometrySize + mesh.Vertices.size_bytes(),
+                                                          g_CookedSceneAlignment);
+            meshes[i].IndexOffset = geometrySize;
+            geometrySize = Renderer::VulkanUtils::AlignUp(geometrySize + mesh.Indices.size() * sizeof(u32),
+                                                          g_CookedSceneAlignment);
+
+            meshes[i].VertexCount = static_cast<u32>(mesh.Vertices.size());
+            meshes[i].IndexCount = static_cast<u32>(mesh.Indices.size());
+            meshes[i].ContentHash = HashMeshContent(mesh.Vertices, mesh.Indices);
+            meshes[i].PositionHash = HashMeshPositions(mesh.Vertices, mesh.Indices);
+        }
+
+        if (!scene.Textures.empty()) {
+            Log::RtWarn("Opacity textures are not cooked, the alpha-masked meshes of {0} are traced as opaque.",
+                        path.string());
+        }
+
+        const std::vector<CookedMaterial> materials(meshCount, CookedMaterial{~0u, 0.5f});
+
+        std::vector<CookedInstance> instances(instanceCount);
+        for (u32 i = 0; i < instanceCount; i++) {
+            instances[i].Transform = scene.Placements[i].Transform;
+            instances[i].MeshIndex = scene.Placements[i].MeshIndex;
+            instances[i].Layers = g_AllInstanceLayers;
+        }
+
+        const auto alignedSize = [](const u64 size) {
+            return Renderer::VulkanUtils::AlignUp(size, g_CookedSceneAlignment);
+        };
+
+        CookedSceneHeader header{};
+        header.Magic = g_CookedSceneMagic;
+        header.Version = g_CookedSceneVersion;
+        header.MeshCount = meshCount;
+        header.InstanceCount = instanceCount;
+        header.MeshTableOffset = alignedSize(sizeof(CookedSceneHeader));
+        header.MaterialTableOffset = header.MeshTableOffset + alignedSize(meshCount * sizeof(CookedMesh));
+        header.InstanceTableOffset = header.MaterialTableOffset + alignedSize(meshCount * sizeof(CookedMaterial));
+        header.GeometryOffset = header.InstanceTableOffset + alignedSize(instanceCount * sizeof(CookedInstance));
+        header.GeometrySize = geometrySize;
+
+        // Written next to the target then renamed, like the BLAS cache entries.
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            Log::RtError("Failed to open {0} for writing.", temporaryPath.string());
+            return false;
+        }
+
+        WriteTable(file, std::span<const CookedSceneHeader>(&header, 1));
+        WriteTable(file, std::span<const CookedMesh>(meshes));
+        WriteTable(file, std::span<const CookedMaterial>(materials));
+        WriteTable(file, std::span<const CookedInstance>(instances));
+
+        for (const auto& mesh : scene.Meshes) {
+            WriteTable(file, std::span<const Renderer::Vertex>(mesh.Vertices));
+            WriteTable(file, std::span<const u32>(mesh.Indices));
+        }
+
+        const bool written = file.good();
+        file.close();
+
+        std::error_code error;
+        if (written) {
+            std::filesystem::rename(temporaryPath, path, error);
+        }
+
+        if (!written || error) {
+            Log::RtError("Failed to write cooked scene {0}.", path.string());
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    CookedScene::CookedScene(const std::filesystem::path& path) : m_File(path) {
+        if (!m_File.IsOpen()) {
+            return;
+        }
+
+        const auto data = m_File.GetData();
+
+        std::span<const CookedSceneHeader> header;
+        if (!ResolveTable(data, 0, 1, header) || header[0].Magic != g_CookedSceneMagic) {
+            Log::RtError("{0} is not a cooked scene.", path.string());
+            return;
+        }
+
+        if (header[0].Version != g_CookedSceneVersion) {
+            Log::RtError("{0} was cooked with another version, cook it again.", path.string());
+            return;
+        }
+
+        const bool tablesValid =
+            ResolveTable(data, header[0].MeshTableOffset, header[0].MeshCount, m_Meshes) &&
+            ResolveTable(data, header[0].MaterialTableOffset, header[0].MeshCount, m_Materials) &&
+            ResolveTable(data, header[0].InstanceTableOffset, header[0].InstanceCount, m_Instances) &&
+            header[0].GeometryOffset <= data.size() && header[0].GeometrySize <= data.size() - header[0].GeometryOffset;
+
+        if (!tablesValid) {
+            Log::RtError("Truncated cooked scene {0}.", path.string());
+            return;
+        }
+
+        m_Geometry = data.subspan(header[0].GeometryOffset, header[0].GeometrySize);
+
+        // Only the bounds are checked, so that a corrupted file can't make the uploads read past the mapping.
+        for (const auto& mesh : m_Meshes) {
+            const bool streamsValid =
+                mesh.VertexOffset <= m_Geometry.size() &&
+                mesh.VertexCount <= (m_Geometry.size() - mesh.VertexOffset) / sizeof(Renderer::Vertex) &&
+                mesh.IndexOffset <= m_Geometry.size() &&
+                mesh.IndexCount <= (m_Geometry.size() - mesh.IndexOffset) / sizeof(u32);
+
+            if (!streamsValid) {
+                Log::RtError("Truncated cooked scene {0}.", path.string());
+                return;
+            }
+        }
+
+        for (const auto& instance : m_Instances) {
+            if (instance.MeshIndex >= m_Meshes.size()) {
+                Log::RtError("Cooked scene {0} references a missing mesh.", path.string());
+                return;
+            }
+        }
+
+        m_Valid = true;
+    }
+}
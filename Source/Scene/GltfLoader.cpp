@@ -0,0 +1,769 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/GltfLoader.hpp>
+
+#include <Raytracer/Core/ImageReader.hpp>
+#include <Raytracer/Core/Logger.hpp>
+#include <Raytracer/Core/MappedFile.hpp>
+#include <Raytracer/Core/Parallel.hpp>
+
+#include <Raytracer/Scene/Ktx2Loader.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace Raytracer::Scene {
+    namespace {
+        using Json = nlohmann::json;
+
+        constexpr u32 g_GlbMagic = 0x46546C67; // "glTF"
+        constexpr u32 g_GlbJsonChunk = 0x4E4F534A; // "JSON"
+        constexpr u32 g_GlbBinaryChunk = 0x004E4942; // "BIN\0"
+
+        constexpr u32 g_TrianglesMode = 4;
+
+        namespace ComponentType {
+            constexpr u32 Byte = 5120;
+            constexpr u32 UnsignedByte = 5121;
+            constexpr u32 Short = 5122;
+            constexpr u32 UnsignedShort = 5123;
+            constexpr u32 UnsignedInt = 5125;
+            constexpr u32 Float = 5126;
+        }
+
+        // Raw view over the elements of an accessor, resolved up front so that the decode jobs never touch the JSON.
+        struct AccessorView {
+            const std::byte* Data = nullptr;
+            usize Count = 0;
+            usize Stride = 0;
+            u32 ComponentType = 0;
+            u32 ComponentCount = 0;
+            bool Normalized = false;
+        };
+
+        struct PrimitiveSource {
+            std::string Name;
+            AccessorView Positions;
+            AccessorView Normals;
+            AccessorView TexCoords;
+            AccessorView Indices;
+            std::optional<usize> Material;
+        };
+
+        // Encoded bytes of an image used as an opacity texture, empty when they could not be resolved. A prebuilt
+        // KTX2 file is loaded instead when there is one.
+        struct ImageSource {
+            std::string Name;
+            std::span<const std::byte> Encoded;
+            std::filesystem::path Ktx2Path;
+        };
+
+        // Keeps the external buffers alive until every primitive is decoded.
+        struct BufferStorage {
+            std::vector<std::unique_ptr<MappedFile>> MappedFiles;
+            std::vector<std::vector<std::byte>> DecodedUris;
+            std::vector<std::span<const std::byte>> Buffers;
+        };
+
+        u32 GetComponentSize(const u32 componentType) {
+            switch (componentType) {
+                case ComponentType::Byte:
+                case ComponentType::UnsignedByte:
+                    return 1;
+                case ComponentType::Short:
+                case ComponentType::UnsignedShort:
+                    return 2;
+                case ComponentType::UnsignedInt:
+                case ComponentType::Float:
+                    return 4;
+                default:
+                    return 0;
+            }
+        }
+
+        u32 GetComponentCount(const std::string_view type) {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2") return 2;
+            if (type == "VEC3") return 3;
+            if (type == "VEC4") return 4;
+            if (type == "MAT2") return 4;
+            if (type == "MAT3") return 9;
+            if (type == "MAT4") return 16;
+            return 0;
+        }
+
+        template <typename T>
+        T ReadUnaligned(const std::byte* data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        f32 ReadComponent(const std::byte* data, const u32 componentType, const bool normalized) {
+            switch (componentType) {
+                case ComponentType::Float:
+                    return ReadUnaligned<f32>(data);
+                case ComponentType::UnsignedByte: {
+                    const f32 value = ReadUnaligned<u8>(data);
+                    return normalized ? value / 255.f : value;
+                }
+                case ComponentType::Byte: {
+                    const f32 value = ReadUnaligned<i8>(data);
+                    return normalized ? std::max(value / 127.f, -1.f) : value;
+                }
+                case ComponentType::UnsignedShort: {
+                    const f32 value = ReadUnaligned<u16>(data);
+                    return normalized ? value / 65535.f : value;
+                }
+                case ComponentType::Short: {
+                    const f32 value = ReadUnaligned<i16>(data);
+                    return normalized ? std::max(value / 32767.f, -1.f) : value;
+                }
+                case ComponentType::UnsignedInt:
+                    return static_cast<f32>(ReadUnaligned<u32>(data));
+                default:
+                    return 0.f;
+            }
+        }
+
+        u32 ReadIndex(const std::byte* data, const u32 componentType) {
+            switch (componentType) {
+                case ComponentType::UnsignedByte:
+                    return ReadUnaligned<u8>(data);
+                case ComponentType::UnsignedShort:
+                    return ReadUnaligned<u16>(data);
+                default:
+                    return ReadUnaligned<u32>(data);
+            }
+        }
+
+        bool DecodeBase64(const std::string_view text, std::vector<std::byte>& outBytes) {
+            constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            constexpr auto table = [alphabet] {
+                std::array<u8, 256> result{};
+                result.fill(0xFF);
+                for (usize i = 0; i < alphabet.size(); i++) {
+                    result[static_cast<u8>(alphabet[i])] = static_cast<u8>(i);
+                }
+                return result;
+            }();
+
+            outBytes.clear();
+            outBytes.reserve(text.size() / 4 * 3);
+
+            u32 accumulator = 0;
+            u32 bitCount = 0;
+            for (const char character : text) {
+                if (character == '=') {
+                    break;
+                }
+
+                const u8 value = table[static_cast<u8>(character)];
+                if (value == 0xFF) {
+                    return false;
+                }
+
+                accumulator = (accumulator << 6) | value;
+                bitCount += 6;
+                if (bitCount >= 8) {
+                    bitCount -= 8;
+                    outBytes.push_back(static_cast<std::byte>((accumulator >> bitCount) & 0xFF));
+                }
+            }
+
+            return true;
+        }
+
+        // URIs are relative to the .gltf and may be percent-encoded, the usual "%20" is the only case handled.
+        std::filesystem::path GetUriPath(const std::filesystem::path& directory, const std::string& uri) {
+            std::string relativePath = uri;
+            for (usize position = relativePath.find("%20"); position != std::string::npos;
+                 position = relativePath.find("%20", position)) {
+                relativePath.replace(position, 3, " ");
+            }
+
+            return directory / std::u8string(relativePath.begin(), relativePath.end());
+        }
+
+        // Base64 data URIs are decoded into the storage, files are mapped.
+        bool ResolveUri(const std::string& uri, const std::filesystem::path& directory, BufferStorage& storage,
+                        std::span<const std::byte>& outData) {
+            if (uri.starts_with("data:")) {
+                const usize separator = uri.find(";base64,");
+                if (separator == std::string::npos) {
+                    Log::RtError("Unsupported glTF data URI, only base64 is handled.");
+                    return false;
+                }
+
+                auto& bytes = storage.DecodedUris.emplace_back();
+                const auto payload = std::string_view(uri).substr(separator + 8);
+                if (!DecodeBase64(payload, bytes)) {
+                    Log::RtError("Malformed glTF data URI.");
+                    return false;
+                }
+                outData = bytes;
+                return true;
+            }
+
+            const auto& file = storage.MappedFiles.emplace_back(
+                std::make_unique<MappedFile>(GetUriPath(directory, uri)));
+            if (!file->IsOpen()) {
+                Log::RtError("Failed to map glTF file {0}.", uri);
+                return false;
+            }
+            outData = file->GetData();
+            return true;
+        }
+
+        bool ResolveBuffers(const Json& document, const std::filesystem::path& directory,
+                            const std::span<const std::byte> glbBinaryChunk, BufferStorage& storage) {
+            if (!document.contains("buffers")) {
+                return true;
+            }
+
+            for (const Json& buffer : document["buffers"]) {
+                const usize byteLength = buffer.value("byteLength", usize{0});
+
+                if (!buffer.contains("uri")) {
+                    // Only the first buffer of a .glb may omit its URI, it is the binary chunk.
+                    if (glbBinaryChunk.size() < byteLength) {
+                        Log::RtError("glTF buffer without URI does not fit the binary chunk.");
+                        return false;
+                    }
+                    storage.Buffers.push_back(glbBinaryChunk.first(byteLength));
+                    continue;
+                }
+
+                const auto uri = buffer["uri"].get<std::string>();
+                std::span<const std::byte> data;
+                if (!ResolveUri(uri, directory, storage, data)) {
+                    return false;
+                }
+                if (data.size() < byteLength) {
+                    Log::RtError("glTF buffer is shorter than its byte length.");
+                    return false;
+                }
+                storage.Buffers.push_back(data.first(byteLength));
+            }
+
+            return true;
+        }
+
+        // Images are never required to render the scene, the materials using one that can't be read become opaque.
+        void ResolveImage(const Json& document, const std::filesystem::path& directory, BufferStorage& storage,
+                          const usize imageIndex, const std::optional<usize> ktx2ImageIndex, ImageSource& outSource) {
+            const Json& images = document.at("images");
+            const Json& image = images.at(imageIndex);
+            outSource.Name = image.value("name", std::format("#{0}", imageIndex));
+
+            // Only KTX2 files can be loaded, embedded ones go through the regular image.
+            if (ktx2ImageIndex) {
+                const auto uri = images.at(*ktx2ImageIndex).value("uri", std::string{});
+                if (!uri.empty() && !uri.starts_with("data:")) {
+                    outSource.Ktx2Path = GetUriPath(directory, uri);
+                }
+            }
+
+            if (image.contains("uri")) {
+                const auto uri = image["uri"].get<std::string>();
+                if (!uri.starts_with("data:")) {
+                    const std::filesystem::path path = GetUriPath(directory, uri);
+                    if (path.extension() == ".ktx2") {
+                        outSource.Ktx2Path = path;
+                        return;
+                    }
+
+                    // Textures compressed offline are stored next to their source image, under the same name.
+                    std::filesystem::path siblingPath = path;
+                    siblingPath.replace_extension(".ktx2");
+                    if (outSource.Ktx2Path.empty() && std::filesystem::exists(siblingPath)) {
+                        outSource.Ktx2Path = siblingPath;
+                    }
+                }
+
+                // The bytes stay empty on failure.
+                ResolveUri(uri, directory, storage, outSource.Encoded);
+                return;
+            }
+
+            if (!image.contains("bufferView")) {
+                Log::RtWarn("glTF image {0} has neither URI nor buffer view.", outSource.Name);
+                return;
+            }
+
+            const Json& bufferView = document.at("bufferViews").at(image["bufferView"].get<usize>());
+            const usize bufferIndex = bufferView.value("buffer", usize{0});
+            const usize viewOffset = bufferView.value("byteOffset", usize{0});
+            const usize viewLength = bufferView.value("byteLength", usize{0});
+            if (bufferIndex >= storage.Buffers.size() ||
+                viewOffset + viewLength > storage.Buffers[bufferIndex].size()) {
+                Log::RtWarn("glTF image {0} reads past the end of its buffer.", outSource.Name);
+                return;
+            }
+
+            outSource.Encoded = storage.Buffers[bufferIndex].subspan(viewOffset, viewLength);
+        }
+
+        // Only alpha-masked materials matter to the renderer, the alpha of their base color is the opacity. Blended
+        // materials are traced as opaque.
+        void GatherMaterials(const Json& document, const std::filesystem::path& directory, BufferStorage& storage,
+                             std::vector<MaterialData>& outMaterials, std::vector<ImageSource>& outImages) {
+            if (!document.contains("materials")) {
+                return;
+            }
+
+            // Images shared by several materials are decoded once.
+            std::unordered_map<usize, u32> imageTextures;
+
+            for (const Json& material : document["materials"]) {
+                MaterialData& materialData = outMaterials.emplace_back();
+                if (material.value("alphaMode", std::string{"OPAQUE"}) != "MASK") {
+                    continue;
+                }
+
+                // Without a texture the mask is uniform, the base color factor alone can't cut out any texel.
+                const Json& pbr = material.value("pbrMetallicRoughness", Json::object());
+                if (!pbr.contains("baseColorTexture")) {
+                    continue;
+                }
+
+                const Json& textureInfo = pbr["baseColorTexture"];
+                if (textureInfo.value("texCoord", 0u) != 0) {
+                    Log::RtWarn("glTF material {0} reads its opacity from another UV set than TEXCOORD_0.",
+                                material.value("name", std::string{}));
+                }
+
+                const Json& texture = document.at("textures").at(textureInfo.at("index").get<usize>());
+
+                // KHR_texture_basisu points to a KTX2 image, the source becomes the fallback.
+                std::optional<usize> ktx2ImageIndex;
+                if (const Json& extensions = texture.value("extensions", Json::object());
+                    extensions.contains("KHR_texture_basisu")) {
+                    ktx2ImageIndex = extensions["KHR_texture_basisu"].at("source").get<usize>();
+                }
+                if (!texture.contains("source") && !ktx2ImageIndex) {
+                    continue;
+                }
+
+                const usize imageIndex = texture.contains("source") ? texture["source"].get<usize>() : *ktx2ImageIndex;
+                const auto [it, inserted] = imageTextures.try_emplace(imageIndex, static_cast<u32>(outImages.size()));
+                if (inserted) {
+                    ResolveImage(document, directory, storage, imageIndex, ktx2ImageIndex, outImages.emplace_back());
+                }
+
+                materialData.OpacityTexture = it->second;
+                materialData.AlphaCutoff = material.value("alphaCutoff", 0.5f);
+            }
+        }
+
+        bool DecodeImage(const ImageSource& source, TextureData& outTexture) {
+            // Prebuilt BCn textures keep their mips. Supercompressed KTX2 are rejected and fall back to the image.
+            if (!source.Ktx2Path.empty() && LoadKtx2(source.Ktx2Path, outTexture)) {
+                return true;
+            }
+
+            if (source.Encoded.empty()) {
+                return false;
+            }
+
+            if (!ReadImage(source.Encoded, outTexture.Width, outTexture.Height, outTexture.Data)) {
+                Log::RtWarn("Failed to decode glTF image {0}, the materials using it are traced as opaque.",
+                            source.Name);
+                return false;
+            }
+
+            outTexture.Format = VK_FORMAT_R8G8B8A8_UNORM;
+            outTexture.LevelOffsets = {0};
+            return true;
+        }
+
+        bool ResolveAccessor(const Json& document, const BufferStorage& storage, const usize accessorIndex,
+                             AccessorView& outView) {
+            const Json& accessors = document.at("accessors");
+            if (accessorIndex >= accessors.size()) {
+                Log::RtError("glTF accessor {0} is out of range.", accessorIndex);
+                return false;
+            }
+
+            const Json& accessor = accessors[accessorIndex];
+            if (accessor.contains("sparse")) {
+                Log::RtError("Sparse glTF accessors are not supported.");
+                return false;
+            }
+            if (!accessor.contains("bufferView")) {
+                Log::RtError("glTF accessors without buffer view are not supported.");
+                return false;
+            }
+
+            outView.Count = accessor.value("count", usize{0});
+            outView.ComponentType = accessor.value("componentType", 0u);
+            outView.ComponentCount = GetComponentCount(accessor.value("type", std::string{}));
+            outView.Normalized = accessor.value("normalized", false);
+
+            const u32 componentSize = GetComponentSize(outView.ComponentType);
+            const usize elementSize = static_cast<usize>(componentSize) * outView.ComponentCount;
+            if (elementSize == 0) {
+                Log::RtError("glTF accessor {0} has an invalid type.", accessorIndex);
+                return false;
+            }
+
+            const Json& bufferView = document.at("bufferViews").at(accessor["bufferView"].get<usize>());
+            const usize bufferIndex = bufferView.value("buffer", usize{0});
+            if (bufferIndex >= storage.Buffers.size()) {
+                Log::RtError("glTF buffer {0} is out of range.", bufferIndex);
+                return false;
+            }
+
+            const usize viewOffset = bufferView.value("byteOffset", usize{0});
+            const usize viewLength = bufferView.value("byteLength", usize{0});
+            const usize accessorOffset = accessor.value("byteOffset", usize{0});
+            outView.Stride = bufferView.value("byteStride", elementSize);
+
+            const auto buffer = storage.Buffers[bufferIndex];
+            const usize requiredLength = outView.Count == 0
+                                             ? 0
+                                             : accessorOffset + (outView.Count - 1) * outView.Stride + elementSize;
+            if (viewOffset + viewLength > buffer.size() || requiredLength > viewLength) {
+                Log::RtError("glTF accessor {0} reads past the end of its buffer.", accessorIndex);
+                return false;
+            }
+
+            outView.Data = buffer.data() + viewOffset + accessorOffset;
+            return true;
+        }
+
+        glm::mat4 GetNodeTransform(const Json& node) {
+            if (node.contains("matrix")) {
+                const auto matrix = node["matrix"].get<std::array<f32, 16>>();
+                return glm::make_mat4(matrix.data());
+            }
+
+            const auto translation = node.value("translation", std::array<f32, 3>{0.f, 0.f, 0.f});
+            const auto rotation = node.value("rotation", std::array<f32, 4>{0.f, 0.f, 0.f, 1.f});
+            const auto scale = node.value("scale", std::array<f32, 3>{1.f, 1.f, 1.f});
+
+            const glm::mat4 translationMatrix = glm::translate(glm::mat4(1.f), glm::make_vec3(translation.data()));
+            // glTF stores quaternions as XYZW, glm constructs them from WXYZ.
+            const glm::quat orientation(rotation[3], rotation[0], rotation[1], rotation[2]);
+            const glm::mat4 rotationMatrix = glm::mat4_cast(orientation);
+            const glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.f), glm::make_vec3(scale.data()));
+
+            return translationMatrix * rotationMatrix * scaleMatrix;
+        }
+
+        bool DecodePrimitive(const PrimitiveSource& source, MeshData& outMesh) {
+            outMesh.Name = source.Name;
+            outMesh.Vertices.resize(source.Positions.Count);
+
+            const auto& positions = source.Positions;
+            const bool tightFloatPositions = positions.ComponentType == ComponentType::Float;
+            for (usize i = 0; i < positions.Count; i++) {
+                const std::byte* element = positions.Data + i * positions.Stride;
+                auto& vertex = outMesh.Vertices[i];
+
+                if (tightFloatPositions) {
+                    std::memcpy(&vertex.Position, element, sizeof(glm::vec3));
+                } else {
+                    const u32 componentSize = GetComponentSize(positions.ComponentType);
+                    for (u32 c = 0; c < 3; c++) {
+                        vertex.Position[c] = ReadComponent(element + c * componentSize, positions.ComponentType,
+                                                           positions.Normalized);
+                    }
+                }
+
+                vertex.Normal = glm::vec3(0.f);
+                vertex.UvX = 0.f;
+                vertex.UvY = 0.f;
+            }
+
+            if (const auto& normals = source.Normals; normals.Data != nullptr) {
+                const u32 componentSize = GetComponentSize(normals.ComponentType);
+                for (usize i = 0; i < std::min(normals.Count, positions.Count); i++) {
+                    const std::byte* element = normals.Data + i * normals.Stride;
+                    for (u32 c = 0; c < 3; c++) {
+                        outMesh.Vertices[i].Normal[c] = ReadComponent(element + c * componentSize,
+                                                                      normals.ComponentType, normals.Normalized);
+                    }
+                }
+            }
+
+            if (const auto& texCoords = source.TexCoords; texCoords.Data != nullptr) {
+                const u32 componentSize = GetComponentSize(texCoords.ComponentType);
+                for (usize i = 0; i < std::min(texCoords.Count, positions.Count); i++) {
+                    const std::byte* element = texCoords.Data + i * texCoords.Stride;
+                    outMesh.Vertices[i].UvX = ReadComponent(element, texCoords.ComponentType, texCoords.Normalized);
+                    outMesh.Vertices[i].UvY = ReadComponent(element + componentSize, texCoords.ComponentType,
+                                                            texCoords.Normalized);
+                }
+            }
+
+            if (const auto& indices = source.Indices; indices.Data != nullptr) {
+                outMesh.Indices.resize(indices.Count);
+                if (indices.ComponentType == ComponentType::UnsignedInt && indices.Stride == sizeof(u32)) {
+                    std::memcpy(outMesh.Indices.data(), indices.Data, indices.Count * sizeof(u32));
+                } else {
+                    for (usize i = 0; i < indices.Count; i++) {
+                        outMesh.Indices[i] = ReadIndex(indices.Data + i * indices.Stride, indices.ComponentType);
+                    }
+                }
+
+                for (const u32 index : outMesh.Indices) {
+                    if (index >= positions.Count) {
+                        Log::RtError("glTF primitive {0} indexes past its vertices.", source.Name);
+                        return false;
+                    }
+                }
+            } else {
+                outMesh.Indices.resize(positions.Count);
+                for (usize i = 0; i < positions.Count; i++) {
+                    outMesh.Indices[i] = static_cast<u32>(i);
+                }
+            }
+
+            // Trailing indices of an incomplete triangle are dropped.
+            outMesh.Indices.resize(outMesh.Indices.size() / 3 * 3);
+
+            if (source.Normals.Data == nullptr) {
+                GenerateNormals(outMesh);
+            }
+
+            return true;
+        }
+
+        bool GatherPrimitives(const Json& document, const BufferStorage& storage, const usize materialCount,
+                              std::vector<PrimitiveSource>& outPrimitives,
+                              std::vector<std::vector<u32>>& outPrimitivesPerMesh) {
+            if (!document.contains("meshes")) {
+                return true;
+            }
+
+            for (const Json& mesh : document["meshes"]) {
+                const auto meshName = mesh.value("name", std::string{});
+                auto& meshPrimitives = outPrimitivesPerMesh.emplace_back();
+
+                for (const Json& primitive : mesh.at("primitives")) {
+                    if (primitive.value("mode", g_TrianglesMode) != g_TrianglesMode) {
+                        Log::RtWarn("Skipping non-triangle primitive of glTF mesh {0}.", meshName);
+                        continue;
+                    }
+
+                    const Json& attributes = primitive.at("attributes");
+                    if (!attributes.contains("POSITION")) {
+                        Log::RtWarn("Skipping glTF primitive of mesh {0} without positions.", meshName);
+                        continue;
+                    }
+
+                    PrimitiveSource source;
+                    source.Name = std::format("{0}#{1}", meshName, meshPrimitives.size());
+
+                    if (!ResolveAccessor(document, storage, attributes["POSITION"].get<usize>(), source.Positions)) {
+                        return false;
+                    }
+                    if (attributes.contains("NORMAL") &&
+                        !ResolveAccessor(document, storage, attributes["NORMAL"].get<usize>(), source.Normals)) {
+                        return false;
+                    }
+                    if (attributes.contains("TEXCOORD_0") &&
+                        !ResolveAccessor(document, storage, attributes["TEXCOORD_0"].get<usize>(), source.TexCoords)) {
+                        return false;
+                    }
+                    if (primitive.contains("indices") &&
+                        !ResolveAccessor(document, storage, primitive["indices"].get<usize>(), source.Indices)) {
+                        return false;
+                    }
+                    if (primitive.contains("material")) {
+                        source.Material = primitive["material"].get<usize>();
+                        if (*source.Material >= materialCount) {
+                            Log::RtError("glTF material {0} is out of range.", *source.Material);
+                            return false;
+                        }
+                    }
+
+                    meshPrimitives.push_back(static_cast<u32>(outPrimitives.size()));
+                    outPrimitives.push_back(std::move(source));
+                }
+            }
+
+            return true;
+        }
+
+        void GatherPlacements(const Json& document, const std::vector<std::vector<u32>>& primitivesPerMesh,
+                              std::vector<MeshPlacement>& outPlacements) {
+            if (!document.contains("nodes")) {
+                return;
+            }
+
+            const Json& nodes = document["nodes"];
+
+            std::vector<usize> rootNodes;
+            if (document.contains("scenes") && !document["scenes"].empty()) {
+                const Json& scene = document["scenes"].at(document.value("scene", usize{0}));
+                rootNodes = scene.value("nodes", std::vector<usize>{});
+            } else {
+                // Without scenes every node that is nobody's child is a root.
+                std::vector<bool> isChild(nodes.size(), false);
+                for (const Json& node : nodes) {
+                    for (const usize child : node.value("children", std::vector<usize>{})) {
+                        isChild.at(child) = true;
+                    }
+                }
+                for (usize i = 0; i < nodes.size(); i++) {
+                    if (!isChild[i]) {
+                        rootNodes.push_back(i);
+                    }
+                }
+            }
+
+            struct PendingNode {
+                usize Index;
+                glm::mat4 ParentTransform;
+            };
+
+            std::vector<PendingNode> pendingNodes;
+            for (const usize root : rootNodes) {
+                pendingNodes.push_back({root, glm::mat4(1.f)});
+            }
+
+            while (!pendingNodes.empty()) {
+                const auto [index, parentTransform] = pendingNodes.back();
+                pendingNodes.pop_back();
+
+                const Json& node = nodes.at(index);
+                const glm::mat4 transform = parentTransform * GetNodeTransform(node);
+
+                if (node.contains("mesh")) {
+                    for (const u32 primitive : primitivesPerMesh.at(node["mesh"].get<usize>())) {
+                        outPlacements.push_back({primitive, transform});
+                    }
+                }
+
+                for (const usize child : node.value("children", std::vector<usize>{})) {
+                    pendingNodes.push_back({child, transform});
+                }
+            }
+        }
+    }
+
+    bool LoadGltf(const std::filesystem::path& path, SceneDescription& outScene) {
+        const MappedFile file(path);
+        if (!file.IsOpen()) {
+            return false;
+        }
+
+        // A .glb is a header followed by a JSON chunk and an optional binary chunk, both used in place.
+        const auto data = file.GetData();
+        std::span<const std::byte> jsonChunk = data;
+        std::span<const std::byte> binaryChunk;
+
+        if (data.size() >= 12 && ReadUnaligned<u32>(data.data()) == g_GlbMagic) {
+            usize offset = 12;
+            while (offset + 8 <= data.size()) {
+                const usize chunkLength = ReadUnaligned<u32>(data.data() + offset);
+                const u32 chunkType = ReadUnaligned<u32>(data.data() + offset + 4);
+                offset += 8;
+
+                if (offset + chunkLength > data.size()) {
+                    Log::RtError("Truncated glb chunk in {0}.", path.string());
+                    return false;
+                }
+
+                if (chunkType == g_GlbJsonChunk) {
+                    jsonChunk = data.subspan(offset, chunkLength);
+                } else if (chunkType == g_GlbBinaryChunk && binaryChunk.empty()) {
+                    binaryChunk = data.subspan(offset, chunkLength);
+                }
+
+                offset += chunkLength;
+            }
+        }
+
+        const auto* jsonBegin = reinterpret_cast<const char*>(jsonChunk.data());
+        const Json document = Json::parse(jsonBegin, jsonBegin + jsonChunk.size(), nullptr, false);
+        if (document.is_discarded()) {
+            Log::RtError("Failed to parse the glTF JSON of {0}.", path.string());
+            return false;
+        }
+
+        BufferStorage storage;
+        std::vector<MaterialData> materials;
+        std::vector<ImageSource> images;
+        std::vector<PrimitiveSource> primitives;
+        std::vector<std::vector<u32>> primitivesPerMesh;
+        std::vector<MeshPlacement> placements;
+
+        // Malformed documents throw on type mismatches and out of range indices, only the traversal needs guarding.
+        try {
+            if (!ResolveBuffers(document, path.parent_path(), binaryChunk, storage)) {
+                return false;
+            }
+            GatherMaterials(document, path.parent_path(), storage, materials, images);
+            if (!GatherPrimitives(document, storage, materials.size(), primitives, primitivesPerMesh)) {
+                return false;
+            }
+            GatherPlacements(document, primitivesPerMesh, placements);
+        } catch (const std::exception& exception) {
+            Log::RtError("Invalid glTF document {0}: {1}.", path.string(), exception.what());
+            return false;
+        }
+
+        std::vector<MeshData> meshes(primitives.size());
+        std::vector<u8> decoded(primitives.size(), 0);
+        ParallelFor(primitives.size(), [&](const usize index) {
+            decoded[index] = DecodePrimitive(primitives[index], meshes[index]);
+        });
+
+        if (std::ranges::find(decoded, u8{0}) != decoded.end()) {
+            return false;
+        }
+
+        std::vector<TextureData> textures(images.size());
+        std::vector<u8> decodedImages(images.size(), 0);
+        ParallelFor(images.size(), [&](const usize index) {
+            decodedImages[index] = DecodeImage(images[index], textures[index]);
+        });
+
+        // Images that failed to decode are dropped, the others are appended to the textures of the scene.
+        std::vector<u32> sceneTextures(images.size(), g_NoTexture);
+        for (usize i = 0; i < images.size(); i++) {
+            if (decodedImages[i]) {
+                sceneTextures[i] = static_cast<u32>(outScene.Textures.size());
+                outScene.Textures.push_back(std::move(textures[i]));
+            }
+        }
+
+        for (usize i = 0; i < primitives.size(); i++) {
+            if (!primitives[i].Material) {
+                continue;
+            }
+
+            MaterialData material = materials[*primitives[i].Material];
+            if (material.OpacityTexture != g_NoTexture) {
+                material.OpacityTexture = sceneTextures[material.OpacityTexture];
+            }
+            meshes[i].Material = material;
+        }
+
+        const u32 meshOffset = static_cast<u32>(outScene.Meshes.size());
+        outScene.Meshes.insert(outScene.Meshes.end(), std::make_move_iterator(meshes.begin()),
+                               std::make_move_iterator(meshes.end()));
+        for (auto& placement : placements) {
+            outScene.Placements.push_back({placement.MeshIndex + meshOffset, placement.Transform});
+        }
+
+        return true;
+    }
+}
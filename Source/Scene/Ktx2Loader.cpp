@@ -0,0 +1,159 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/Ktx2Loader.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+#include <Raytracer/Core/MappedFile.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace Raytracer::Scene {
+    namespace {
+        constexpr std::array<u8, 12> g_Ktx2Identifier = {
+            0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+        };
+
+        // Header and index of the KTX2 specification, the level index follows.
+        struct Ktx2Header {
+            std::array<u8, 12> Identifier;
+            u32 Format;
+            u32 TypeSize;
+            u32 PixelWidth;
+            u32 PixelHeight;
+            u32 PixelDepth;
+            u32 LayerCount;
+            u32 FaceCount;
+            u32 LevelCount;
+            u32 SupercompressionScheme;
+            u32 DfdByteOffset;
+            u32 DfdByteLength;
+            u32 KvdByteOffset;
+            u32 KvdByteLength;
+            u64 SgdByteOffset;
+            u64 SgdByteLength;
+        };
+
+        struct Ktx2Level {
+            u64 ByteOffset;
+            u64 ByteLength;
+            u64 UncompressedByteLength;
+        };
+
+        static_assert(sizeof(Ktx2Header) == 80);
+        static_assert(sizeof(Ktx2Level) == 24);
+
+        u64 GetLevelSize(const u32 width, const u32 height, const u32 blockSize) {
+            return static_cast<u64>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+        }
+    }
+
+    u32 GetBlockSize(const VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+            case VK_FORMAT_BC4_SNORM_BLOCK:
+                return 8;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC5_SNORM_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    bool LoadKtx2(const std::filesystem::path& path, TextureData& outTexture) {
+        const MappedFile file(path);
+        if (!file.IsOpen()) {
+            Log::RtError("Failed to open texture {0}.", path.string());
+            return false;
+        }
+
+        const auto data = file.GetData();
+
+        constexpr usize levelIndexOffset = sizeof(Ktx2Header);
+
+        Ktx2Header header;
+        if (data.size() < levelIndexOffset) {
+            Log::RtError("{0} is not a KTX2 file.", path.string());
+            return false;
+        }
+
+        std::memcpy(&header, data.data(), sizeof(Ktx2Header));
+        if (header.Identifier != g_Ktx2Identifier) {
+            Log::RtError("{0} is not a KTX2 file.", path.string());
+            return false;
+        }
+
+        const VkFormat format = static_cast<VkFormat>(header.Format);
+        const u32 blockSize = GetBlockSize(format);
+        if (blockSize == 0) {
+            Log::RtError("Unsupported format {0} in {1}, only BC1, BC4, BC5 and BC7 are supported.", header.Format,
+                         path.string());
+            return false;
+        }
+
+        if (header.SupercompressionScheme != 0) {
+            Log::RtError("Supercompressed texture {0} is not supported.", path.string());
+            return false;
+        }
+
+        if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth > 1 || header.LayerCount > 1 ||
+            header.FaceCount != 1) {
+            Log::RtError("{0} is not a 2D texture.", path.string());
+            return false;
+        }
+
+        // A level count of 0 asks the loader to generate the mips, the base level is used as is.
+        const u32 levelCount = std::max(header.LevelCount, 1u);
+        const u32 maxLevelCount = static_cast<u32>(std::bit_width(std::max(header.PixelWidth, header.PixelHeight)));
+        if (levelCount > maxLevelCount ||
+            levelCount > (data.size() - levelIndexOffset) / sizeof(Ktx2Level)) {
+            Log::RtError("Invalid level index in {0}.", path.string());
+            return false;
+        }
+
+        std::vector<Ktx2Level> levels(levelCount);
+        std::memcpy(levels.data(), data.data() + levelIndexOffset, levelCount * sizeof(Ktx2Level));
+
+        outTexture.Format = format;
+        outTexture.Width = header.PixelWidth;
+        outTexture.Height = header.PixelHeight;
+        outTexture.LevelOffsets.resize(levelCount);
+
+        // The file stores the smallest level first, the levels are repacked from the base level down. Every level is
+        // a whole number of blocks, so the offsets stay block aligned as the copies require.
+        VkDeviceSize totalSize = 0;
+        for (u32 level = 0; level < levelCount; level++) {
+            const u32 width = std::max(header.PixelWidth >> level, 1u);
+            const u32 height = std::max(header.PixelHeight >> level, 1u);
+            const u64 levelSize = GetLevelSize(width, height, blockSize);
+
+            if (levels[level].ByteLength != levelSize || levels[level].ByteOffset > data.size() ||
+                levelSize > data.size() - levels[level].ByteOffset) {
+                Log::RtError("Invalid level {0} in {1}.", level, path.string());
+                return false;
+            }
+
+            outTexture.LevelOffsets[level] = totalSize;
+            totalSize += levelSize;
+        }
+
+        outTexture.Data.resize(totalSize);
+        for (u32 level = 0; level < levelCount; level++) {
+            std::memcpy(outTexture.Data.data() + outTexture.LevelOffsets[level], data.data() + levels[level].ByteOffset,
+                        levels[level].ByteLength);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,426 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/ObjLoader.hpp>
+
+#include <Raytracer/Core/Hash.hpp>
+#include <Raytracer/Core/Logger.hpp>
+#include <Raytracer/Core/MappedFile.hpp>
+#include <Raytracer/Core/Parallel.hpp>
+
+#include <glm/vec2.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace Raytracer::Scene {
+    namespace {
+        // Small files are not worth splitting, and smaller chunks only add merge work.
+        constexpr usize g_MinChunkSize = 4 << 20;
+        constexpr i32 g_MissingIndex = std::numeric_limits<i32>::min();
+
+        // Negative OBJ indices count back from the last element read so far, so a chunk can only resolve them once
+        // it knows how many elements the previous chunks hold.
+        namespace RelativeIndex {
+            constexpr u8 Position = 1 << 0;
+            constexpr u8 TexCoord = 1 << 1;
+            constexpr u8 Normal = 1 << 2;
+        }
+
+        struct Corner {
+            i32 Position;
+            i32 TexCoord;
+            i32 Normal;
+            u8 Relative;
+        };
+
+        // A corner once its indices are global and zero based, the key the vertices are welded on.
+        struct VertexKey {
+            i32 Position;
+            i32 TexCoord;
+            i32 Normal;
+
+            bool operator==(const VertexKey&) const = default;
+        };
+
+        struct VertexKeyHash {
+            usize operator()(const VertexKey& key) const {
+                return HashValue(key);
+            }
+        };
+
+        struct GroupStart {
+            usize FirstTriangle;
+            std::string Name;
+        };
+
+        struct ChunkResult {
+            std::vector<glm::vec3> Positions;
+            std::vector<glm::vec2> TexCoords;
+            std::vector<glm::vec3> Normals;
+            // Three per triangle, polygons are triangulated as fans.
+            std::vector<Corner> Corners;
+            std::vector<GroupStart> Groups;
+            usize MalformedLineCount = 0;
+        };
+
+        struct MeshRange {
+            std::string Name;
+            usize FirstTriangle;
+            usize TriangleCount;
+        };
+
+        const char* SkipSpaces(const char* current, const char* end) {
+            while (current < end && (*current == ' ' || *current == '\t' || *current == '\r')) {
+                ++current;
+            }
+
+            return current;
+        }
+
+        // std::from_chars is locale independent and does not allocate, unlike strtof and streams.
+        bool ParseFloat(const char*& current, const char* end, f32& outValue) {
+            current = SkipSpaces(current, end);
+            if (current < end && *current == '+') {
+                ++current;
+            }
+
+            const auto [next, error] = std::from_chars(current, end, outValue);
+            if (error != std::errc{}) {
+                return false;
+            }
+
+            current = next;
+            return true;
+        }
+
+        bool ParseIndex(const char*& current, const char* end, const usize elementCount, const u8 relativeFlag,
+                        i32& outIndex, u8& outRelative) {
+            i32 value;
+            const auto [next, error] = std::from_chars(current, end, value);
+            if (error != std::errc{} || value == 0) {
+                return false;
+            }
+            current = next;
+
+            if (value > 0) {
+                outIndex = value - 1;
+            } else {
+                outIndex = static_cast<i32>(elementCount) + value;
+                outRelative |= relativeFlag;
+            }
+
+            return true;
+        }
+
+        // v, v/vt, v//vn or v/vt/vn.
+        bool ParseCorner(const char*& current, const char* end, const ChunkResult& chunk, Corner& outCorner) {
+            outCorner = {g_MissingIndex, g_MissingIndex, g_MissingIndex, 0};
+
+            if (!ParseIndex(current, end, chunk.Positions.size(), RelativeIndex::Position, outCorner.Position,
+                            outCorner.Relative)) {
+                return false;
+            }
+
+            if (current < end && *current == '/') {
+                ++current;
+                if (current < end && *current != '/' &&
+                    !ParseIndex(current, end, chunk.TexCoords.size(), RelativeIndex::TexCoord, outCorner.TexCoord,
+                                outCorner.Relative)) {
+                    return false;
+                }
+
+                if (current < end && *current == '/') {
+                    ++current;
+                    if (!ParseIndex(current, end, chunk.Normals.size(), RelativeIndex::Normal, outCorner.Normal,
+                                    outCorner.Relative)) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        bool ParseLine(const char* current, const char* end, ChunkResult& chunk, std::vector<Corner>& polygon) {
+            current = SkipSpaces(current, end);
+            if (current == end || *current == '#') {
+                return true;
+            }
+
+            const char* keywordEnd = current;
+            while (keywordEnd < end && *keywordEnd != ' ' && *keywordEnd != '\t') {
+                ++keywordEnd;
+            }
+            const std::string_view keyword(current, keywordEnd - current);
+            current = keywordEnd;
+
+            if (keyword == "v") {
+                glm::vec3& position = chunk.Positions.emplace_back();
+                return ParseFloat(current, end, position.x) && ParseFloat(current, end, position.y) &&
+                       ParseFloat(current, end, position.z);
+            }
+
+            if (keyword == "vt") {
+                glm::vec2& texCoord = chunk.TexCoords.emplace_back(0.f);
+                if (!ParseFloat(current, end, texCoord.x)) {
+                    return false;
+                }
+                // The V coordinate is optional.
+                ParseFloat(current, end, texCoord.y);
+                return true;
+            }
+
+            if (keyword == "vn") {
+                glm::vec3& normal = chunk.Normals.emplace_back();
+                return ParseFloat(current, end, normal.x) && ParseFloat(current, end, normal.y) &&
+                       ParseFloat(current, end, normal.z);
+            }
+
+            if (keyword == "f") {
+                polygon.clear();
+                for (current = SkipSpaces(current, end); current < end; current = SkipSpaces(current, end)) {
+                    if (!ParseCorner(current, end, chunk, polygon.emplace_back())) {
+                        return false;
+                    }
+                }
+
+                if (polygon.size() < 3) {
+                    return false;
+                }
+
+                for (usize i = 1; i + 1 < polygon.size(); i++) {
+                    chunk.Corners.push_back(polygon[0]);
+                    chunk.Corners.push_back(polygon[i]);
+                    chunk.Corners.push_back(polygon[i + 1]);
+                }
+                return true;
+            }
+
+            if (keyword == "o" || keyword == "g") {
+                current = SkipSpaces(current, end);
+                const char* nameEnd = end;
+                while (nameEnd > current && (nameEnd[-1] == '\r' || nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) {
+                    --nameEnd;
+                }
+
+                chunk.Groups.push_back({chunk.Corners.size() / 3, std::string(current, nameEnd)});
+                return true;
+            }
+
+            // mtllib, usemtl, smoothing groups, lines and points.
+            return true;
+        }
+
+        void ParseChunk(const std::string_view text, ChunkResult& outChunk) {
+            std::vector<Corner> polygon;
+
+            const char* current = text.data();
+            const char* end = current + text.size();
+            while (current < end) {
+                const auto* lineEnd = static_cast<const char*>(std::memchr(current, '\n', end - current));
+                if (lineEnd == nullptr) {
+                    lineEnd = end;
+                }
+
+                if (!ParseLine(current, lineEnd, outChunk, polygon)) {
+                    outChunk.MalformedLineCount++;
+                }
+
+                current = lineEnd + 1;
+            }
+        }
+
+        // Splits the file in about one chunk per core, each one ending right after a line break.
+        std::vector<std::string_view> SplitIntoChunks(const std::string_view text) {
+            const usize threadCount = std::max(1u, std::thread::hardware_concurrency());
+            const usize chunkCount = std::clamp<usize>(text.size() / g_MinChunkSize, 1, threadCount);
+
+            std::vector<std::string_view> chunks;
+            usize chunkStart = 0;
+            for (usize i = 1; i <= chunkCount && chunkStart < text.size(); i++) {
+                usize chunkEnd = text.size();
+                if (i < chunkCount) {
+                    chunkEnd = text.find('\n', std::max(chunkStart, text.size() * i / chunkCount));
+                    chunkEnd = chunkEnd == std::string_view::npos ? text.size() : chunkEnd + 1;
+                }
+
+                chunks.push_back(text.substr(chunkStart, chunkEnd - chunkStart));
+                chunkStart = chunkEnd;
+            }
+
+            return chunks;
+        }
+
+        i32 ResolveIndex(const i32 index, const bool relative, const usize offset, const usize elementCount,
+                         bool& outValid) {
+            if (index == g_MissingIndex) {
+                return index;
+            }
+
+            const i64 globalIndex = relative ? static_cast<i64>(offset) + index : index;
+            if (globalIndex < 0 || globalIndex >= static_cast<i64>(elementCount)) {
+                outValid = false;
+                return g_MissingIndex;
+            }
+
+            return static_cast<i32>(globalIndex);
+        }
+
+        void WeldMesh(const MeshRange& range, const std::vector<VertexKey>& corners,
+                      const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords,
+                      const std::vector<glm::vec3>& normals, MeshData& outMesh) {
+            outMesh.Name = range.Name;
+            outMesh.Indices.reserve(range.TriangleCount * 3);
+
+            std::unordered_map<VertexKey, u32, VertexKeyHash> vertexIndices;
+            vertexIndices.reserve(range.TriangleCount * 3 / 2);
+
+            bool missingNormals = false;
+            for (usize i = range.FirstTriangle * 3; i < (range.FirstTriangle + range.TriangleCount) * 3; i++) {
+                const VertexKey& corner = corners[i];
+
+                const auto [it, inserted] = vertexIndices.try_emplace(corner,
+                                                                      static_cast<u32>(outMesh.Vertices.size()));
+                if (inserted) {
+                    Renderer::Vertex& vertex = outMesh.Vertices.emplace_back();
+                    vertex.Position = positions[corner.Position];
+                    vertex.Normal = corner.Normal != g_MissingIndex ? normals[corner.Normal] : glm::vec3(0.f);
+                    // OBJ texture coordinates start at the bottom of the image.
+                    const glm::vec2 texCoord = corner.TexCoord != g_MissingIndex ? texCoords[corner.TexCoord]
+                                                                                 : glm::vec2(0.f);
+                    vertex.UvX = texCoord.x;
+                    vertex.UvY = 1.f - texCoord.y;
+
+                    missingNormals |= corner.Normal == g_MissingIndex;
+                }
+
+                outMesh.Indices.push_back(it->second);
+            }
+
+            if (missingNormals) {
+                GenerateNormals(outMesh);
+            }
+        }
+    }
+
+    bool LoadObj(const std::filesystem::path& path, SceneDescription& outScene) {
+        const MappedFile file(path);
+        if (!file.IsOpen()) {
+            return false;
+        }
+
+        const std::string_view text(reinterpret_cast<const char*>(file.GetData().data()), file.GetSize());
+        const auto chunkTexts = SplitIntoChunks(text);
+
+        std::vector<ChunkResult> chunks(chunkTexts.size());
+        ParallelFor(chunks.size(), [&](const usize index) {
+            ParseChunk(chunkTexts[index], chunks[index]);
+        });
+
+        // Where each chunk starts in the global streams.
+        struct ChunkOffsets {
+            usize Position = 0;
+            usize TexCoord = 0;
+            usize Normal = 0;
+            usize Corner = 0;
+        };
+
+        std::vector<ChunkOffsets> offsets(chunks.size());
+        ChunkOffsets totals;
+        usize malformedLineCount = 0;
+        for (usize i = 0; i < chunks.size(); i++) {
+            offsets[i] = totals;
+            totals.Position += chunks[i].Positions.size();
+            totals.TexCoord += chunks[i].TexCoords.size();
+            totals.Normal += chunks[i].Normals.size();
+            totals.Corner += chunks[i].Corners.size();
+            malformedLineCount += chunks[i].MalformedLineCount;
+        }
+
+        if (malformedLineCount > 0) {
+            Log::RtWarn("Skipped {0} malformed lines in {1}.", malformedLineCount, path.string());
+        }
+
+        std::vector<glm::vec3> positions(totals.Position);
+        std::vector<glm::vec2> texCoords(totals.TexCoord);
+        std::vector<glm::vec3> normals(totals.Normal);
+        std::vector<VertexKey> corners(totals.Corner);
+        std::vector<u8> chunksValid(chunks.size(), 1);
+
+        ParallelFor(chunks.size(), [&](const usize index) {
+            ChunkResult& chunk = chunks[index];
+            const ChunkOffsets& offset = offsets[index];
+
+            std::ranges::copy(chunk.Positions, positions.begin() + static_cast<std::ptrdiff_t>(offset.Position));
+            std::ranges::copy(chunk.TexCoords, texCoords.begin() + static_cast<std::ptrdiff_t>(offset.TexCoord));
+            std::ranges::copy(chunk.Normals, normals.begin() + static_cast<std::ptrdiff_t>(offset.Normal));
+
+            bool valid = true;
+            for (usize i = 0; i < chunk.Corners.size(); i++) {
+                const Corner& corner = chunk.Corners[i];
+                VertexKey& key = corners[offset.Corner + i];
+
+                key.Position = ResolveIndex(corner.Position, corner.Relative & RelativeIndex::Position,
+                                            offset.Position, totals.Position, valid);
+                key.TexCoord = ResolveIndex(corner.TexCoord, corner.Relative & RelativeIndex::TexCoord,
+                                            offset.TexCoord, totals.TexCoord, valid);
+                key.Normal = ResolveIndex(corner.Normal, corner.Relative & RelativeIndex::Normal,
+                                          offset.Normal, totals.Normal, valid);
+            }
+
+            // Positions are mandatory, the other attributes fall back to defaults.
+            valid = valid && std::ranges::none_of(corners.begin() + static_cast<std::ptrdiff_t>(offset.Corner),
+                                                  corners.begin() + static_cast<std::ptrdiff_t>(offset.Corner +
+                                                      chunk.Corners.size()),
+                                                  [](const VertexKey& key) {
+                                                      return key.Position == g_MissingIndex;
+                                                  });
+            chunksValid[index] = valid;
+
+            // Only the group starts are still needed.
+            chunk.Positions = {};
+            chunk.TexCoords = {};
+            chunk.Normals = {};
+            chunk.Corners = {};
+        });
+
+        if (std::ranges::find(chunksValid, u8{0}) != chunksValid.end()) {
+            Log::RtError("{0} references vertices that do not exist.", path.string());
+            return false;
+        }
+
+        // Every object or group starts a new mesh, the faces before the first one go in an unnamed mesh.
+        std::vector<MeshRange> ranges{{path.stem().string(), 0, 0}};
+        for (usize i = 0; i < chunks.size(); i++) {
+            for (auto& group : chunks[i].Groups) {
+                ranges.back().TriangleCount = offsets[i].Corner / 3 + group.FirstTriangle - ranges.back().FirstTriangle;
+                ranges.push_back({std::move(group.Name), offsets[i].Corner / 3 + group.FirstTriangle, 0});
+            }
+        }
+        ranges.back().TriangleCount = totals.Corner / 3 - ranges.back().FirstTriangle;
+
+        std::erase_if(ranges, [](const MeshRange& range) {
+            return range.TriangleCount == 0;
+        });
+
+        std::vector<MeshData> meshes(ranges.size());
+        ParallelFor(ranges.size(), [&](const usize index) {
+            WeldMesh(ranges[index], corners, positions, texCoords, normals, meshes[index]);
+        });
+
+        const u32 meshOffset = static_cast<u32>(outScene.Meshes.size());
+        for (u32 i = 0; i < meshes.size(); i++) {
+            outScene.Meshes.push_back(std::move(meshes[i]));
+            outScene.Placements.push_back({meshOffset + i, glm::mat4(1.f)});
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,225 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/ProceduralScene.hpp>
+
+#include <Raytracer/Core/Parallel.hpp>
+
+#include <glm/trigonometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <numbers>
+
+namespace Raytracer::Scene {
+    namespace {
+        // Distance between neighboring instances without overlap, the meshes fit in a sphere of radius ~1.2.
+        constexpr f32 g_InstanceSpacing = 3.f;
+
+        // SplitMix64, the standard distributions are implementation-defined and would break determinism across
+        // compilers.
+        class Random {
+        public:
+            explicit Random(const u64 seed) : m_State(seed) {
+            }
+
+            u64 NextU64() {
+                u64 value = (m_State += 0x9E3779B97F4A7C15ull);
+                value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+                value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+                return value ^ (value >> 31);
+            }
+
+            // In [0, 1).
+            f32 NextFloat() {
+                return static_cast<f32>(NextU64() >> 40) * 0x1.0p-24f;
+            }
+
+            // In [-1, 1)^3.
+            glm::vec3 NextInCube() {
+                return glm::vec3(NextFloat(), NextFloat(), NextFloat()) * 2.f - 1.f;
+            }
+
+        private:
+            u64 m_State;
+        };
+
+        // Each mesh and the placement get their own stream, so that the scene doesn't depend on the generation order.
+        Random MakeStream(const u64 seed, const u64 stream) {
+            Random random(seed ^ (stream * 0xD1B54A32D192ED03ull));
+            (void)random.NextU64();
+            return random;
+        }
+
+        // UV sphere with pole fans and a lumpy radius, 4 * rings * (rings - 1) triangles.
+        void GenerateSphere(Random& random, const u32 triangleCount, MeshData& mesh) {
+            const u32 rings = std::max(2u, static_cast<u32>(std::lround((1.f + std::sqrt(1.f + triangleCount)) / 2.f)));
+            const u32 segments = 2 * rings;
+
+            const glm::vec3 frequency = 1.f + 4.f * glm::vec3(random.NextFloat(), random.NextFloat(),
+                                                              random.NextFloat());
+            const glm::vec3 phase = 2.f * std::numbers::pi_v<f32> * glm::vec3(random.NextFloat(), random.NextFloat(),
+                                                                             random.NextFloat());
+            const f32 amplitude = 0.05f + 0.15f * random.NextFloat();
+
+            const auto addVertex = [&](const f32 u, const f32 v) {
+                const f32 theta = v * std::numbers::pi_v<f32>;
+                const f32 phi = u * 2.f * std::numbers::pi_v<f32>;
+                const glm::vec3 direction(std::sin(theta) * std::cos(phi), std::cos(theta),
+                                          std::sin(theta) * std::sin(phi));
+                const glm::vec3 lumps = glm::sin(frequency * direction + phase);
+                const f32 radius = 1.f + amplitude * lumps.x * lumps.y * lumps.z;
+
+                mesh.Vertices.push_back({direction * radius, u, glm::vec3(0.f), v});
+            };
+
+            // Top pole, the rings with a duplicated seam column for the UVs, then the bottom pole.
+            mesh.Vertices.reserve(2 + static_cast<usize>(rings - 1) * (segments + 1));
+            addVertex(0.5f, 0.f);
+            for (u32 ring = 1; ring < rings; ring++) {
+                for (u32 segment = 0; segment <= segments; segment++) {
+                    addVertex(static_cast<f32>(segment) / static_cast<f32>(segments),
+                              static_cast<f32>(ring) / static_cast<f32>(rings));
+                }
+            }
+            addVertex(0.5f, 1.f);
+
+            const u32 bottomPole = static_cast<u32>(mesh.Vertices.size() - 1);
+            const auto ringVertex = [&](const u32 ring, const u32 segment) {
+                return 1 + (ring - 1) * (segments + 1) + segment;
+            };
+
+            // Counter-clockwise seen from outside.
+            mesh.Indices.reserve(static_cast<usize>(4) * rings * (rings - 1) * 3);
+            for (u32 segment = 0; segment < segments; segment++) {
+                mesh.Indices.insert(mesh.Indices.end(), {0, ringVertex(1, segment + 1), ringVertex(1, segment)});
+            }
+            for (u32 ring = 1; ring < rings - 1; ring++) {
+                for (u32 segment = 0; segment < segments; segment++) {
+                    const u32 upper = ringVertex(ring, segment);
+                    const u32 lower = ringVertex(ring + 1, segment);
+
+                    mesh.Indices.insert(mesh.Indices.end(), {upper, upper + 1, lower});
+                    mesh.Indices.insert(mesh.Indices.end(), {upper + 1, lower + 1, lower});
+                }
+            }
+            for (u32 segment = 0; segment < segments; segment++) {
+                mesh.Indices.insert(mesh.Indices.end(),
+                                    {bottomPole, ringVertex(rings - 1, segment), ringVertex(rings - 1, segment + 1)});
+            }
+        }
+
+        // Unconnected triangles in [-1, 1]^3. Small ones are scattered like foliage, large ones all cross the whole
+        // volume so that every BVH node overlaps with the others.
+        void GenerateTriangles(Random& random, const u32 triangleCount, const bool large, MeshData& mesh) {
+            const f32 triangleSize = large ? 1.f : 2.f / std::cbrt(static_cast<f32>(std::max(triangleCount, 1u)));
+
+            mesh.Vertices.reserve(static_cast<usize>(triangleCount) * 3);
+            mesh.Indices.reserve(static_cast<usize>(triangleCount) * 3);
+            for (u32 triangle = 0; triangle < triangleCount; triangle++) {
+                const glm::vec3 center = large ? glm::vec3(0.f) : random.NextInCube();
+
+                for (u32 corner = 0; corner < 3; corner++) {
+                    const glm::vec3 position = glm::clamp(center + random.NextInCube() * triangleSize, -1.f, 1.f);
+                    mesh.Indices.push_back(static_cast<u32>(mesh.Vertices.size()));
+                    mesh.Vertices.push_back({
+                        position, position.x * 0.5f + 0.5f, glm::vec3(0.f), position.z * 0.5f + 0.5f
+                    });
+                }
+            }
+        }
+
+        glm::mat4 MakeInstanceTransform(const glm::vec3& position, const f32 angle) {
+            glm::mat4 transform{1.f};
+            transform[0][0] = std::cos(angle);
+            transform[0][2] = -std::sin(angle);
+            transform[2][0] = std::sin(angle);
+            transform[2][2] = std::cos(angle);
+            transform[3] = glm::vec4(position, 1.f);
+
+            return transform;
+        }
+    }
+
+    void GenerateProceduralScene(const ProceduralSceneSettings& settings, SceneDescription& outScene) {
+        const u32 meshCount = std::max(settings.MeshCount, 1u);
+
+        outScene.Meshes.resize(meshCount);
+        ParallelFor(meshCount, [&](const usize meshIndex) {
+            MeshData& mesh = outScene.Meshes[meshIndex];
+            mesh.Name = std::format("{0}#{1}", GetProceduralLayoutName(settings.Layout), meshIndex);
+
+            Random random = MakeStream(settings.Seed, meshIndex + 1);
+            switch (settings.Layout) {
+                case ProceduralLayout::Grid:
+                    GenerateSphere(random, settings.TriangleCount, mesh);
+                    break;
+                case ProceduralLayout::TriangleSoup:
+                    GenerateTriangles(random, settings.TriangleCount, false, mesh);
+                    break;
+                case ProceduralLayout::Overlapping:
+                    GenerateTriangles(random, settings.TriangleCount, true, mesh);
+                    break;
+            }
+
+            GenerateNormals(mesh);
+        });
+
+        // The grid spreads on the ground, the other layouts fill a cube.
+        const f32 spacing = g_InstanceSpacing * (1.f - std::clamp(settings.Overlap, 0.f, 1.f));
+        const u32 gridSide = static_cast<u32>(std::ceil(std::sqrt(static_cast<f32>(settings.InstanceCount))));
+        const f32 volumeSide = std::ceil(std::cbrt(static_cast<f32>(settings.InstanceCount))) * spacing;
+
+        Random random = MakeStream(settings.Seed, 0);
+        outScene.Placements.reserve(settings.InstanceCount);
+        for (u32 instance = 0; instance < settings.InstanceCount; instance++) {
+            glm::vec3 position;
+            if (settings.Layout == ProceduralLayout::Grid) {
+                const f32 center = static_cast<f32>(gridSide - 1) * 0.5f;
+                position = glm::vec3(static_cast<f32>(instance % gridSide) - center, 0.f,
+                                     static_cast<f32>(instance / gridSide) - center) * spacing;
+            } else {
+                position = random.NextInCube() * 0.5f * volumeSide;
+            }
+
+            const f32 angle = random.NextFloat() * 2.f * std::numbers::pi_v<f32>;
+            const u32 meshIndex = static_cast<u32>(random.NextU64() % meshCount);
+
+            outScene.Placements.push_back({meshIndex, MakeInstanceTransform(position, angle)});
+        }
+    }
+
+    bool ParseProceduralLayout(const std::string_view name, ProceduralLayout& outLayout) {
+        for (const ProceduralLayout layout : {
+                 ProceduralLayout::Grid, ProceduralLayout::TriangleSoup, ProceduralLayout::Overlapping
+             }) {
+            if (name == GetProceduralLayoutName(layout)) {
+                outLayout = layout;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::string_view GetProceduralLayoutName(const ProceduralLayout layout) {
+        switch (layout) {
+            case ProceduralLayout::Grid:
+                return "grid";
+            case ProceduralLayout::TriangleSoup:
+                return "soup";
+            case ProceduralLayout::Overlapping:
+                return "overlap";
+        }
+
+        return "unknown";
+    }
+
+    std::string DescribeProceduralScene(const ProceduralSceneSettings& settings) {
+        return std::format("{0} ({1} triangles x {2} meshes, {3} instances, overlap {4:.2f}, seed {5})",
+                           GetProceduralLayoutName(settings.Layout), settings.TriangleCount, settings.MeshCount,
+                           settings.InstanceCount, settings.Overlap, settings.Seed);
+    }
+}
@@ -0,0 +1,32 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/SceneDescription.hpp>
+
+#include <glm/geometric.hpp>
+
+namespace Raytracer::Scene {
+    void GenerateNormals(MeshData& mesh) {
+        for (auto& vertex : mesh.Vertices) {
+            vertex.Normal = glm::vec3(0.f);
+        }
+
+        for (usize i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+            auto& v0 = mesh.Vertices[mesh.Indices[i]];
+            auto& v1 = mesh.Vertices[mesh.Indices[i + 1]];
+            auto& v2 = mesh.Vertices[mesh.Indices[i + 2]];
+
+            // The cross product length is twice the triangle area, larger faces weigh more.
+            const glm::vec3 faceNormal = glm::cross(v1.Position - v0.Position, v2.Position - v0.Position);
+            v0.Normal += faceNormal;
+            v1.Normal += faceNormal;
+            v2.Normal += faceNormal;
+        }
+
+        for (auto& vertex : mesh.Vertices) {
+            const f32 length = glm::length(vertex.Normal);
+            vertex.Normal = length > 0.f ? vertex.Normal / length : glm::vec3(0.f, 1.f, 0.f);
+        }
+    }
+}
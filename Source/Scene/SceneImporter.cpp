@@ -0,0 +1,27 @@
+// Copyright (C) 2024 Jean "Pixfri" Letessier 
+// This file is part of the "Raytracer" project.
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include <Raytracer/Scene/SceneImporter.hpp>
+
+#include <Raytracer/Core/Logger.hpp>
+
+#include <Raytracer/Scene/GltfLoader.hpp>
+#include <Raytracer/Scene/ObjLoader.hpp>
+
+namespace Raytracer::Scene {
+    bool ImportScene(const std::filesystem::path& path, SceneDescription& outScene) {
+        const auto extension = path.extension();
+
+        if (extension == ".gltf" || extension == ".glb") {
+            return LoadGltf(path, outScene);
+        }
+
+        if (extension == ".obj") {
+            return LoadObj(path, outScene);
+        }
+
+        Log::RtError("Unsupported scene format {0}.", path.string());
+        return false;
+    }
+}
@@ -1,7 +1,131 @@
 #include <Raytracer/RaytracerApp/Application.hpp>
 
-int main() {
-    Raytracer::WindowProperties properties{1920, 1080, "Raytracer", false, false};
+#include <Raytracer/Scene/CookedScene.hpp>
+#include <Raytracer/Scene/ProceduralScene.hpp>
+#include <Raytracer/Scene/SceneImporter.hpp>
+
+#include <charconv>
+#include <cstdio>
+#include <optional>
+#include <string_view>
+
+namespace {
+    // Raytracer.exe --cook Scenes/Sponza.glb Scenes/Sponza.rtscene
+    int CookScene(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath) {
+        Raytracer::Logger::Init();
+
+        Raytracer::Scene::SceneDescription scene;
+        if (!Raytracer::Scene::ImportScene(inputPath, scene) || !Raytracer::Scene::CookScene(scene, outputPath)) {
+            return EXIT_FAILURE;
+        }
+
+        Raytracer::Log::RtInfo("Cooked {0} into {1}.", inputPath.string(), outputPath.string());
+
+        return EXIT_SUCCESS;
+    }
+
+    template <typename T>
+    bool ParseNumber(const std::string_view text, T& outValue) {
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), outValue);
+        return error == std::errc() && end == text.data() + text.size();
+    }
+
+    struct CommandLine {
+        std::filesystem::path ScenePath;
+        std::optional<Raytracer::Scene::ProceduralSceneSettings> ProceduralScene;
+        std::optional<Raytracer::HeadlessSettings> Headless;
+        Raytracer::RenderOptions RenderOptions;
+        Raytracer::i32 Width = 1920;
+        Raytracer::i32 Height = 1080;
+    };
+
+    // Raytracer.exe [scene] [--generate <layout> [--triangles N] [--instances N] [--meshes N] [--overlap F]
+    //               [--seed N]] [--headless <frames> [--capture <directory>]] [--width N] [--height N]
+    //               [--vertex-layout <full|quantized>] [--bvh-cache <directory>] [--bvh-compaction <on|off>]
+    // e.g. Raytracer.exe --generate soup --triangles 1000000 --instances 64 --headless 100 --capture Frames
+    bool ParseCommandLine(const int argc, char** argv, CommandLine& outCommandLine) {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view option = argv[i];
+            if (!option.starts_with("--")) {
+                if (!outCommandLine.ScenePath.empty()) {
+                    return false;
+                }
+
+                outCommandLine.ScenePath = option;
+                continue;
+            }
+
+            // Every option takes a value.
+            if (i + 1 == argc) {
+                return false;
+            }
+
+            const std::string_view value = argv[++i];
+            auto& procedural = outCommandLine.ProceduralScene;
+
+            bool valid;
+            if (option == "--generate") {
+                procedural.emplace();
+                valid = Raytracer::Scene::ParseProceduralLayout(value, procedural->Layout);
+            } else if (option == "--triangles" && procedural) {
+                valid = ParseNumber(value, procedural->TriangleCount);
+            } else if (option == "--instances" && procedural) {
+                valid = ParseNumber(value, procedural->InstanceCount);
+            } else if (option == "--meshes" && procedural) {
+                valid = ParseNumber(value, procedural->MeshCount);
+            } else if (option == "--overlap" && procedural) {
+                valid = ParseNumber(value, procedural->Overlap);
+            } else if (option == "--seed" && procedural) {
+                valid = ParseNumber(value, procedural->Seed);
+            } else if (option == "--headless") {
+                outCommandLine.Headless.emplace();
+                valid = ParseNumber(value, outCommandLine.Headless->FrameCount) &&
+                        outCommandLine.Headless->FrameCount > 0;
+            } else if (option == "--capture" && outCommandLine.Headless) {
+                outCommandLine.Headless->CaptureDirectory = value;
+                valid = true;
+            } else if (option == "--width") {
+                valid = ParseNumber(value, outCommandLine.Width) && outCommandLine.Width > 0;
+            } else if (option == "--height") {
+                valid = ParseNumber(value, outCommandLine.Height) && outCommandLine.Height > 0;
+            } else if (option == "--vertex-layout") {
+                outCommandLine.RenderOptions.VertexQuantization = value == "quantized";
+                valid = value == "full" || value == "quantized";
+            } else if (option == "--bvh-cache") {
+                outCommandLine.RenderOptions.BottomLevelCacheDirectory = value;
+                valid = true;
+            } else if (option == "--bvh-compaction") {
+                outCommandLine.RenderOptions.BottomLevelCompaction = value == "on";
+                valid = value == "on" || value == "off";
+            } else {
+                valid = false;
+            }
+
+            if (!valid) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main(const int argc, char** argv) {
+    if (argc == 4 && std::string_view(argv[1]) == "--cook") {
+        return CookScene(argv[2], argv[3]);
+    }
+
+    CommandLine commandLine;
+    if (!ParseCommandLine(argc, argv, commandLine)) {
+        std::fprintf(stderr, "Usage: %s [scene] [--generate <grid|soup|overlap> [--triangles N] [--instances N] "
+                             "[--meshes N] [--overlap F] [--seed N]] [--headless <frames> [--capture <directory>]] "
+                             "[--width N] [--height N] [--vertex-layout <full|quantized>] "
+                             "[--bvh-cache <directory>] [--bvh-compaction <on|off>]\n"
+                             "       %s --cook <input> <output.rtscene>\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Raytracer::WindowProperties properties{commandLine.Width, commandLine.Height, "Raytracer", false, false};
 
 #if defined(RT_DEBUG)
     constexpr auto debugLevel = Raytracer::DebugLevel::Debug;
@@ -9,9 +133,11 @@ int main() {
     constexpr auto debugLevel = Raytracer::DebugLevel::None;
 #endif
 
-    const auto app = std::make_unique<Raytracer::Application>(properties, debugLevel);
+    const auto app = std::make_unique<Raytracer::Application>(properties, debugLevel, commandLine.ScenePath,
+                                                              commandLine.ProceduralScene, commandLine.Headless,
+                                                              commandLine.RenderOptions);
 
     app->Run();
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return app->HasFailed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -19,7 +19,8 @@ includes("xmake/**.lua")
 add_repositories("pixfri https://github.com/Pixfri/xmake-repo.git")
 
 add_requires("spdlog v1.9.0", "glfw 3.4", "vulkan-loader 1.3.290+0", "vk-bootstrap v1.3.290", 
-             "vulkan-memory-allocator v3.1.0", "vulkan-utility-libraries v1.3.290", "glm 1.0.1")
+             "vulkan-memory-allocator v3.1.0", "vulkan-utility-libraries v1.3.290", "glm 1.0.1", "nlohmann_json v3.11.3",
+             "stb 2024.06.01")
 add_requires("glslang 1.3.290+0", {configs = {binaryonly = true}})
 add_requires("imgui v1.91.0", {configs = {glfw = true, vulkan = true, debug = is_mode("debug")}})
              
@@ -50,7 +51,7 @@ target("Raytracer")
     add_headerfiles("Include/**.hpp", "Include/**.inl")
     add_includedirs("Include/")
     
-    add_files("Shaders/**.vert", "Shaders/**.frag") -- Tell glsl2spv to compile the files.
+    add_files("Shaders/**.vert", "Shaders/**.frag", "Shaders/**.comp") -- Tell glsl2spv to compile the files.
     add_headerfiles("Shaders/**") -- A trick to make them show up in VS/Rider solutions.
 
     add_headerfiles("Resources/**") -- A trick to make them show up in VS/Rider solutions.
@@ -58,5 +59,5 @@ target("Raytracer")
     set_pcxxheader("Include/Raytracer/rtpch.hpp")
     
     add_packages("spdlog", "glfw", "vulkan-loader", "vk-bootstrap", "vulkan-memory-allocator", "vulkan-utility-libraries", 
-                 "glm", "imgui")
+                 "glm", "imgui", "nlohmann_json", "stb")
     